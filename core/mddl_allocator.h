@@ -0,0 +1,20 @@
+#ifndef INC_MDDL_ALLOCATOR_H
+#define INC_MDDL_ALLOCATOR_H
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief コンテナのインスタンス毎に指定できるアロケータです。
+ *	各関数の第1引数にはctxがそのまま渡されます。
+ *	reallocはptrがNULLの場合にallocと同じ動作をしてください。
+ */
+typedef struct _mddl_allocator {
+    void *(*alloc)(void *const ctx, const size_t size);
+    void *(*realloc)(void *const ctx, void *const ptr, const size_t size);
+    void (*free)(void *const ctx, void *const ptr);
+    void *ctx;
+} mddl_allocator_t;
+
+#endif /* end of INC_MDDL_ALLOCATOR_H */
@@ -0,0 +1,505 @@
+/**
+ *	Copyright 2026 TSN-SHINGENN All Rights Reserved.
+ *
+ *	Basic Author: Seiichi Takeda  '2026-October-16 Active
+ *		Last Alteration $Author: takeda $
+ *
+ *	Dual License :
+ *	non-commercial ... MIT Licence
+ *	    commercial ... Requires permission from the author
+ */
+
+/**
+ * @file mddl_arena.c
+ * @brief ポインタを進めるだけで割り当てるアリーナアロケータです。
+ *	一時的なオブジェクトをまとめて確保し、mark()/release_to()の区間単位や
+ *	reset()でまとめて破棄する用途向けです。個別の開放は基本的に行いません。
+ *	チャンクはmddl_mallocaterのヒープ(またはmddl_malloc)から、もしくは利用者が
+ *	指定したバッファから確保します。一度確保したチャンクはdestroyまで保持して再利用します。
+ *	mddl_arena_get_allocator()でコンテナのアロケータとして指定できます。
+ *	スレッドセーフではありません。上位層で処理を行ってください。
+ */
+
+/* POSIX */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* this */
+#include "mddl_mallocater.h"
+#include "mddl_arena.h"
+
+/* dbms */
+#ifdef DEBUG
+static int debuglevel = 4;
+#else
+static const int debuglevel = 0;
+#endif
+#include "dbms.h"
+
+#define EOL_CRLF "\n\r"
+
+/* 弱いアロケータの定義 */
+void __attribute__((weak)) *mddl_malloc(const size_t size)
+{
+    return malloc(size);
+}
+
+void __attribute__((weak)) mddl_free( void *const ptr )
+{
+    free(ptr);
+}
+
+#define ARENA_ALIGN sizeof(void*)
+#define ARENA_DEFAULT_CHUNK_SIZE 4096
+#define ALIGN_CEIL(z) (((z) + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1))
+
+typedef struct _arena_chunk {
+    struct _arena_chunk *next;
+    size_t capacity;
+    size_t used;
+} arena_chunk_t;
+
+#define SIZEOF_CHUNKHEADER ALIGN_CEIL(sizeof(arena_chunk_t))
+#define GET_CHUNK_DATA(c) ((uint8_t*)(c) + SIZEOF_CHUNKHEADER)
+
+typedef struct _mddl_arena_ext {
+    mddl_mallocater_t *heap_p;
+    size_t chunk_size;
+
+    arena_chunk_t *chunks;	/* チャンクのリスト(確保した順) */
+    arena_chunk_t *cur;		/* 割り当て中のチャンク */
+    void *last_p;		/* 直前に割り当てた領域(その場での拡張と開放に使用) */
+
+    union {
+	unsigned int flags;
+	struct {
+	    unsigned int buffer_fixed:1; /* 利用者のバッファを使用していてチャンクを追加できない */
+	} f;
+    } stat;
+} mddl_arena_ext_t;
+
+#define get_arena_ext(s) (mddl_arena_ext_t*)((s)->ext)
+#define get_const_arena_ext(s) (const mddl_arena_ext_t*)((s)->ext)
+
+/**
+ * @fn static void *arena_backend_alloc(mddl_mallocater_t *const heap_p, const size_t size)
+ * @brief チャンクの確保元からメモリを確保します
+ * @param heap_p mddl_mallocater_t構造体ポインタ(NULLの場合はmddl_malloc)
+ * @param size 確保サイズ
+ */
+static void *arena_backend_alloc(mddl_mallocater_t *const heap_p, const size_t size)
+{
+    if( NULL != heap_p ) {
+	return mddl_mallocater_alloc_with_obj(heap_p, size);
+    }
+    return mddl_malloc(size);
+}
+
+/**
+ * @fn static void arena_backend_free(mddl_mallocater_t *const heap_p, void *const ptr)
+ * @brief チャンクの確保元へメモリを戻します
+ * @param heap_p mddl_mallocater_t構造体ポインタ(NULLの場合はmddl_free)
+ * @param ptr 開放するポインタ
+ */
+static void arena_backend_free(mddl_mallocater_t *const heap_p, void *const ptr)
+{
+    if( NULL != heap_p ) {
+	mddl_mallocater_free_with_obj(heap_p, ptr);
+	return;
+    }
+    mddl_free(ptr);
+}
+
+/**
+ * @fn static arena_chunk_t *arena_new_chunk(mddl_arena_ext_t *const e, const size_t capacity)
+ * @brief チャンクを確保元から確保します
+ * @param e mddl_arena_ext_t構造体ポインタ
+ * @param capacity チャンクのデータ領域サイズ
+ * @retval NULL 確保できない
+ * @retval NULL以外 チャンクのポインタ
+ */
+static arena_chunk_t *arena_new_chunk(mddl_arena_ext_t *const e, const size_t capacity)
+{
+    arena_chunk_t *c;
+
+    if( e->stat.f.buffer_fixed || (capacity > (SIZE_MAX - SIZEOF_CHUNKHEADER)) ) {
+	return NULL;
+    }
+
+    c = (arena_chunk_t*)arena_backend_alloc(e->heap_p, SIZEOF_CHUNKHEADER + capacity);
+    if( NULL == c ) {
+	DBMS1("%s : arena_backend_alloc fail" EOL_CRLF, __func__);
+	return NULL;
+    }
+    c->next = NULL;
+    c->capacity = capacity;
+    c->used = 0;
+
+    return c;
+}
+
+/**
+ * @fn int mddl_arena_init( mddl_arena_t *const self_p, const mddl_arena_attr_t *const attr_p)
+ * @brief アリーナを初期化します。最初のチャンクを確保します。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param attr_p 属性(NULLの場合はmddl_mallocからデフォルトのチャンクサイズで確保)
+ * @retval 0 成功
+ * @retval EAGAIN リソースの獲得に失敗
+ */
+int mddl_arena_init( mddl_arena_t *const self_p, const mddl_arena_attr_t *const attr_p)
+{
+    mddl_arena_ext_t *e;
+    mddl_mallocater_t *const heap_p = (NULL == attr_p) ? NULL : attr_p->heap_p;
+
+    memset(self_p, 0x0, sizeof(mddl_arena_t));
+
+    e = (mddl_arena_ext_t*)arena_backend_alloc(heap_p, sizeof(mddl_arena_ext_t));
+    if( NULL == e ) {
+	DBMS1("%s : alloc(ext) fail" EOL_CRLF, __func__);
+	return EAGAIN;
+    }
+    memset(e, 0x0, sizeof(mddl_arena_ext_t));
+
+    e->heap_p = heap_p;
+    e->chunk_size = ((NULL == attr_p) || (0 == attr_p->chunk_size)) ?
+	ARENA_DEFAULT_CHUNK_SIZE : ALIGN_CEIL(attr_p->chunk_size);
+
+    e->chunks = e->cur = arena_new_chunk(e, e->chunk_size);
+    if( NULL == e->chunks ) {
+	arena_backend_free(heap_p, e);
+	return EAGAIN;
+    }
+    self_p->ext = e;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_arena_init_with_buffer( mddl_arena_t *const self_p, void *const buf, const size_t bufsiz)
+ * @brief 利用者が指定したバッファでアリーナを初期化します
+ *	管理情報もbufから切り出すので、アロケータを一切呼び出しません。
+ *	bufを使い切ると mddl_arena_alloc() はNULLを返します。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param buf アリーナに使用するバッファ
+ * @param bufsiz bufのサイズ
+ * @retval 0 成功
+ * @retval EINVAL 引数が不正
+ * @retval ENOMEM バッファが小さすぎる
+ */
+int mddl_arena_init_with_buffer( mddl_arena_t *const self_p, void *const buf, const size_t bufsiz)
+{
+    mddl_arena_ext_t *e;
+    arena_chunk_t *c;
+    const uintptr_t top = ALIGN_CEIL((uintptr_t)buf);
+    const uintptr_t end = (uintptr_t)buf + bufsiz;
+
+    memset(self_p, 0x0, sizeof(mddl_arena_t));
+
+    if( NULL == buf ) {
+	return EINVAL;
+    }
+    if( (top + ALIGN_CEIL(sizeof(mddl_arena_ext_t)) + SIZEOF_CHUNKHEADER + ARENA_ALIGN) > end ) {
+	return ENOMEM;
+    }
+
+    e = (mddl_arena_ext_t*)top;
+    memset(e, 0x0, sizeof(mddl_arena_ext_t));
+    c = (arena_chunk_t*)(top + ALIGN_CEIL(sizeof(mddl_arena_ext_t)));
+    c->next = NULL;
+    c->capacity = (end - (uintptr_t)GET_CHUNK_DATA(c)) & ~(ARENA_ALIGN - 1);
+    c->used = 0;
+
+    e->chunk_size = c->capacity;
+    e->chunks = e->cur = c;
+    e->stat.f.buffer_fixed = 1;
+
+    self_p->ext = e;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_arena_destroy( mddl_arena_t *const self_p)
+ * @brief アリーナを破棄し、全てのチャンクを確保元に戻します
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @return 0固定
+ */
+int mddl_arena_destroy( mddl_arena_t *const self_p)
+{
+    mddl_arena_ext_t *const e = get_arena_ext(self_p);
+    arena_chunk_t *c;
+
+    if( NULL == e ) {
+	return 0;
+    }
+
+    if( !e->stat.f.buffer_fixed ) {
+	mddl_mallocater_t *const heap_p = e->heap_p;
+
+	c = e->chunks;
+	while( NULL != c ) {
+	    arena_chunk_t *const next = c->next;
+	    arena_backend_free(heap_p, c);
+	    c = next;
+	}
+	arena_backend_free(heap_p, e);
+    }
+    self_p->ext = NULL;
+
+    return 0;
+}
+
+/**
+ * @fn void *mddl_arena_alloc( mddl_arena_t *const self_p, const size_t size)
+ * @brief アリーナから領域を割り当てます
+ *	現在のチャンクに収まらない場合は次のチャンクへ進み、無ければチャンクを追加します。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param size 割り当てサイズ
+ * @retval NULL 割り当てできない(errnoにENOMEMを設定)
+ * @retval NULL以外 割り当てた領域のポインタ
+ */
+void *mddl_arena_alloc( mddl_arena_t *const self_p, const size_t size)
+{
+    mddl_arena_ext_t *const e = get_arena_ext(self_p);
+    arena_chunk_t *c = e->cur;
+    size_t asz;
+    void *p;
+
+    if( size > (SIZE_MAX - ARENA_ALIGN) ) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    asz = ALIGN_CEIL((0 == size) ? 1 : size);
+
+    if( (c->capacity - c->used) < asz ) {
+	arena_chunk_t *const n = c->next;
+
+	if( (NULL != n) && (n->capacity >= asz) ) {
+	    /* mark/resetで巻き戻った後のチャンクを再利用 */
+	    n->used = 0;
+	    c = n;
+	} else {
+	    arena_chunk_t *const new_c = arena_new_chunk(e, (asz > e->chunk_size) ? asz : e->chunk_size);
+	    if( NULL == new_c ) {
+		errno = ENOMEM;
+		return NULL;
+	    }
+	    new_c->next = n;
+	    c->next = new_c;
+	    c = new_c;
+	}
+	e->cur = c;
+    }
+
+    p = GET_CHUNK_DATA(c) + c->used;
+    c->used += asz;
+    e->last_p = p;
+
+    return p;
+}
+
+/**
+ * @fn void *mddl_arena_realloc( mddl_arena_t *const self_p, void *const ptr, const size_t size)
+ * @brief 割り当て済みの領域のサイズを変更します
+ *	直前に割り当てた領域で、チャンクに余裕があればその場で拡張・縮小します。
+ *	それ以外は新しく割り当てて内容をコピーします(元の領域はreset等まで残ります)。
+ *	アリーナは個々のサイズを保持しないので、コピー量はsizeとチャンクの使用済み末尾までの小さい方です。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param ptr 割り当て済みの領域(NULLの場合はmddl_arena_alloc()と同じ)
+ * @param size 新しいサイズ
+ * @retval NULL 割り当てできない、またはptrがこのアリーナの領域ではない
+ * @retval NULL以外 領域のポインタ
+ */
+void *mddl_arena_realloc( mddl_arena_t *const self_p, void *const ptr, const size_t size)
+{
+    mddl_arena_ext_t *const e = get_arena_ext(self_p);
+    arena_chunk_t *c;
+    size_t avail, ofs;
+    void *new_p;
+
+    if( NULL == ptr ) {
+	return mddl_arena_alloc(self_p, size);
+    }
+    if( size > (SIZE_MAX - ARENA_ALIGN) ) {
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    if( ptr == e->last_p ) {
+	const size_t asz = ALIGN_CEIL((0 == size) ? 1 : size);
+
+	c = e->cur;
+	ofs = (size_t)((uint8_t*)ptr - GET_CHUNK_DATA(c));
+	if( (c->capacity - ofs) >= asz ) {
+	    c->used = ofs + asz;
+	    return ptr;
+	}
+	avail = c->used - ofs;
+    } else {
+	for( c=e->chunks; NULL != c; c=c->next ) {
+	    const uint8_t *const data = GET_CHUNK_DATA(c);
+	    if( ((const uint8_t*)ptr >= data) && ((const uint8_t*)ptr < (data + c->used)) ) {
+		break;
+	    }
+	    if( c == e->cur ) {
+		c = NULL;
+		break;
+	    }
+	}
+	if( NULL == c ) {
+	    DBMS1("%s : ptr=%p is not in this arena" EOL_CRLF, __func__, ptr);
+	    errno = EINVAL;
+	    return NULL;
+	}
+	ofs = (size_t)((uint8_t*)ptr - GET_CHUNK_DATA(c));
+	avail = c->used - ofs;
+    }
+
+    new_p = mddl_arena_alloc(self_p, size);
+    if( NULL == new_p ) {
+	return NULL;
+    }
+    memcpy(new_p, ptr, (size < avail) ? size : avail);
+
+    return new_p;
+}
+
+/**
+ * @fn void mddl_arena_free( mddl_arena_t *const self_p, void *const ptr)
+ * @brief 領域を開放します
+ *	直前に割り当てた領域のみ巻き戻します。それ以外は何もしません。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param ptr 割り当て済みの領域
+ */
+void mddl_arena_free( mddl_arena_t *const self_p, void *const ptr)
+{
+    mddl_arena_ext_t *const e = get_arena_ext(self_p);
+
+    if( (NULL == ptr) || (ptr != e->last_p) ) {
+	return;
+    }
+    e->cur->used = (size_t)((uint8_t*)ptr - GET_CHUNK_DATA(e->cur));
+    e->last_p = NULL;
+}
+
+/**
+ * @fn mddl_arena_mark_t mddl_arena_mark( mddl_arena_t *const self_p)
+ * @brief 現在の割り当て位置を返します。mddl_arena_release_to()で巻き戻す位置に使用します。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @return 割り当て位置
+ */
+mddl_arena_mark_t mddl_arena_mark( mddl_arena_t *const self_p)
+{
+    const mddl_arena_ext_t *const e = get_const_arena_ext(self_p);
+    mddl_arena_mark_t mark;
+
+    mark.chunk = e->cur;
+    mark.used = e->cur->used;
+
+    return mark;
+}
+
+/**
+ * @fn int mddl_arena_release_to( mddl_arena_t *const self_p, const mddl_arena_mark_t mark)
+ * @brief mddl_arena_mark()で得た位置まで割り当てを巻き戻します
+ *	mark以降に割り当てた領域は全て無効になります。チャンクは保持したまま再利用します。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param mark mddl_arena_mark()で得た位置
+ * @retval 0 成功
+ * @retval EINVAL markが不正
+ */
+int mddl_arena_release_to( mddl_arena_t *const self_p, const mddl_arena_mark_t mark)
+{
+    mddl_arena_ext_t *const e = get_arena_ext(self_p);
+    arena_chunk_t *const c = (arena_chunk_t*)mark.chunk;
+
+    if( (NULL == c) || (mark.used > c->used) ) {
+	return EINVAL;
+    }
+
+    c->used = mark.used;
+    e->cur = c;
+    e->last_p = NULL;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_arena_reset( mddl_arena_t *const self_p)
+ * @brief 全ての割り当てを破棄します。チャンクは保持したまま再利用します。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @return 0固定
+ */
+int mddl_arena_reset( mddl_arena_t *const self_p)
+{
+    mddl_arena_ext_t *const e = get_arena_ext(self_p);
+
+    e->cur = e->chunks;
+    e->cur->used = 0;
+    e->last_p = NULL;
+
+    return 0;
+}
+
+/**
+ * @fn size_t mddl_arena_get_used_bytes( mddl_arena_t *const self_p)
+ * @brief 割り当て済みのバイト数を返します(アライメント調整分を含みます)
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @return バイト数
+ */
+size_t mddl_arena_get_used_bytes( mddl_arena_t *const self_p)
+{
+    const mddl_arena_ext_t *const e = get_const_arena_ext(self_p);
+    const arena_chunk_t *c;
+    size_t total = 0;
+
+    for( c=e->chunks; NULL != c; c=c->next ) {
+	total += c->used;
+	if( c == e->cur ) {
+	    break;
+	}
+    }
+
+    return total;
+}
+
+static void *arena_alc_alloc(void *const ctx, const size_t size)
+{
+    return mddl_arena_alloc((mddl_arena_t*)ctx, size);
+}
+
+static void *arena_alc_realloc(void *const ctx, void *const ptr, const size_t size)
+{
+    return mddl_arena_realloc((mddl_arena_t*)ctx, ptr, size);
+}
+
+static void arena_alc_free(void *const ctx, void *const ptr)
+{
+    mddl_arena_free((mddl_arena_t*)ctx, ptr);
+}
+
+/**
+ * @fn int mddl_arena_get_allocator( mddl_arena_t *const self_p, mddl_allocator_t *const alc_p)
+ * @brief コンテナのinit_exに指定するアロケータを取得します
+ *	コンテナの破棄や要素の削除でもアリーナの領域は戻りません。reset等でまとめて開放してください。
+ * @param self_p mddl_arena_t構造体インスタンスポインタ
+ * @param alc_p 設定するmddl_allocator_t構造体ポインタ
+ * @retval 0 成功
+ * @retval EINVAL 引数が不正
+ */
+int mddl_arena_get_allocator( mddl_arena_t *const self_p, mddl_allocator_t *const alc_p)
+{
+    if( (NULL == self_p) || (NULL == alc_p) ) {
+	return EINVAL;
+    }
+
+    alc_p->alloc = arena_alc_alloc;
+    alc_p->realloc = arena_alc_realloc;
+    alc_p->free = arena_alc_free;
+    alc_p->ctx = self_p;
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef INC_MDDL_ARENA_H
+#define INC_MDDL_ARENA_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mddl_allocator.h"
+#include "mddl_mallocater.h"
+
+typedef struct _mddl_arena_attr {
+    mddl_mallocater_t *heap_p;	/* チャンクの確保元(NULLの場合はmddl_malloc) */
+    size_t chunk_size;		/* 1チャンクのサイズ(0の場合はデフォルト) */
+} mddl_arena_attr_t;
+
+typedef struct _mddl_arena_mark {
+    void *chunk;
+    size_t used;
+} mddl_arena_mark_t;
+
+typedef struct _mddl_arena {
+    void *ext;
+} mddl_arena_t;
+
+#if defined (__cplusplus )
+extern "C" {
+#endif
+
+int mddl_arena_init( mddl_arena_t *const self_p, const mddl_arena_attr_t *const attr_p);
+int mddl_arena_init_with_buffer( mddl_arena_t *const self_p, void *const buf, const size_t bufsiz);
+int mddl_arena_destroy( mddl_arena_t *const self_p);
+
+void *mddl_arena_alloc( mddl_arena_t *const self_p, const size_t size);
+void *mddl_arena_realloc( mddl_arena_t *const self_p, void *const ptr, const size_t size);
+void mddl_arena_free( mddl_arena_t *const self_p, void *const ptr);
+
+mddl_arena_mark_t mddl_arena_mark( mddl_arena_t *const self_p);
+int mddl_arena_release_to( mddl_arena_t *const self_p, const mddl_arena_mark_t mark);
+int mddl_arena_reset( mddl_arena_t *const self_p);
+
+size_t mddl_arena_get_used_bytes( mddl_arena_t *const self_p);
+int mddl_arena_get_allocator( mddl_arena_t *const self_p, mddl_allocator_t *const alc_p);
+
+#if defined (__cplusplus )
+}
+#endif
+
+#endif /* end of INC_MDDL_ARENA_H */
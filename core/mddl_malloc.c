@@ -16,6 +16,10 @@
  *　	これはmddl_lite_mallocaterを使用し、STATICバッファを擬似的にHEAPにします。
  *	標準APIによるメモリ消費を軽減します。また、マイコン搭載時には、メモリ管理を見える化します。
  *	切り替えた場合はmddl_lite_mallocater_init()で必ず初期化してください。
+ *	3._MDDL_MALLOC_THREAD_SAFEを定義してビルドすると、_mddl_mallocater_mt_heap_objが
+ *	初期化済みの場合にスレッドセーフなmddl_mallocater_mt経由で割り当てます。
+ *	mddl_mallocater_mt_init(&_mddl_mallocater_mt_heap_obj, &_mddl_mallocater_heap_obj)は
+ *	最初のmddl_malloc()の前に呼び出してください。
  **/
 
 #include <stddef.h>
@@ -25,6 +29,9 @@
 #include <errno.h>
 
 #include "mddl_mallocater.h"
+#if defined(_MDDL_MALLOC_THREAD_SAFE)
+#include "mddl_mallocater_mt.h"
+#endif
 #include "mddl_malloc.h"
 
 #ifdef DEBUG
@@ -36,18 +43,53 @@ static const int debuglevel = 0;
 
 #define EOL_CRLF "\n\r"
 
+/**
+ * @note mddl_malloc_align()で確保した領域は、返すアドレスの直前に
+ *	mddl_malloc()で確保した本来のポインタと要求サイズを保存します。
+ */
+typedef struct _mddl_malloc_align_header {
+    void *mem;		/* mddl_malloc()で確保したポインタ */
+    size_t size;	/* 要求されたサイズ */
+} mddl_malloc_align_header_t;
+
+#define SIZEOF_ALIGNHEADER (sizeof(mddl_malloc_align_header_t))
+#define GET_ALIGN_HEADER(p) (((mddl_malloc_align_header_t*)(p)) - 1)
+#define ALIGN_TOTALSIZE(z, a) ((z) + SIZEOF_ALIGNHEADER + ((a) - 1))
+#define ALIGN_UP_PTR(p, a) ((uint8_t*)(((uintptr_t)(p) + ((a) - 1)) & ~((uintptr_t)(a) - 1)))
+
+/**
+ * @fn static uint8_t *align_place(void *const mem, const size_t alignment, const size_t size)
+ * @brief 確保済みの領域内でアライメントが整ったアドレスを求め、ヘッダを格納します
+ * @param mem mddl_malloc()で確保したポインタ
+ * @param alignment アライメント
+ * @param size 要求サイズ
+ * @return アライメントが整ったアドレス
+ */
+static uint8_t *align_place(void *const mem, const size_t alignment, const size_t size)
+{
+    uint8_t *const aligned_mem = ALIGN_UP_PTR((uint8_t*)mem + SIZEOF_ALIGNHEADER, alignment);
+
+    IFDBG5THEN {
+	DBMS5( "%s : mem=0x%p aligned_mem=0x%p" EOL_CRLF, __func__, mem, aligned_mem);
+    }
+
+    GET_ALIGN_HEADER(aligned_mem)->mem = mem;
+    GET_ALIGN_HEADER(aligned_mem)->size = size;
+
+    return aligned_mem;
+}
+
 /**
  * @fn int mddl_malloc_align(void **memptr, const size_t alignment, const size_t size)
  * @brief アライメントを考慮したメモリ割り当てを行います。
  *	確保したメモリの解放にはmddl_mfree()を使ってください
  * @param memptr 割り当てられたメモリを格納するメモリブロックポインタ
  * @param alignment アライメント(配置)の値。2 の累乗値を指定する必要があります。 
- *	もし0が指定された場合にはsizeof(int)が設定されます
+ *	もし0が指定された場合にはsizeof(uint64_t)が設定されます
  * @param size メモリブロックのサイズ
  * @retval 0 成功
  * @retval EINVAL 引数エラー
  * @retval ENOMEM メモリ確保失敗
- * @retval -1 原因不明のエラー(コードが知らないだけかも?)
  **/
 int mddl_malloc_align(void **memptr, const size_t alignment,
 			 const size_t size)
@@ -55,46 +97,23 @@ int mddl_malloc_align(void **memptr, const size_t alignment,
     int result;
     const size_t a = (alignment == 0) ? sizeof(uint64_t) : alignment;
     void *mem = NULL;
-    uint8_t *aligned_mem = NULL;
 
     DBMS5("%s : execute" EOL_CRLF, __func__);
-    if ((a % 2) || (size == 0) || (NULL == memptr)) {
+    if ((a & (a - 1)) || (size == 0) || (NULL == memptr)
+	|| (ALIGN_TOTALSIZE(size, a) < size)) {
 	result = errno = EINVAL;
     } else {
-	const size_t total = size + sizeof(void *) + (a - 1);
-	mem = malloc(total);
+	const size_t total = ALIGN_TOTALSIZE(size, a);
+	mem = mddl_malloc(total);
 	if (NULL == mem) {
-	    result = errno;
+	    result = errno = ENOMEM;
 	} else {
-	    uintptr_t offs;
-
 	    IFDBG5THEN {
 		DBMS5("%s : malloc = 0x%p total=%llu  alignment=%llu size=%llu" EOL_CRLF,
 		    __func__, mem, (unsigned long long)total,(unsigned long long)alignment, (unsigned long long)size);
 	    }
 
-	    /**
-	     * @note 確保されたメモリのアライメントが整ったアドレスを計算する
-	     */
-	    aligned_mem = ((uint8_t *) mem + sizeof(void *));
-	    offs = (uintptr_t) a - ((uintptr_t) aligned_mem & (a - 1));
-
-	    IFDBG5THEN {
-		DBMS5(
-		  "%s : a-1=0x%llx offs=0x%llu" EOL_CRLF,
-		    __func__, (uintptr_t)a-1, offs);
-	    }
-
-	    aligned_mem += offs;
-
-	    IFDBG5THEN {
-		DBMS5( "%s : aligned_mem = 0x%p" EOL_CRLF, __func__, aligned_mem);
-	    }
-
-	    /* 返すアドレスの一つ前に本来mallocで返されたポインタアドレスを保存しておく */
-	    ((void **) aligned_mem)[-1] = mem;
-
-	    *memptr = aligned_mem;
+	    *memptr = align_place(mem, a, size);
 	    result = 0;
 	}
     }
@@ -103,50 +122,90 @@ int mddl_malloc_align(void **memptr, const size_t alignment,
 }
 
 /**
- * @fn int mddl_realloc_align(void *memblk, const size_t alignment, const size_t size)
+ * @fn void *mddl_realloc_align(void *memblk, const size_t alignment, const size_t size)
  * @brief アライメントを考慮したメモリの再割り当てを行います。
- * @param memblk 現在のメモリブロックポインタ
+ *	まずmddl_realloc()で元の領域の拡張・縮小を試みるので、後方に空きがあればコピーは発生しません。
+ *	元の内容は、元のサイズとsizeの小さい方まで保存されます。
+ * @param memblk 現在のメモリブロックポインタ(mddl_malloc_align()で確保したもの)。NULLの場合はmddl_malloc_align()と同じです
+ * @param alignment アライメント(配置)の値。2 の累乗値を指定する必要があります。 
+ *	もし0が指定された場合にはsizeof(uint64_t)が設定されます
  * @param size 割り当てするメモリのサイズ
- * @param alignment アライメントサイズ。2の累乗値で最大ページサイズ
- * @retval NULL 失敗
- * @retval NULL以外 再割り当てされたポインタ
+ * @retval NULL 失敗(errno参照)。memblkは開放されません
+ * @retval NULL以外 再割り当てされたポインタ。memblkと異なる場合はmemblkは開放済
  */
 void *mddl_realloc_align(void *memblk, const size_t alignment,
 			    const size_t size)
 {
-    int result;
+    const size_t a = (alignment == 0) ? sizeof(uint64_t) : alignment;
+    const mddl_malloc_align_header_t *hdr;
+    size_t oldofs, keep, total;
     void *mem;
-    result = mddl_malloc_align(&mem, alignment, size);
-    if (result) {
+    uint8_t *aligned_mem;
+
+    DBMS5( "%s : execute" EOL_CRLF, __func__);
+    if (NULL == memblk) {
+	void *memptr = NULL;
+	return (mddl_malloc_align(&memptr, a, size) == 0) ? memptr : NULL;
+    } else if ((a & (a - 1)) || (size == 0) || (ALIGN_TOTALSIZE(size, a) < size)) {
+	errno = EINVAL;
 	return NULL;
     }
-    memcpy(mem, memblk, size);
-    mddl_mfree(memblk);
-    return mem;
+
+    hdr = GET_ALIGN_HEADER(memblk);
+    oldofs = (size_t)((uint8_t*)memblk - (uint8_t*)hdr->mem);
+    keep = (hdr->size < size) ? hdr->size : size;
+    total = ALIGN_TOTALSIZE(size, a);
+
+    if ((oldofs + keep) > total) {
+	/* アライメントを大きくして縮小する場合は、元の位置のデータが新しい領域に収まらない */
+	void *memptr = NULL;
+	if (mddl_malloc_align(&memptr, a, size)) {
+	    return NULL;
+	}
+	memcpy(memptr, memblk, keep);
+	mddl_mfree(memblk);
+	return memptr;
+    }
+
+    mem = mddl_realloc(hdr->mem, total);
+    if (NULL == mem) {
+	return NULL;
+    }
+
+    /* 領域が移動した場合はアライメントのずれ分だけデータを移動する */
+    aligned_mem = ALIGN_UP_PTR((uint8_t*)mem + SIZEOF_ALIGNHEADER, a);
+    if ((size_t)(aligned_mem - (uint8_t*)mem) != oldofs) {
+	memmove(aligned_mem, (uint8_t*)mem + oldofs, keep);
+    }
+
+    return align_place(mem, a, size);
 }
 
 /**
  * @fn int mddl_mfree(void *memptr)
  * @brief mddl_malloc_align()で確保したメモリを解放します
  *   OS毎に mddl_malloc_align()の挙動が違うので Cランタイムのfree()を使わないでください。
- * @param memptr メモリブロックポインタ
+ * @param memptr メモリブロックポインタ。NULLの場合は何もしません
  * @retval 0 成功
- * @retval -1 このOSではサポートされていません
  */
 int mddl_mfree(void *memptr)
 {
+    if (NULL == memptr) {
+	return 0;
+    }
+
     /**
      * @note 保存していたポインタをfreeに渡してメモリ解放 
      */
-    mddl_free(((void **) memptr)[-1]);
+    mddl_free(GET_ALIGN_HEADER(memptr)->mem);
     return 0;
 }
 
 /**
  * @fn void *mddl_mrealloc_align( void *memblock, const size_t alignment, const size_t size)
  * @brief メモリの再割り当てを行います。
- *	差異割り当てされたメモリへのデータコピーは行われません(C1xで未定義と決まったため）
- * @param memblock 現在メモリのブロックポインた
+ *	mddl_realloc_align()と同じです。互換のために残しています。
+ * @param memblock 現在メモリのブロックポインタ
  * @param alignment アライメント(配置)の値。2 の累乗値を指定する必要があります。 
  *	もし0が指定された場合にはsizeof(uint64_t)が設定されます
  * @param size メモリブロックのサイズ
@@ -156,33 +215,7 @@ int mddl_mfree(void *memptr)
 void *mddl_mrealloc_align(void *memblock, const size_t alignment,
 			     const size_t size)
 {
-    size_t a = (alignment == 0) ? sizeof(uint64_t) : alignment;
-    int result;
-    void *mem = NULL;
-    uint8_t *aligned_mem = NULL;
-
-    DBMS5( "%s : execute" EOL_CRLF, __func__);
-    if (NULL == memblock) {
-	void *memptr = NULL;
-	result = mddl_malloc_align(&memptr, a, size);
-	return (result == 0) ? memptr : NULL;
-    } else if ((a % 2) || (size == 0)) {
-	errno = EINVAL;
-	return NULL;
-    } else {
-	mem =
-	    mddl_realloc(((void **) memblock)[-1],
-		    size + (a - 1) + sizeof(void *));
-	if (NULL == mem) {
-	    return NULL;
-	} else {
-	    aligned_mem = ((uint8_t *) mem + sizeof(void *));
-	    aligned_mem += ((uintptr_t) aligned_mem & (a - 1));
-	    ((void **) aligned_mem)[-1] = mem;
-	}
-    }
-
-    return aligned_mem;
+    return mddl_realloc_align(memblock, alignment, size);
 }
 
 /**
@@ -250,6 +283,11 @@ mddl_mem_alignment_partition_t mddl_mem_alignment_partition(int
  **/
 void *mddl_malloc(const size_t size)
 {
+#if defined(_MDDL_MALLOC_THREAD_SAFE)
+    if( _mddl_mallocater_mt_heap_obj.init.f.initialized ) {
+	return mddl_mallocater_mt_alloc(&_mddl_mallocater_mt_heap_obj, size);
+    }
+#endif
     return mddl_mallocater_alloc(size);
 }
 
@@ -260,6 +298,12 @@ void *mddl_malloc(const size_t size)
  **/
 void mddl_free( void *const ptr)
 {
+#if defined(_MDDL_MALLOC_THREAD_SAFE)
+    if( _mddl_mallocater_mt_heap_obj.init.f.initialized ) {
+	mddl_mallocater_mt_free(&_mddl_mallocater_mt_heap_obj, ptr);
+	return;
+    }
+#endif
     mddl_mallocater_free(ptr);
 }
 
@@ -276,6 +320,11 @@ void mddl_free( void *const ptr)
  **/
 void *mddl_realloc( void *const ptr, const size_t size)
 {
+#if defined(_MDDL_MALLOC_THREAD_SAFE)
+    if( _mddl_mallocater_mt_heap_obj.init.f.initialized ) {
+	return mddl_mallocater_mt_realloc(&_mddl_mallocater_mt_heap_obj, ptr, size);
+    }
+#endif
     return mddl_mallocater_realloc(ptr, size);
 }
 
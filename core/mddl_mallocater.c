@@ -13,6 +13,8 @@
  * @file mddl_mallocater.c
  * @brief  フラグメント制御がない、軽いメモリーアロケーター
  *	指定されたメモリ領域内での、動的な割り当てと開放を行います。
+ *	空き領域はTLSF形式の2段階のサイズ別空きリストで管理し、割り当てと開放をO(1)で処理します。
+ *	mddl_mallocater_add_region_with_obj()や成長用コールバックで管理する領域を後から追加できます。
  */
 
 #include <sys/types.h>
@@ -21,9 +23,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define MDDL_MALLOCATER_HAS_MMAP
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#define MDDL_MALLOCATER_HAS_BACKTRACE
+#endif
+#if defined(_MDDL_MALLOCATER_TRACE)
+#include <stdio.h>
+#include <time.h>
+#endif
 
 /* this */
 #include "mddl_mallocater.h"
+#include "mddl_sprintf.h"
 
 #ifdef DEBUG
 #ifdef __GNUC__
@@ -43,15 +64,46 @@ static const int debuglevel = 0;
 mddl_mallocater_t _mddl_mallocater_heap_obj;
 #define ALLOCATER_ALIGN sizeof(void*)
 #define ALLOCATED_FLAG ((uint32_t)(0x1))
+#define SAMPLED_FLAG ((uint32_t)(0x2))	/* プロファイラが抜き取った領域 */
+#define HANDLE_FLAG ((uint32_t)(0x4))	/* ハンドルで参照される移動可能な領域 */
+#define STAMP_FLAGS (ALLOCATED_FLAG | SAMPLED_FLAG | HANDLE_FLAG)
 #define MAGIC_NO (((uint32_t)'M' << 24 ) | ((uint32_t)'e' << 16 ) |((uint32_t) 'm' << 8) | 0)
 
 #define get_allocater_own() &(_mddl_mallocater_heap_obj)
 
+/**
+ * @note _MDDL_MALLOCATER_COMPACT_HEADERを定義してビルドすると、領域ヘッダのリンクを
+ *	ヘッダ自身からの32bitの相対位置で、フッタをヘッダアドレスの下位32bitで持ちます。
+ *	リンクが届くように、全ての領域はinit_objに渡したバッファから±COMPACT_SPANの範囲に
+ *	収まっている必要があります。番兵(base)もリンクが届くようにバッファの先頭に置きます。
+ */
+#if defined(_MDDL_MALLOCATER_COMPACT_HEADER)
+typedef uint32_t mddl_mallocater_footer_t;
+#define FOOTER_VALUE(h) ((mddl_mallocater_footer_t)(uintptr_t)(h))
+#define HEAD_NEXT(h) ((mddl_malllocate_header_t*)((intptr_t)(h) + (h)->next_rel))
+#define HEAD_PREV(h) ((mddl_malllocate_header_t*)((intptr_t)(h) + (h)->prev_rel))
+#define HEAD_SET_NEXT(h, n) ((h)->next_rel = (int32_t)((intptr_t)(n) - (intptr_t)(h)))
+#define HEAD_SET_PREV(h, n) ((h)->prev_rel = (int32_t)((intptr_t)(n) - (intptr_t)(h)))
+#define HEAD_BASE(o) ((mddl_malllocate_header_t*)(o)->buf)
+#define SIZEOF_SENTINEL SIZEOF_ALLOCATEHEADER
+#define COMPACT_SPAN ((uintptr_t)1 << 30)
+#else
+typedef uintptr_t mddl_mallocater_footer_t;
+#define FOOTER_VALUE(h) ((mddl_mallocater_footer_t)(h))
+#define HEAD_NEXT(h) ((h)->next_p)
+#define HEAD_PREV(h) ((h)->prev_p)
+#define HEAD_SET_NEXT(h, n) ((h)->next_p = (n))
+#define HEAD_SET_PREV(h, n) ((h)->prev_p = (n))
+#define HEAD_BASE(o) (&(o)->base)
+#define SIZEOF_SENTINEL 0
+#endif
+
 #define SIZEOF_ALLOCATEHEADER (sizeof(mddl_malllocate_header_t))
-#define SIZEOF_ALLOCATEFOOTER (sizeof(void*))
-#define HEAD_MAGIC_IS_NG(h) (((h)->stamp.magic_no & ~ALLOCATED_FLAG) != MAGIC_NO )
-#define AREA_FOOTER_IS_NG(h)  (*(uintptr_t*)((uintptr_t)(h) + (h)->size - SIZEOF_ALLOCATEFOOTER) != (uintptr_t)h) 
+#define SIZEOF_ALLOCATEFOOTER (sizeof(mddl_mallocater_footer_t))
+#define HEAD_MAGIC_IS_NG(h) (((h)->stamp.magic_no & ~STAMP_FLAGS) != MAGIC_NO )
+#define AREA_FOOTER_IS_NG(h)  (*(mddl_mallocater_footer_t*)GET_FOOTER_PTR(h) != FOOTER_VALUE(h))
 #define GET_FOOTER_PTR(h) ((void*)((uintptr_t)(h) + (h)->size - SIZEOF_ALLOCATEFOOTER))
+#define SET_FOOTER(h) (*(mddl_mallocater_footer_t*)GET_FOOTER_PTR(h) = FOOTER_VALUE(h))
 #define GET_PTR2HEAD(p) ((mddl_malllocate_header_t*)((uintptr_t)(p) - SIZEOF_ALLOCATEHEADER))
 #define TOTALAREASIZE(z) ((size_t)((((z) + SIZEOF_ALLOCATEHEADER + SIZEOF_ALLOCATEFOOTER) \
 	+ (ALLOCATER_ALIGN - 1 )) &  ~(ALLOCATER_ALIGN - 1)))
@@ -59,12 +111,117 @@ mddl_mallocater_t _mddl_mallocater_heap_obj;
 #define GET_BUFSIZE(h) (size_t)((h)->size - (SIZEOF_ALLOCATEHEADER + SIZEOF_ALLOCATEFOOTER))
 #define AREA_IS_ALLOC(p) ((p)->stamp.occupied & ALLOCATED_FLAG)
 #define AREA_IS_FREE(p) (0x1 & ~AREA_IS_ALLOC(p)) 
+#define AREA_IS_SAMPLED(p) ((p)->stamp.occupied & SAMPLED_FLAG)
+#define AREA_IS_HANDLE(p) ((p)->stamp.occupied & HANDLE_FLAG)
+
+/**
+ * @note 空き領域は、ペイロードの先頭にサイズ別空きリストのリンクを格納します。
+ *	そのため、領域の最小サイズはリンクを格納できる大きさになります。
+ */
+typedef struct _mddl_mallocater_free_links {
+    mddl_malllocate_header_t *next_p;
+    mddl_malllocate_header_t *prev_p;
+} mddl_mallocater_free_links_t;
+
+#define SL_INDEX_COUNT_LOG2 MDDL_MALLOCATER_SL_INDEX_COUNT_LOG2
+#define SL_INDEX_COUNT MDDL_MALLOCATER_SL_INDEX_COUNT
+#define FL_INDEX_SHIFT MDDL_MALLOCATER_FL_INDEX_SHIFT
+#define FL_INDEX_COUNT MDDL_MALLOCATER_FL_INDEX_COUNT
+#define SMALL_BLOCK_SIZE ((size_t)1 << FL_INDEX_SHIFT)
+
+#define SIZEOF_MINAREA TOTALAREASIZE(sizeof(mddl_mallocater_free_links_t))
+#define AREASIZE_OF(z) ((TOTALAREASIZE(z) < SIZEOF_MINAREA) ? SIZEOF_MINAREA : TOTALAREASIZE(z))
+#define GET_FREE_LINKS(h) ((mddl_mallocater_free_links_t*)GET_HEAD2PTR(h))
+#define LONG_SEARCH_LIMIT 32	/* 長寿命の確保で上端から辿る領域数の上限 */
+
+/**
+ * @note 追加領域は先頭に領域記述子を格納した使用中の領域(フェンス)を置き、
+ *	残りを1つの空き領域として領域リストの末尾(baseの直前)に繋ぎます。
+ *	フェンスとbaseは常に使用中なので、空き領域の併合が領域をまたぐことはありません。
+ *	空きリストのインデックスは全領域で共通なので、探索は領域数に依存しません。
+ */
+typedef struct _mddl_mallocater_region {
+    struct _mddl_mallocater_region *next;
+    void *mem;
+    size_t memsiz;
+    union {
+	unsigned int flags;
+	struct {
+	    unsigned int grown:1;	/* 成長用コールバックで確保した */
+	} f;
+    } stat;
+} mddl_mallocater_region_t;
+
+#define SIZEOF_FENCEAREA TOTALAREASIZE(sizeof(mddl_mallocater_region_t))
+#define GET_FENCE_REGION(h) ((mddl_mallocater_region_t*)GET_HEAD2PTR(h))
+#define MMAP_GROW_DEFAULT_CHUNK_SIZE ((size_t)1024 * 1024)
+
+/**
+ * @note 小サイズの割り当ては、サイズクラス毎のスラブから領域ヘッダ無しで切り出します。
+ *	スラブはSLAB_SIZE境界に整列した使用中の領域で、先頭にスラブヘッダと使用中ビットマップを置きます。
+ *	開放時はポインタをSLAB_SIZE境界に切り捨て、そこにこのヒープのスラブヘッダがあればスラブの
+ *	オブジェクトとして扱います。スラブを開放する時はヘッダを消して誤判定を防ぎます。
+ */
+#define SLAB_SIZE ((size_t)MDDL_MALLOCATER_SLAB_SIZE)
+#define SLAB_MAX_SIZE MDDL_MALLOCATER_SLAB_MAX_SIZE
+#define SLAB_CLASS_COUNT MDDL_MALLOCATER_SLAB_CLASS_COUNT
+#define SLAB_MIN_OBJSIZE 8
+#define SLAB_BITMAP_WORDS ((MDDL_MALLOCATER_SLAB_SIZE / SLAB_MIN_OBJSIZE + 31) / 32)
+#define SLAB_MAGIC_NO (((uint32_t)'S' << 24 ) | ((uint32_t)'l' << 16 ) |((uint32_t) 'b' << 8) | 0)
+
+typedef struct _mddl_mallocater_slab {
+    uint32_t magic_no;
+    uint16_t cls;
+    uint16_t objsize;
+    uint16_t nslots;
+    uint16_t nfree;
+    void *owner;		/* 所属するmddl_mallocater_t */
+    struct _mddl_mallocater_slab *self_p; /* 自身のアドレス(判定用) */
+    struct _mddl_mallocater_slab *next_p;
+    struct _mddl_mallocater_slab *prev_p;
+    uint32_t bitmap[SLAB_BITMAP_WORDS]; /* 1:使用中 */
+} mddl_mallocater_slab_t;
+
+#define SIZEOF_SLABHEADER ((sizeof(mddl_mallocater_slab_t) + (ALLOCATER_ALIGN - 1)) & ~(ALLOCATER_ALIGN - 1))
+#define GET_PTR2SLAB(p) ((mddl_mallocater_slab_t*)((uintptr_t)(p) & ~(uintptr_t)(SLAB_SIZE - 1)))
+#define GET_SLAB_OBJ(s, i) ((void*)((uintptr_t)(s) + SIZEOF_SLABHEADER + (size_t)(i) * (s)->objsize))
+
+static const uint16_t slab_class_size_tbl[SLAB_CLASS_COUNT] = {
+    8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256 };
+
+/* (size + 7) / 8 からサイズクラス番号を引くテーブル */
+static const uint8_t slab_class_idx_tbl[(SLAB_MAX_SIZE / SLAB_MIN_OBJSIZE) + 1] = {
+    0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15 };
 
-#ifdef __GNUC__
-__attribute__ ((unused))
-#endif
 static void *own_memmove( void *const dest, const void *const src, const size_t sz);
 static int region_pointer_check(mddl_mallocater_t *const, const mddl_malllocate_header_t * const);
+static void free_index_insert(mddl_mallocater_t *const, mddl_malllocate_header_t *const);
+static void free_index_remove(mddl_mallocater_t *const, mddl_malllocate_header_t *const);
+static mddl_malllocate_header_t *free_index_search(mddl_mallocater_t *const, const size_t);
+static int region_grow(mddl_mallocater_t *const, const size_t);
+static void area_release(mddl_mallocater_t *const, mddl_malllocate_header_t *);
+static size_t area_purge_free(const mddl_mallocater_t *const, const mddl_malllocate_header_t *const, uintptr_t, uintptr_t, const int);
+static void area_split_tail(mddl_mallocater_t *const, mddl_malllocate_header_t *const, const size_t);
+
+#if defined(_MDDL_MALLOCATER_TRACE)
+/**
+ * @note トレース有効時は、以下の公開関数の本体を内部関数として定義し、記録するラッパを別に置きます。
+ *	内部の呼び出し(reallocからのalloc/free等)は記録されず、呼び出し元の操作だけが記録されます。
+ */
+#define mddl_mallocater_alloc_with_obj trace_body_alloc
+#define mddl_mallocater_alloc_hint_with_obj trace_body_alloc_hint
+#define mddl_mallocater_free_with_obj trace_body_free
+#define mddl_mallocater_realloc_with_obj trace_body_realloc
+#define mddl_mallocater_alloc_batch_with_obj trace_body_alloc_batch
+#define mddl_mallocater_free_batch_with_obj trace_body_free_batch
+static void *trace_body_alloc(mddl_mallocater_t *const, const size_t);
+static void *trace_body_alloc_hint(mddl_mallocater_t *const, const size_t, const enum_mddl_mallocater_lifetime_t);
+static void trace_body_free(mddl_mallocater_t *const, void *const);
+static void *trace_body_realloc(mddl_mallocater_t *const, void *const, const size_t);
+static int trace_body_alloc_batch(mddl_mallocater_t *const, const size_t, const size_t, void **const);
+static void trace_body_free_batch(mddl_mallocater_t *const, void **const, const size_t);
+#endif
 
 /**
  * @fn static __inline size_t own_simply_memcpy(void *const oDst, const void *const iSrc, const size_t len)
@@ -99,28 +256,29 @@ static __inline size_t own_simply_memcpy(void *const oDst, const void *const iSr
 }
 
 /**
- * @fn static __inline size_t own_uint32_memcpy(void *oDst, const void *iSrc, const size_t len)
- * @brief uint32_tのサイズコピーするシンプルなデータコピー
+ * @fn static __inline size_t own_word_memcpy(void *const oDst, const void *const iSrc, const size_t len)
+ * @brief uintptr_tのサイズ単位でコピーするシンプルなデータコピー
+ *	oDst, iSrcはどちらもuintptr_tのアライメントに揃っている必要があります。
  * @param oDst コピー先
  * @param iSrc コピー元
  * @param len データ長
  * @return コピーされたバイト数
  */
-static __inline size_t own_uint32_memcpy(void *const oDst, const void *const iSrc,
+static __inline size_t own_word_memcpy(void *const oDst, const void *const iSrc,
 				     const size_t len)
 {
-    size_t i = (len / sizeof(uint32_t));
-    const size_t rlen = i * sizeof(uint32_t);
+    size_t i = (len / sizeof(uintptr_t));
+    const size_t rlen = i * sizeof(uintptr_t);
 
     if( oDst < iSrc ) {
-	const uint32_t *__restrict s_p = (const uint32_t *) (iSrc);
-	uint32_t *__restrict d_p = (uint32_t *) oDst;
+	const uintptr_t *s_p = (const uintptr_t *) (iSrc);
+	uintptr_t *d_p = (uintptr_t *) oDst;
 	for (; i; --i) {
 	    *d_p++ = *s_p++;
         }
     } else if( oDst > iSrc ) {
-	const uint32_t *__restrict s_p = (const uint32_t *) (((uintptr_t)iSrc)+rlen-sizeof(uint32_t));
-	uint32_t *__restrict d_p = (uint32_t *)((uintptr_t)oDst+rlen-sizeof(uint32_t));
+	const uintptr_t *s_p = (const uintptr_t *) (((uintptr_t)iSrc)+rlen-sizeof(uintptr_t));
+	uintptr_t *d_p = (uintptr_t *)((uintptr_t)oDst+rlen-sizeof(uintptr_t));
 	for (; i; --i) {
 	    *d_p-- = *s_p--;
         }
@@ -134,31 +292,310 @@ static __inline size_t own_uint32_memcpy(void *const oDst, const void *const iSr
 /** 
  * @fn static void *own_memmove( void *const dest, const void *const src, const size_t sz)
  * @brief データを移動します
- *   バッファ領域は重なる場合、destが前方にあるときのみ保障します。
+ *   バッファ領域が重なっていても、前方・後方どちらへの移動も保障します。
+ *   dest, srcが共にワード境界に揃っている場合はワード単位で転送します。
  * @param dest 転送先バッファ
  * @param src 転送元バッファ
  * @param sz 転送サイズ
  **/
 static void *own_memmove( void *const dest, const void *const src, const size_t sz)
 {
-    size_t remain = sz, rlen;
-    const uint8_t * __restrict s_p = (const uint8_t*)src;
-    uint8_t * __restrict d_p = (uint8_t*)dest; 
+    const uint8_t *s_p = (const uint8_t*)src;
+    uint8_t *d_p = (uint8_t*)dest; 
+    size_t rlen, remain;
 
     if( src == dest ) {
 	return NULL;
     }
 
-    rlen = own_uint32_memcpy( d_p, s_p, remain);
-    if( (remain -= rlen) != 0  ) {
-	s_p += rlen;
-	d_p += rlen;
-	own_simply_memcpy( d_p, s_p, remain);
+    if( ((uintptr_t)d_p | (uintptr_t)s_p) & (sizeof(uintptr_t) - 1) ) {
+	own_simply_memcpy( d_p, s_p, sz);
+	return dest;
+    }
+
+    rlen = (sz / sizeof(uintptr_t)) * sizeof(uintptr_t);
+    remain = sz - rlen;
+    if( d_p < s_p ) {
+	own_word_memcpy( d_p, s_p, rlen);
+	if( remain ) {
+	    own_simply_memcpy( d_p + rlen, s_p + rlen, remain);
+	}
+    } else {
+	/* 後方へ移動する場合は末尾から転送する */
+	if( remain ) {
+	    own_simply_memcpy( d_p + rlen, s_p + rlen, remain);
+	}
+	own_word_memcpy( d_p, s_p, rlen);
     }
 
     return dest;
 }
 
+/**
+ * @fn static __inline int own_fls_sizet(const size_t x)
+ * @brief 最上位の1ビットの位置を返します
+ * @param x 0以外の値
+ * @return ビット位置(0～)
+ */
+static __inline int own_fls_sizet(const size_t x)
+{
+#if defined(__GNUC__)
+    return (int)(sizeof(unsigned long long) * 8) - 1 - __builtin_clzll((unsigned long long)x);
+#else
+    int n = -1;
+    size_t v = x;
+
+    while(v) {
+	v >>= 1;
+	++n;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @fn static __inline int own_ffs_u32(const uint32_t x)
+ * @brief 最下位の1ビットの位置を返します
+ * @param x 0以外の値
+ * @return ビット位置(0～31)
+ */
+static __inline int own_ffs_u32(const uint32_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    uint32_t v = x;
+
+    while(!(v & 0x1)) {
+	v >>= 1;
+	++n;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @fn static void mapping_insert(const size_t size, int *const fl_p, int *const sl_p)
+ * @brief 領域サイズから格納する空きリストの番号を求めます
+ * @param size 領域サイズ(ヘッダ・フッタ込み)
+ * @param fl_p 第1レベル番号の格納先
+ * @param sl_p 第2レベル番号の格納先
+ */
+static void mapping_insert(const size_t size, int *const fl_p, int *const sl_p)
+{
+    int fl, sl;
+
+    if( size < SMALL_BLOCK_SIZE ) {
+	fl = 0;
+	sl = (int)(size >> MDDL_MALLOCATER_ALIGN_SHIFT);
+    } else {
+	const int f = own_fls_sizet(size);
+	sl = (int)(size >> (f - SL_INDEX_COUNT_LOG2)) ^ (1 << SL_INDEX_COUNT_LOG2);
+	fl = f - (FL_INDEX_SHIFT - 1);
+	if( fl >= FL_INDEX_COUNT ) {
+	    /* 最大を超えるものは最終リストにまとめる */
+	    fl = FL_INDEX_COUNT - 1;
+	    sl = SL_INDEX_COUNT - 1;
+	}
+    }
+
+    *fl_p = fl;
+    *sl_p = sl;
+}
+
+/**
+ * @fn static void mapping_search(const size_t size, int *const fl_p, int *const sl_p)
+ * @brief 要求サイズを満たす空きリストの番号を求めます
+ *	リスト内のどの領域でも要求を満たすように、次の区間の先頭へ切り上げます。
+ * @param size 要求領域サイズ(ヘッダ・フッタ込み)
+ * @param fl_p 第1レベル番号の格納先
+ * @param sl_p 第2レベル番号の格納先
+ */
+static void mapping_search(const size_t size, int *const fl_p, int *const sl_p)
+{
+    size_t rsize = size;
+
+    if( size >= SMALL_BLOCK_SIZE ) {
+	const size_t round = ((size_t)1 << (own_fls_sizet(size) - SL_INDEX_COUNT_LOG2)) - 1;
+	rsize = ((size + round) < size) ? size : (size + round);
+    }
+    mapping_insert( rsize, fl_p, sl_p);
+}
+
+/**
+ * @fn static void free_index_insert(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h)
+ * @brief 空き領域を空きリストの先頭に登録します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 空き領域のヘッダ
+ */
+static void free_index_insert(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h)
+{
+    mddl_mallocater_free_links_t *const l = GET_FREE_LINKS(h);
+    mddl_malllocate_header_t *head;
+    int fl, sl;
+
+    mapping_insert( h->size, &fl, &sl);
+    head = self_p->free_heads[fl][sl];
+
+    l->next_p = head;
+    l->prev_p = NULL;
+    if( NULL != head ) {
+	GET_FREE_LINKS(head)->prev_p = h;
+    }
+    self_p->free_heads[fl][sl] = h;
+    self_p->fl_bitmap |= ((uint32_t)1 << fl);
+    self_p->sl_bitmap[fl] |= ((uint32_t)1 << sl);
+}
+
+/**
+ * @fn static void free_index_remove(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h)
+ * @brief 空き領域を空きリストから外します。サイズを変更する前に呼び出してください
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 空き領域のヘッダ
+ */
+static void free_index_remove(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h)
+{
+    mddl_mallocater_free_links_t *const l = GET_FREE_LINKS(h);
+    int fl, sl;
+
+    mapping_insert( h->size, &fl, &sl);
+
+    if( NULL != l->next_p ) {
+	GET_FREE_LINKS(l->next_p)->prev_p = l->prev_p;
+    }
+    if( NULL != l->prev_p ) {
+	GET_FREE_LINKS(l->prev_p)->next_p = l->next_p;
+    } else {
+	self_p->free_heads[fl][sl] = l->next_p;
+	if( NULL == l->next_p ) {
+	    self_p->sl_bitmap[fl] &= ~((uint32_t)1 << sl);
+	    if( !self_p->sl_bitmap[fl] ) {
+		self_p->fl_bitmap &= ~((uint32_t)1 << fl);
+	    }
+	}
+    }
+    l->next_p = l->prev_p = NULL;
+}
+
+/**
+ * @fn static mddl_malllocate_header_t *free_index_search(mddl_mallocater_t *const self_p, const size_t totalsz)
+ * @brief totalsz以上の空き領域をビットマップから探します
+ *	最終リスト以外では先頭の領域が必ず要求を満たすので、探索はO(1)です。
+ *	上位のリストに空きが無い場合は、totalsz自身が属するリストを辿って収まる領域を探します。
+ *	これにより、要求と同じ区間にしか空きが無い場合も確保できます。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param totalsz 要求領域サイズ(ヘッダ・フッタ込み)
+ * @retval NULL 空き領域がない
+ * @retval NULL以外 空き領域のヘッダ(空きリストからは外していません)
+ */
+static mddl_malllocate_header_t *free_index_search(mddl_mallocater_t *const self_p, const size_t totalsz)
+{
+    mddl_malllocate_header_t *p;
+    uint32_t sl_map;
+    int fl, sl;
+
+    mapping_search( totalsz, &fl, &sl);
+
+    sl_map = self_p->sl_bitmap[fl] & (~(uint32_t)0 << sl);
+    if( !sl_map ) {
+	const uint32_t fl_map = ((fl + 1) < 32) ? (self_p->fl_bitmap & (~(uint32_t)0 << (fl + 1))) : 0;
+	if( fl_map ) {
+	    fl = own_ffs_u32(fl_map);
+	    sl_map = self_p->sl_bitmap[fl];
+	}
+    }
+
+    if( sl_map ) {
+	sl = own_ffs_u32(sl_map);
+	for( p=self_p->free_heads[fl][sl]; NULL != p; p=GET_FREE_LINKS(p)->next_p ) {
+	    if( p->size >= totalsz ) {
+		return p;
+	    }
+	}
+    }
+
+    /* 切り上げた区間に無ければ、要求サイズ自身の区間を先頭から調べる */
+    mapping_insert( totalsz, &fl, &sl);
+    for( p=self_p->free_heads[fl][sl]; NULL != p; p=GET_FREE_LINKS(p)->next_p ) {
+	if( p->size >= totalsz ) {
+	    return p;
+	}
+    }
+
+    return NULL;
+}
+
+/**
+ * @fn static size_t free_index_largest(const mddl_mallocater_t *const self_p)
+ * @brief 最大の空き領域のサイズをビットマップから求めます
+ *	最上位の空きリストだけを調べるので、領域リストの走査は行いません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @return 最大の空き領域のサイズ(空きがない場合は0)
+ */
+static size_t free_index_largest(const mddl_mallocater_t *const self_p)
+{
+    const mddl_malllocate_header_t *p;
+    size_t largest = 0;
+    int fl, sl;
+
+    if( !self_p->fl_bitmap ) {
+	return 0;
+    }
+    fl = own_fls_sizet((size_t)self_p->fl_bitmap);
+    sl = own_fls_sizet((size_t)self_p->sl_bitmap[fl]);
+
+    for( p=self_p->free_heads[fl][sl]; NULL != p; p=GET_FREE_LINKS(p)->next_p ) {
+	if( p->size > largest ) {
+	    largest = p->size;
+	}
+    }
+
+    return largest;
+}
+
+/**
+ * @fn static void stats_add_live(mddl_mallocater_t *const self_p, const size_t add, const size_t sub)
+ * @brief 使用中領域の統計を更新します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param add 増えた領域サイズ
+ * @param sub 減った領域サイズ
+ */
+static __inline void stats_add_live(mddl_mallocater_t *const self_p, const size_t add, const size_t sub)
+{
+    mddl_mallocater_stats_t *const st = &self_p->stats;
+
+    st->live_bytes = st->live_bytes + add - sub;
+    if( st->live_bytes > st->peak_bytes ) {
+	st->peak_bytes = st->live_bytes;
+    }
+}
+
+/**
+ * @fn static void heap_geometry(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsiz)
+ * @brief init_objに渡されたバッファから、管理する範囲を求めます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param buf アロケータで制御するメモリ領域
+ * @param bufsiz bufのサイズ
+ */
+static void heap_geometry(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsiz)
+{
+    mddl_mallocater_t * const o = self_p;
+    const uint8_t align = (uintptr_t)buf & (ALLOCATER_ALIGN -1);
+
+    if( align ) {
+	o->bufofs = ALLOCATER_ALIGN - align;
+	o->buf = (void*)((uintptr_t)buf + o->bufofs);
+	o->bufsiz = bufsiz - o->bufofs;
+    } else {
+	o->bufofs = 0;
+	o->buf = buf;
+	o->bufsiz = bufsiz;
+    }
+    o->bufsiz = TOTALAREASIZE(o->bufsiz - SIZEOF_SENTINEL - TOTALAREASIZE(0) - ALLOCATER_ALIGN);
+    o->initsiz = SIZEOF_SENTINEL + o->bufsiz;
+}
+
 /**
  * @fn int mddl_mallocater_init_obj(mddl_mallocater_t *const self_p, void * const buf, const size_t bufsiz )
  * @brief メモリアロケータオブジェクトインスタンスを初期化します。
@@ -166,51 +603,81 @@ static void *own_memmove( void *const dest, const void *const src, const size_t
  * @param buf アロケータで制御するメモリ領域。
  * @param bufsiz bufのサイズ
  * @retval EBUSY 初期化済みで使用中
+ * @retval ENOMEM bufsizが小さすぎる
+ * @retval ERANGE _MDDL_MALLOCATER_COMPACT_HEADERでbufsizが1GiB以上
  * @retval 0 成功
  **/
 int mddl_mallocater_init_obj(mddl_mallocater_t *const self_p, void * const buf, const size_t bufsiz )
+{
+    return mddl_mallocater_init_obj_ex(self_p, buf, bufsiz, NULL);
+}
+
+/**
+ * @fn int mddl_mallocater_init_obj_ex(mddl_mallocater_t *const self_p, void * const buf, const size_t bufsiz, const mddl_mallocater_attr_t *const attr_p)
+ * @brief 属性を指定してメモリアロケータオブジェクトインスタンスを初期化します。
+ *	attr_p->ext.f.zero_filledを指定すると、bufの0クリアを省くので大きなバッファの全ページに触れません。
+ *	匿名mmapで確保した直後のバッファなどで指定してください。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param buf アロケータで制御するメモリ領域。
+ * @param bufsiz bufのサイズ
+ * @param attr_p 属性(NULLの場合はmddl_mallocater_init_obj()と同じ)
+ * @retval EBUSY 初期化済みで使用中
+ * @retval ENOMEM bufsizが小さすぎる
+ * @retval ERANGE _MDDL_MALLOCATER_COMPACT_HEADERでbufsizが1GiB以上
+ * @retval 0 成功
+ **/
+int mddl_mallocater_init_obj_ex(mddl_mallocater_t *const self_p, void * const buf, const size_t bufsiz, const mddl_mallocater_attr_t *const attr_p)
 {
     int result;
     mddl_mallocater_t * const o = self_p;
-    mddl_malllocate_header_t *h;
-    const uint8_t align = (uintptr_t)buf & (ALLOCATER_ALIGN -1);
+    mddl_malllocate_header_t *h, *b;
 
     DBMS5( "%s : execute buf=0x%p siz=%llu" EOL_CRLF, __func__, buf, bufsiz);
 
     if( bufsiz < (TOTALAREASIZE(1) * 3)) {
 	return ENOMEM;
     }
+#if defined(_MDDL_MALLOCATER_COMPACT_HEADER)
+    if( bufsiz >= COMPACT_SPAN ) {
+	return ERANGE;
+    }
+#endif
 
-    memset(  o, 0x0, sizeof(mddl_malllocate_header_t));
-    memset(buf, 0x0, bufsiz);
+    memset(  o, 0x0, sizeof(mddl_mallocater_t));
+    if( (NULL == attr_p) || !attr_p->ext.f.zero_filled ) {
+	memset(buf, 0x0, bufsiz);
+    }
 
-    if( align ) {
-	o->bufofs = ALLOCATER_ALIGN - align;
-	o->buf = (void*)((uintptr_t)buf + o->bufofs);
-	o->bufsiz = bufsiz - o->bufofs;
-    } else {
-	o->bufofs = 0;
-	o->buf = buf;
-	o->bufsiz = bufsiz;
+    heap_geometry(o, buf, bufsiz);
+    o->check_level = MDDL_MALLOCATER_CHECK_FULL;
+    if( NULL != attr_p ) {
+	o->purge_threshold = attr_p->purge_threshold;
+	o->purge_on_free = (attr_p->ext.f.purge_on_free && attr_p->purge_threshold) ? 1 : 0;
     }
-    o->bufsiz = TOTALAREASIZE(o->bufsiz - TOTALAREASIZE(0) - ALLOCATER_ALIGN);
+#if defined(MDDL_MALLOCATER_HAS_MMAP)
+    o->pagesize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
 
-    o->base.size = 0;
-    o->base.stamp.magic_no = MAGIC_NO;
-    o->base.stamp.occupied |= ALLOCATED_FLAG;
+    b = HEAD_BASE(o);
+    b->size = 0;
+    b->stamp.magic_no = MAGIC_NO;
+    b->stamp.occupied |= ALLOCATED_FLAG;
 
-    h = o->base.next_p = o->base.prev_p =
-	(mddl_malllocate_header_t*)o->buf;
+    h = (mddl_malllocate_header_t*)((uintptr_t)o->buf + SIZEOF_SENTINEL);
+    HEAD_SET_NEXT(b, h);
+    HEAD_SET_PREV(b, h);
 
     h->size = o->bufsiz;
     h->stamp.magic_no = MAGIC_NO;
     h->stamp.occupied &= ~ALLOCATED_FLAG;
-    h->next_p = h->prev_p = &o->base;
-    *(uintptr_t*)GET_FOOTER_PTR(h) = (uintptr_t)h;
+    HEAD_SET_NEXT(h, b);
+    HEAD_SET_PREV(h, b);
+    SET_FOOTER(h);
+    free_index_insert( o, h);
 
     IFDBG5THEN {
 	    DMSG( "self_p=%p : buf=%p bufsiz=%llu, &self_p->base=%p" EOL_CRLF,
-		__func__, self_p, buf, bufsiz, &(self_p->base));
+		__func__, self_p, buf, bufsiz, HEAD_BASE(self_p));
     }
 
     result = region_pointer_check(self_p, h);
@@ -228,158 +695,1271 @@ int mddl_mallocater_init_obj(mddl_mallocater_t *const self_p, void * const buf,
  * @fn int mddl_mallocater_destroy(mddl_mallocater_t *const self_p)
  * @brief メモリアロケータオブジェクトインスタンスを破棄します。
  *	メモリマッピングが後続の処理に影響しないように管理エリアを0クリアします
+ *	成長用コールバックで追加した領域はregion_freeで戻します。
  * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EINVAL 初期化されていない
  */
 int mddl_mallocater_destroy(mddl_mallocater_t *const self_p)
 {
     mddl_mallocater_t * const o = self_p;
+    mddl_mallocater_region_t *r, *next;
 
-    if(self_p->init.f.initialized) {
+    if(!self_p->init.f.initialized) {
 	return EINVAL;
     }
+    if( NULL != o->persist.map ) {
+	/* 永続ヒープの内容は消さずにファイルへ書き戻す */
+	return mddl_mallocater_persist_close_with_obj(o);
+    }
+#if defined(_MDDL_MALLOCATER_TRACE)
+    if( NULL != o->trace.fp ) {
+	mddl_mallocater_trace_stop_with_obj(o);
+    }
+#endif
+
+    /* 記述子は領域の中にあるので、次を取り出してから戻す */
+    for( r=(mddl_mallocater_region_t*)o->regions; NULL != r; r=next ) {
+	next = r->next;
+	if( r->stat.f.grown && (NULL != o->grow.region_free) ) {
+	    o->grow.region_free(o->grow.ctx, r->mem, r->memsiz);
+	}
+    }
+    o->regions = NULL;
 
-    memset( o->buf, 0x0, o->bufsiz); 
+    memset( o->buf, 0x0, o->initsiz); 
     self_p->init.f.initialized = 0;
 
     return 0;
 }
 
-
 /**
- * @fn void *mddl_mallocater_alloc_with_obj(mddl_mallocater_t *const self_p, const size_t sz)
- * @brief メモリの空き領域から線形領域を確保します。
+ * @fn static int region_attach(mddl_mallocater_t *const self_p, void *const mem, const size_t memsiz, const int grown)
+ * @brief 領域をヒープに追加します
  * @param self_p オブジェクトインスタンスポインタ
- * @param sz 確保領域
- * @retval NULL 確保できない
- * @retval NULL以外 確保したメモリのポインタ
- **/
-void *mddl_mallocater_alloc_with_obj(mddl_mallocater_t *const self_p, const size_t sz)
+ * @param mem 追加する領域
+ * @param memsiz memのサイズ
+ * @param grown 成長用コールバックで確保した領域の場合は0以外
+ * @retval 0 成功
+ * @retval ENOMEM 領域が小さすぎる
+ * @retval ERANGE _MDDL_MALLOCATER_COMPACT_HEADERで領域が相対リンクの届く範囲外
+ */
+static int region_attach(mddl_mallocater_t *const self_p, void *const mem, const size_t memsiz, const int grown)
 {
-    mddl_malllocate_header_t *p;
-    int result;
-    const size_t totalsz = TOTALAREASIZE(sz); // Ceilling
-    void *retptr = NULL;
-
-    DBMS5( "mddl_mallocater_alloc_with_obj : execute" EOL_CRLF);
-
-    if(!self_p->init.f.initialized ) {
-	errno = EPERM;
-	return NULL;
-    } else if ( totalsz == 0 ) {
-	// DMSG( "mddl_mallocater_alloc_with_obj : totalsz=0:sz=%d" EOL_CRLF, sz);
-	errno = EINVAL;
-	return NULL;
-    }
-
-    IFDBG3THEN {
-	DBMS3( "%s : header size = %s : malloc size = %s, totalsize = %s" EOL_CRLF,
-	    __func__, SIZEOF_ALLOCATEHEADER, sz, totalsz);
-    }
+    const uintptr_t top = ((uintptr_t)mem + (ALLOCATER_ALIGN - 1)) & ~(uintptr_t)(ALLOCATER_ALIGN - 1);
+    const uintptr_t end = ((uintptr_t)mem + memsiz) & ~(uintptr_t)(ALLOCATER_ALIGN - 1);
+    mddl_malllocate_header_t *fence, *h, *tail;
+    mddl_mallocater_region_t *r;
 
-    /* 指定サイズと同等があるか探す */
-    DBMS3( "%s : search free area of same size" EOL_CRLF, __func__);
-    for( p=self_p->base.next_p; p != &self_p->base; p=p->next_p ) {
-	if( AREA_IS_FREE(p) && (p->size == totalsz)) {
-	    DBMS3( "%s : Found same size area" EOL_CRLF, __func__);
-	    /* ヘッダを使用中にしてバッファエリアのポインタを戻す */
-	    p->stamp.magic_no =  MAGIC_NO;
-	    p->stamp.occupied |= ALLOCATED_FLAG;
-	    *(uintptr_t*)GET_FOOTER_PTR(p) = (uintptr_t)p;
-	    retptr = GET_HEAD2PTR(p);
-	    break;
-        }
+    if( (end < top) || ((end - top) < (SIZEOF_FENCEAREA + SIZEOF_MINAREA)) ) {
+	return ENOMEM;
     }
-
-    IFDBG3THEN {
-	if( NULL == retptr ) {
-	    DBMS3( "%s : Not found same size area" EOL_CRLF, __func__);
-	}
-    }
-
-    /* 指定サイズよりも大きいものを探す */
-    DBMS3( "%s : Search free area of bigger area" EOL_CRLF, __func__);
-    for( p=self_p->base.next_p; (NULL == retptr) && (p != &self_p->base); p=p->next_p ) {
-	if( AREA_IS_FREE(p) && (p->size > totalsz)) {
-	    DBMS3( "Found area" EOL_CRLF);
-	    if((p->size - totalsz) < TOTALAREASIZE(1) ) {
-		/**
-		 * @note 後半ブロックを使うにはサイズが小さすぎるので、
-		 * そのままのサイズを割り当てる
-		 **/
-
-		/* ヘッダの再構成　*/
-		p->stamp.magic_no = MAGIC_NO;
-		p->stamp.occupied |= ALLOCATED_FLAG;
-		*(uintptr_t*)GET_FOOTER_PTR(p) = (uintptr_t)p;
-		retptr = GET_HEAD2PTR(p);
-	    } else {
-		/* 後半を空き領域にする */
-		mddl_malllocate_header_t * const s =
-			(mddl_malllocate_header_t*)((uintptr_t)p+totalsz);
-		s->size = p->size - totalsz;
-		s->stamp.magic_no = MAGIC_NO;
-		s->stamp.occupied &= ~ALLOCATED_FLAG;
-		*(uintptr_t*)GET_FOOTER_PTR(s) = (uintptr_t)s;
-
-		/* sを双方向リンクに追加 */
-		(p->next_p)->prev_p = s;
-		s->next_p = p->next_p;
-		p->next_p = s;
-		s->prev_p = p;
-
-		IFDBG3THEN {
-		    DBMS3( "%s : p=0x%p s=0x%p" EOL_CRLF, __func__, p, s);
-		    DBMS3( "%s : p->prev_p=0x%p p->next_p=0x%p s->prev_p=0x%p s->next_p=0x%p" EOL_CRLF,
-			__func__, p->prev_p, p->next_p, s->prev_p, s->next_p);
-		}
-
-		/* 前半の長さを調整して使用中のマークをつける */
-		p->size = totalsz;
-		p->stamp.magic_no = MAGIC_NO;
-		p->stamp.occupied |= ALLOCATED_FLAG;
-		*(uintptr_t*)GET_FOOTER_PTR(p) = (uintptr_t)p;
-		retptr = GET_HEAD2PTR(p);
-	    }
-	}
+#if defined(_MDDL_MALLOCATER_COMPACT_HEADER)
+    /* 全ての領域がbufから±COMPACT_SPANに収まっていれば、どのリンクも32bitで届く */
+    if( ((top < (uintptr_t)self_p->buf) && (((uintptr_t)self_p->buf - top) >= COMPACT_SPAN))
+	|| ((end > (uintptr_t)self_p->buf) && ((end - (uintptr_t)self_p->buf) >= COMPACT_SPAN)) ) {
+	return ERANGE;
     }
-	   
-    if(NULL != retptr) {
-	p = GET_PTR2HEAD(retptr); 
-	IFDBG3THEN {
-	    DBMS3( "%s : retptr=0x%p" EOL_CRLF, __func__, retptr);
-	}
+#endif
 
-	IFDBG4THEN {
-	    _mddl_mallocater_dump_region_list(self_p);
-	}
+    /* フェンス */
+    fence = (mddl_malllocate_header_t*)top;
+    fence->size = SIZEOF_FENCEAREA;
+    fence->stamp.magic_no = MAGIC_NO;
+    fence->stamp.occupied |= ALLOCATED_FLAG;
+    SET_FOOTER(fence);
+
+    r = GET_FENCE_REGION(fence);
+    r->next = (mddl_mallocater_region_t*)self_p->regions;
+    r->mem = mem;
+    r->memsiz = memsiz;
+    r->stat.flags = 0;
+    r->stat.f.grown = (grown) ? 1 : 0;
+    self_p->regions = r;
+
+    /* 残りを空き領域にする */
+    h = (mddl_malllocate_header_t*)(top + SIZEOF_FENCEAREA);
+    h->size = (size_t)(end - (uintptr_t)h);
+    h->stamp.magic_no = MAGIC_NO;
+    h->stamp.occupied &= ~ALLOCATED_FLAG;
+    SET_FOOTER(h);
 
-	result = region_pointer_check(self_p, p);
-	if(result) {
-	    // DMSG("%s : post(0x%08x) check is error" EOL_CRLF, myfunc, (uintptr_t)p);
-	    // _mddl_mallocater_dump_region_list(self_p);
-	    abort();
-	}
-    	return retptr;
-    }
+    /* 領域リストの末尾にfence, hの順で繋ぐ */
+    tail = HEAD_PREV(HEAD_BASE(self_p));
+    HEAD_SET_NEXT(tail, fence);
+    HEAD_SET_PREV(fence, tail);
+    HEAD_SET_NEXT(fence, h);
+    HEAD_SET_PREV(h, fence);
+    HEAD_SET_NEXT(h, HEAD_BASE(self_p));
+    HEAD_SET_PREV(HEAD_BASE(self_p), h);
 
-    // DMSG("%s : ENOMEM" EOL_CRLF, myfunc);
+    free_index_insert(self_p, h);
+    self_p->bufsiz += h->size;
 
-    /* 空き領域を用意できなかった */
-    errno = ENOMEM;
-    return NULL;
+    return 0;
 }
 
-static int region_pointer_check(mddl_mallocater_t *const self_p, const mddl_malllocate_header_t * const cur)
+/**
+ * @fn static int region_grow(mddl_mallocater_t *const self_p, const size_t totalsz)
+ * @brief 成長用コールバックで領域を確保してヒープに追加します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param totalsz 追加後に確保したい領域サイズ(ヘッダ・フッタ込み)
+ * @retval 0 成功
+ * @retval ENOMEM 確保できない、またはコールバックが設定されていない
+ */
+static int region_grow(mddl_mallocater_t *const self_p, const size_t totalsz)
 {
-    const mddl_malllocate_header_t *p = cur->prev_p, *n = cur->next_p;
-    int result = 0;
+    const mddl_mallocater_grow_t *const g = &self_p->grow;
+    size_t size = totalsz + SIZEOF_FENCEAREA + (ALLOCATER_ALIGN * 2);
+    void *mem;
+    int result;
 
-    /* 指定位置の周囲のポインタがあっているかチェックする */
+    if( (NULL == g->region_alloc) || (size < totalsz) ) {
+	return ENOMEM;
+    }
+    if( size < g->chunk_size ) {
+	size = g->chunk_size;
+    }
 
-    /* 現在地 */
-    if( HEAD_MAGIC_IS_NG(cur) ) {
-	// DMSG(  "cur(%08x)  MAGIC no is ignore, or invalid" EOL_CRLF, c);
-	result |= ~0;
+    mem = g->region_alloc(g->ctx, &size);
+    if( NULL == mem ) {
+	DBMS1( "%s : region_alloc fail" EOL_CRLF, __func__);
+	return ENOMEM;
+    }
+
+    result = region_attach(self_p, mem, size, 1);
+    if( result && (NULL != g->region_free) ) {
+	g->region_free(g->ctx, mem, size);
+    }
+
+    return result;
+}
+
+/**
+ * @fn int mddl_mallocater_add_region_with_obj(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsiz)
+ * @brief 利用者のバッファを管理する領域として追加します
+ *	bufはmddl_mallocater_destroy()まで使用します。destroyでbufは戻しません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param buf 追加するバッファ
+ * @param bufsiz bufのサイズ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない、または永続ヒープ
+ * @retval EINVAL bufがNULL
+ * @retval ENOMEM bufが小さすぎる
+ * @retval ERANGE _MDDL_MALLOCATER_COMPACT_HEADERでbufが初期バッファから±1GiBの範囲外
+ **/
+int mddl_mallocater_add_region_with_obj(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsiz)
+{
+    if(!self_p->init.f.initialized || (NULL != self_p->persist.map) ) {
+	return EPERM;
+    } else if( NULL == buf ) {
+	return EINVAL;
+    }
+
+    return region_attach(self_p, buf, bufsiz, 0);
+}
+
+/**
+ * @fn int mddl_mallocater_set_grow_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_grow_t *const grow_p)
+ * @brief 空き領域が足りない時に領域を追加する成長用コールバックを設定します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param grow_p コールバック(NULLの場合は成長しない)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない、または永続ヒープ
+ * @retval EINVAL region_allocが設定されていない
+ **/
+int mddl_mallocater_set_grow_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_grow_t *const grow_p)
+{
+    if(!self_p->init.f.initialized || ((NULL != self_p->persist.map) && (NULL != grow_p)) ) {
+	return EPERM;
+    }
+
+    if( NULL == grow_p ) {
+	memset( &self_p->grow, 0x0, sizeof(mddl_mallocater_grow_t));
+	return 0;
+    } else if( NULL == grow_p->region_alloc ) {
+	return EINVAL;
+    }
+    self_p->grow = *grow_p;
+
+    return 0;
+}
+
+#if defined(MDDL_MALLOCATER_HAS_MMAP)
+static void *mmap_region_alloc(void *const ctx, size_t *const size_p)
+{
+    const long pagesz = sysconf(_SC_PAGESIZE);
+    const size_t pz = (pagesz > 0) ? (size_t)pagesz : 4096;
+    const size_t size = (*size_p + (pz - 1)) & ~(pz - 1);
+    void *mem;
+
+    (void)ctx;
+    if( size < *size_p ) {
+	return NULL;
+    }
+
+    mem = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if( MAP_FAILED == mem ) {
+	return NULL;
+    }
+    *size_p = size;
+
+    return mem;
+}
+
+static void mmap_region_free(void *const ctx, void *const mem, const size_t size)
+{
+    (void)ctx;
+    munmap( mem, size);
+}
+#endif
+
+/**
+ * @fn int mddl_mallocater_set_mmap_grow_with_obj(mddl_mallocater_t *const self_p, const size_t chunk_size)
+ * @brief 匿名mmapで領域を追加する成長用コールバックを設定します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param chunk_size 1回に追加する最小サイズ(0の場合は1MiB。ページサイズに切り上げます)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval ENOSYS mmapが使えない環境
+ **/
+int mddl_mallocater_set_mmap_grow_with_obj(mddl_mallocater_t *const self_p, const size_t chunk_size)
+{
+#if defined(MDDL_MALLOCATER_HAS_MMAP)
+    mddl_mallocater_grow_t grow;
+
+    grow.region_alloc = mmap_region_alloc;
+    grow.region_free = mmap_region_free;
+    grow.ctx = NULL;
+    grow.chunk_size = (0 == chunk_size) ? MMAP_GROW_DEFAULT_CHUNK_SIZE : chunk_size;
+
+    return mddl_mallocater_set_grow_with_obj(self_p, &grow);
+#else
+    (void)self_p;
+    (void)chunk_size;
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn static int area_in_heap(const mddl_mallocater_t *const self_p, const void *const mem, const size_t size)
+ * @brief メモリ範囲がヒープの管理する領域(初期バッファまたは追加領域)に収まっているかを調べます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param mem 先頭アドレス
+ * @param size サイズ
+ * @retval 0 収まっていない
+ * @retval 1 収まっている
+ */
+static int area_in_heap(const mddl_mallocater_t *const self_p, const void *const mem, const size_t size)
+{
+    const uintptr_t top = (uintptr_t)mem;
+    const mddl_mallocater_region_t *r;
+
+    if( (top >= (uintptr_t)self_p->buf) && ((top - (uintptr_t)self_p->buf) <= self_p->initsiz)
+	&& (size <= (self_p->initsiz - (top - (uintptr_t)self_p->buf))) ) {
+	return 1;
+    }
+    for( r=(const mddl_mallocater_region_t*)self_p->regions; NULL != r; r=r->next ) {
+	if( (top >= (uintptr_t)r->mem) && ((top - (uintptr_t)r->mem) <= r->memsiz)
+	    && (size <= (r->memsiz - (top - (uintptr_t)r->mem))) ) {
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/**
+ * @fn static mddl_mallocater_slab_t *slab_lookup(mddl_mallocater_t *const self_p, const void *const ptr)
+ * @brief ポインタがスラブから割り当てたオブジェクトであれば、そのスラブを返します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param ptr 調べるポインタ
+ * @retval NULL スラブのオブジェクトではない
+ * @retval NULL以外 スラブヘッダ
+ */
+static mddl_mallocater_slab_t *slab_lookup(mddl_mallocater_t *const self_p, const void *const ptr)
+{
+    mddl_mallocater_slab_t *const s = GET_PTR2SLAB(ptr);
+
+    if( !self_p->slab_cnt ) {
+	return NULL;
+    }
+    if( ((uintptr_t)ptr - (uintptr_t)s) < SIZEOF_SLABHEADER ) {
+	return NULL;
+    }
+    if( !area_in_heap(self_p, s, SIZEOF_SLABHEADER) ) {
+	return NULL;
+    }
+    if( (s->magic_no != SLAB_MAGIC_NO) || (s->owner != (void*)self_p) || (s->self_p != s) ) {
+	return NULL;
+    }
+
+    return s;
+}
+
+/**
+ * @fn static void slab_list_push(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s)
+ * @brief スラブを空きのあるスラブのリストの先頭に繋ぎます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param s スラブヘッダ
+ */
+static void slab_list_push(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s)
+{
+    mddl_mallocater_slab_t *const head = (mddl_mallocater_slab_t*)self_p->slab_partial[s->cls];
+
+    s->prev_p = NULL;
+    s->next_p = head;
+    if( NULL != head ) {
+	head->prev_p = s;
+    }
+    self_p->slab_partial[s->cls] = s;
+}
+
+/**
+ * @fn static void slab_list_remove(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s)
+ * @brief スラブを空きのあるスラブのリストから外します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param s スラブヘッダ
+ */
+static void slab_list_remove(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s)
+{
+    if( NULL != s->next_p ) {
+	s->next_p->prev_p = s->prev_p;
+    }
+    if( NULL != s->prev_p ) {
+	s->prev_p->next_p = s->next_p;
+    } else {
+	self_p->slab_partial[s->cls] = s->next_p;
+    }
+    s->next_p = s->prev_p = NULL;
+}
+
+/**
+ * @fn static mddl_malllocate_header_t *slab_area_search(mddl_mallocater_t *const self_p, const size_t needsz)
+ * @brief スラブを切り出す空き領域を探します。足りなければ領域を追加して探し直します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param needsz 必要な領域サイズ(ヘッダ・フッタ込み)
+ * @retval NULL 空き領域がない
+ * @retval NULL以外 空き領域のヘッダ(空きリストからは外していません)
+ */
+static mddl_malllocate_header_t *slab_area_search(mddl_mallocater_t *const self_p, const size_t needsz)
+{
+    mddl_malllocate_header_t *p = free_index_search(self_p, needsz);
+
+    if( (NULL == p) && (NULL != self_p->grow.region_alloc) ) {
+	if( !region_grow(self_p, needsz) ) {
+	    p = free_index_search(self_p, needsz);
+	}
+    }
+
+    return p;
+}
+
+/**
+ * @fn static mddl_mallocater_slab_t *slab_create(mddl_mallocater_t *const self_p, const int cls)
+ * @brief 空き領域からSLAB_SIZE境界に整列したスラブを切り出します
+ *	整列で余った前後の部分は空き領域として戻します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param cls サイズクラス番号
+ * @retval NULL 空き領域が足りない
+ * @retval NULL以外 作成したスラブ(空きのあるスラブのリストに繋いでいます)
+ */
+static mddl_mallocater_slab_t *slab_create(mddl_mallocater_t *const self_p, const int cls)
+{
+    const size_t needsz = TOTALAREASIZE(SLAB_SIZE) + SLAB_SIZE + SIZEOF_MINAREA;
+    mddl_malllocate_header_t *p, *h;
+    mddl_mallocater_slab_t *s;
+    uintptr_t top;
+    unsigned int n;
+
+    p = slab_area_search(self_p, needsz);
+    if( NULL == p ) {
+	return NULL;
+    }
+    free_index_remove(self_p, p);
+
+    /* ペイロードがSLAB_SIZE境界になる位置にヘッダを置く */
+    top = ((uintptr_t)p + SIZEOF_ALLOCATEHEADER + (SLAB_SIZE - 1)) & ~(uintptr_t)(SLAB_SIZE - 1);
+    h = GET_PTR2HEAD(top);
+    if( (h != p) && (((uintptr_t)h - (uintptr_t)p) < SIZEOF_MINAREA) ) {
+	h = (mddl_malllocate_header_t*)((uintptr_t)h + SLAB_SIZE);
+    }
+    if( h != p ) {
+	/* 前半を空き領域として残す */
+	h->size = p->size - ((uintptr_t)h - (uintptr_t)p);
+	HEAD_SET_NEXT(h, HEAD_NEXT(p));
+	HEAD_SET_PREV(HEAD_NEXT(p), h);
+	HEAD_SET_NEXT(p, h);
+	HEAD_SET_PREV(h, p);
+	p->size = (uintptr_t)h - (uintptr_t)p;
+	SET_FOOTER(p);
+	free_index_insert(self_p, p);
+    }
+    h->stamp.magic_no = MAGIC_NO;
+    h->stamp.occupied |= ALLOCATED_FLAG;
+    SET_FOOTER(h);
+    area_split_tail(self_p, h, TOTALAREASIZE(SLAB_SIZE));
+    stats_add_live(self_p, h->size, 0);
+    ++(self_p->stats.live_blocks);
+
+    /* スラブヘッダ */
+    s = (mddl_mallocater_slab_t*)GET_HEAD2PTR(h);
+    memset(s, 0x0, SIZEOF_SLABHEADER);
+    s->magic_no = SLAB_MAGIC_NO;
+    s->cls = (uint16_t)cls;
+    s->objsize = slab_class_size_tbl[cls];
+    s->nslots = (uint16_t)((SLAB_SIZE - SIZEOF_SLABHEADER) / s->objsize);
+    s->nfree = s->nslots;
+    s->owner = self_p;
+    s->self_p = s;
+    /* スロットの無いビットは使用中にしておく */
+    for( n=s->nslots; n < (SLAB_BITMAP_WORDS * 32); ++n ) {
+	s->bitmap[n >> 5] |= ((uint32_t)1 << (n & 31));
+    }
+    slab_list_push(self_p, s);
+    ++(self_p->slab_cnt);
+
+    DBMS3( "%s : slab=0x%p cls=%d nslots=%u" EOL_CRLF, __func__, s, cls, s->nslots);
+
+    return s;
+}
+
+/**
+ * @fn static void slab_destroy(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s)
+ * @brief 空になったスラブをヒープに戻します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param s スラブヘッダ(空きのあるスラブのリストに繋がっていること)
+ */
+static void slab_destroy(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s)
+{
+    slab_list_remove(self_p, s);
+    s->magic_no = 0;
+    s->owner = NULL;
+    s->self_p = NULL;
+    --(self_p->slab_cnt);
+
+    area_release(self_p, GET_PTR2HEAD(s));
+}
+
+/**
+ * @fn static void *slab_alloc(mddl_mallocater_t *const self_p, const size_t sz)
+ * @brief スラブから小オブジェクトを割り当てます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param sz 要求サイズ(SLAB_MAX_SIZE以下)
+ * @retval NULL スラブを用意できない
+ * @retval NULL以外 割り当てたオブジェクト
+ */
+static void *slab_alloc(mddl_mallocater_t *const self_p, const size_t sz)
+{
+    const int cls = slab_class_idx_tbl[(sz + (SLAB_MIN_OBJSIZE - 1)) / SLAB_MIN_OBJSIZE];
+    mddl_mallocater_slab_t *s = (mddl_mallocater_slab_t*)self_p->slab_partial[cls];
+    unsigned int w, idx;
+
+    if( NULL == s ) {
+	s = slab_create(self_p, cls);
+	if( NULL == s ) {
+	    return NULL;
+	}
+    }
+
+    for( w=0; s->bitmap[w] == ~(uint32_t)0; ++w );
+    idx = (unsigned int)own_ffs_u32(~s->bitmap[w]);
+    s->bitmap[w] |= ((uint32_t)1 << idx);
+    idx += w * 32;
+
+    if( 0 == --(s->nfree) ) {
+	slab_list_remove(self_p, s);
+    }
+    ++(self_p->stats.slab_objs);
+
+    return GET_SLAB_OBJ(s, idx);
+}
+
+/**
+ * @fn static void slab_free(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s, void *const ptr)
+ * @brief スラブのオブジェクトを開放します。スラブが空になり、同じクラスに他の空きスラブがあればヒープに戻します
+ *	スロットの先頭でないポインタや、開放済みのスロットの場合はabort()します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param s スラブヘッダ
+ * @param ptr 開放するオブジェクト
+ */
+static void slab_free(mddl_mallocater_t *const self_p, mddl_mallocater_slab_t *const s, void *const ptr)
+{
+    const size_t ofs = (uintptr_t)ptr - (uintptr_t)s - SIZEOF_SLABHEADER;
+    const size_t idx = ofs / s->objsize;
+    const uint32_t bit = (uint32_t)1 << (idx & 31);
+
+    if( (ofs % s->objsize) || (idx >= s->nslots) || !(s->bitmap[idx >> 5] & bit) ) {
+	DBMS("%s : invalid slab pointer 0x%p" EOL_CRLF, __func__, ptr);
+	abort();
+    }
+    s->bitmap[idx >> 5] &= ~bit;
+    --(self_p->stats.slab_objs);
+
+    if( 0 == (s->nfree)++ ) {
+	slab_list_push(self_p, s);
+    }
+    if( (s->nfree == s->nslots) && ((NULL != s->prev_p) || (NULL != s->next_p)) ) {
+	slab_destroy(self_p, s);
+    }
+}
+
+/**
+ * @fn int mddl_mallocater_set_slab_with_obj(mddl_mallocater_t *const self_p, const int enable)
+ * @brief MDDL_MALLOCATER_SLAB_MAX_SIZE以下の割り当てにスラブを使うかを設定します
+ *	スラブのオブジェクトは領域ヘッダ・フッタを持たないので、小さな割り当てのオーバーヘッドが減ります。
+ *	スラブはMDDL_MALLOCATER_SLAB_SIZE単位でヒープから確保します。
+ *	無効にした後もスラブから割り当て済みのオブジェクトは通常通り開放できます。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param enable 0以外:有効 0:無効(初期値)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない、または永続ヒープ(スラブは絶対アドレスを持つため)
+ **/
+int mddl_mallocater_set_slab_with_obj(mddl_mallocater_t *const self_p, const int enable)
+{
+    if(!self_p->init.f.initialized || ((NULL != self_p->persist.map) && enable) ) {
+	return EPERM;
+    }
+    self_p->slab_enable = (enable) ? 1 : 0;
+
+    return 0;
+}
+
+/**
+ * @note 割り当てプロファイラの管理領域です。
+ *	抜き取った領域はヘッダにSAMPLED_FLAGを立て、samples[]にポインタをキーとした開番地法で登録します。
+ *	抜き取りの間隔は平均intervalの指数分布なので、大きな割り当てほど抜き取られやすくなります。
+ */
+#define PROF_SKIP_FRAMES 2	/* prof_track()とmddl_mallocater_alloc_with_obj()の分 */
+#define PROF_SAMPLE_LIMIT ((MDDL_MALLOCATER_PROF_SAMPLE_COUNT * 3) / 4)
+
+typedef struct _mddl_mallocater_prof_sample {
+    const void *ptr;		/* NULLは未使用 */
+    uint32_t site;
+    size_t weight;		/* この抜き取りが代表する推定バイト数 */
+} mddl_mallocater_prof_sample_t;
+
+typedef struct _mddl_mallocater_prof {
+    size_t interval;
+    int64_t bytes_until_sample;
+    uint64_t rnd;
+    size_t nsites;
+    size_t nsamples;
+    uint64_t dropped;		/* 表が一杯で記録できなかった抜き取り数 */
+    uint8_t dump_on_failure;
+    mddl_mallocater_prof_site_t sites[MDDL_MALLOCATER_PROF_SITE_COUNT];
+    mddl_mallocater_prof_sample_t samples[MDDL_MALLOCATER_PROF_SAMPLE_COUNT];
+} mddl_mallocater_prof_t;
+
+/**
+ * @fn static int64_t prof_next_interval(mddl_mallocater_prof_t *const pf)
+ * @brief 次に抜き取るまでのバイト数を平均intervalの指数分布から求めます
+ *	-ln(u)はlog2の区分近似で求めるので、libmは使いません。
+ * @param pf プロファイラ
+ * @return 次に抜き取るまでのバイト数(1以上)
+ */
+static int64_t prof_next_interval(mddl_mallocater_prof_t *const pf)
+{
+    uint32_t r;
+    int msb;
+    double f, nlog2u;
+
+    pf->rnd ^= pf->rnd << 13;
+    pf->rnd ^= pf->rnd >> 7;
+    pf->rnd ^= pf->rnd << 17;
+    r = (uint32_t)(pf->rnd >> 32) | 1;
+
+    /* u = r / 2^32, -log2(u) = 32 - log2(r), log2(1+f) ≒ f * (1.3465 - 0.3465 * f) */
+    msb = own_fls_sizet((size_t)r);
+    f = (double)(r - ((uint32_t)1 << msb)) / (double)((uint32_t)1 << msb);
+    nlog2u = 32.0 - ((double)msb + (f * (1.3465 - (0.3465 * f))));
+
+    return (int64_t)(nlog2u * 0.6931471805599453 * (double)pf->interval) + 1;
+}
+
+/**
+ * @fn static __inline int prof_should_sample(mddl_mallocater_t *const self_p, const size_t sz)
+ * @brief 今回の割り当てを抜き取るかを判定します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param sz 要求サイズ
+ * @retval 0 抜き取らない
+ * @retval 0以外 抜き取る
+ */
+static __inline int prof_should_sample(mddl_mallocater_t *const self_p, const size_t sz)
+{
+    mddl_mallocater_prof_t *const pf = (mddl_mallocater_prof_t*)self_p->prof;
+
+    if( NULL == pf ) {
+	return 0;
+    }
+    pf->bytes_until_sample -= (int64_t)sz;
+    if( pf->bytes_until_sample > 0 ) {
+	return 0;
+    }
+    pf->bytes_until_sample = prof_next_interval(pf);
+
+    return 1;
+}
+
+/**
+ * @fn static size_t prof_weight(const mddl_mallocater_prof_t *const pf, const size_t sz)
+ * @brief 抜き取った割り当てが代表するバイト数を求めます
+ *	大きさszが抜き取られる確率p = 1 - exp(-sz / interval)の逆数を掛けた sz / p です。
+ */
+static size_t prof_weight(const mddl_mallocater_prof_t *const pf, const size_t sz)
+{
+    const double x = (double)sz / (double)pf->interval;
+    double y = x / 256.0, e, p;
+    int n;
+
+    if( x > 32.0 ) {
+	return sz;
+    }
+    /* exp(-x) = exp(-x/256)^256 */
+    e = 1.0 - y + ((y * y) / 2.0) - ((y * y * y) / 6.0);
+    for( n=0; n < 8; ++n ) {
+	e *= e;
+    }
+    p = 1.0 - e;
+
+    return (p > 0.0) ? (size_t)((double)sz / p) : pf->interval;
+}
+
+/**
+ * @fn static size_t prof_sample_pos(const mddl_mallocater_prof_t *const pf, const void *const ptr)
+ * @brief samples[]のptrの位置(無ければ登録すべき空きの位置)を求めます
+ */
+static size_t prof_sample_pos(const mddl_mallocater_prof_t *const pf, const void *const ptr)
+{
+    size_t i = (size_t)((((uintptr_t)ptr >> 3) * (uintptr_t)0x9E3779B1u) % MDDL_MALLOCATER_PROF_SAMPLE_COUNT);
+
+    while( (NULL != pf->samples[i].ptr) && (ptr != pf->samples[i].ptr) ) {
+	i = (i + 1) % MDDL_MALLOCATER_PROF_SAMPLE_COUNT;
+    }
+    return i;
+}
+
+/**
+ * @fn static int prof_sample_take(mddl_mallocater_prof_t *const pf, const void *const ptr, mddl_mallocater_prof_sample_t *const smp_p)
+ * @brief samples[]からptrを取り出します。後続のエントリは詰め直します。
+ * @retval 0 取り出した
+ * @retval ENOENT 登録されていない
+ */
+static int prof_sample_take(mddl_mallocater_prof_t *const pf, const void *const ptr, mddl_mallocater_prof_sample_t *const smp_p)
+{
+    const size_t i = prof_sample_pos(pf, ptr);
+    size_t j;
+
+    if( NULL == pf->samples[i].ptr ) {
+	return ENOENT;
+    }
+    *smp_p = pf->samples[i];
+    pf->samples[i].ptr = NULL;
+    --(pf->nsamples);
+
+    for( j = (i + 1) % MDDL_MALLOCATER_PROF_SAMPLE_COUNT; NULL != pf->samples[j].ptr;
+	    j = (j + 1) % MDDL_MALLOCATER_PROF_SAMPLE_COUNT ) {
+	const mddl_mallocater_prof_sample_t s = pf->samples[j];
+
+	pf->samples[j].ptr = NULL;
+	pf->samples[prof_sample_pos(pf, s.ptr)] = s;
+    }
+    return 0;
+}
+
+/**
+ * @fn static int prof_site_find(mddl_mallocater_prof_t *const pf, void *const *const frames, const uint32_t depth)
+ * @brief バックトレースに対応する呼び出し元の番号を求めます。無ければ登録します。
+ * @retval -1 表が一杯
+ * @retval 0以上 sites[]の番号
+ */
+static int prof_site_find(mddl_mallocater_prof_t *const pf, void *const *const frames, const uint32_t depth)
+{
+    uint32_t hash = 2166136261u, n;
+    size_t i;
+
+    for( n=0; n < depth; ++n ) {
+	hash = (hash ^ (uint32_t)((uintptr_t)frames[n] >> 2)) * 16777619u;
+    }
+
+    for( i = hash % MDDL_MALLOCATER_PROF_SITE_COUNT, n=0; n < MDDL_MALLOCATER_PROF_SITE_COUNT;
+	    i = (i + 1) % MDDL_MALLOCATER_PROF_SITE_COUNT, ++n ) {
+	mddl_mallocater_prof_site_t *const st = &pf->sites[i];
+
+	if( 0 == st->depth ) {
+	    memcpy(st->frames, frames, sizeof(void*) * depth);
+	    st->depth = depth;
+	    st->hash = hash;
+	    ++(pf->nsites);
+	    return (int)i;
+	}
+	if( (st->hash == hash) && (st->depth == depth)
+		&& !memcmp(st->frames, frames, sizeof(void*) * depth) ) {
+	    return (int)i;
+	}
+    }
+    return -1;
+}
+
+/**
+ * @fn static void prof_track(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h, const size_t sz, void *const caller)
+ * @brief 抜き取った割り当てを呼び出し元に計上します
+ *	バックトレースが取れない環境では、直接の呼び出し元だけを記録します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 割り当てた領域のヘッダ
+ * @param sz 要求サイズ
+ * @param caller mddl_mallocater_alloc_with_obj()の呼び出し元
+ */
+#if defined(__GNUC__)
+__attribute__ ((noinline))
+#endif
+static void prof_track(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h, const size_t sz, void *const caller)
+{
+    mddl_mallocater_prof_t *const pf = (mddl_mallocater_prof_t*)self_p->prof;
+    void *frames[MDDL_MALLOCATER_PROF_DEPTH + PROF_SKIP_FRAMES];
+    mddl_mallocater_prof_sample_t *smp;
+    mddl_mallocater_prof_site_t *st;
+    const void *const ptr = GET_HEAD2PTR(h);
+    uint32_t depth;
+    int site;
+
+    if( pf->nsamples >= PROF_SAMPLE_LIMIT ) {
+	++(pf->dropped);
+	return;
+    }
+
+#if defined(MDDL_MALLOCATER_HAS_BACKTRACE)
+    {
+	const int n = backtrace(frames, MDDL_MALLOCATER_PROF_DEPTH + PROF_SKIP_FRAMES);
+	depth = (n > PROF_SKIP_FRAMES) ? (uint32_t)(n - PROF_SKIP_FRAMES) : 0;
+	if( depth ) {
+	    memmove(frames, &frames[PROF_SKIP_FRAMES], sizeof(void*) * depth);
+	}
+    }
+#else
+    depth = 0;
+#endif
+    if( 0 == depth ) {
+	frames[0] = caller;
+	depth = 1;
+    }
+
+    site = prof_site_find(pf, frames, depth);
+    if( site < 0 ) {
+	++(pf->dropped);
+	return;
+    }
+    st = &pf->sites[site];
+
+    smp = &pf->samples[prof_sample_pos(pf, ptr)];
+    smp->ptr = ptr;
+    smp->site = (uint32_t)site;
+    smp->weight = prof_weight(pf, sz);
+    ++(pf->nsamples);
+
+    st->live_bytes += smp->weight;
+    ++(st->live_samples);
+    st->total_bytes += smp->weight;
+    ++(st->total_samples);
+
+    h->stamp.occupied |= SAMPLED_FLAG;
+}
+
+/**
+ * @fn static void prof_untrack(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h)
+ * @brief 抜き取った領域の開放を呼び出し元の使用中バイト数から差し引きます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 開放する領域のヘッダ(SAMPLED_FLAGが立っているもの)
+ */
+static void prof_untrack(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h)
+{
+    mddl_mallocater_prof_t *const pf = (mddl_mallocater_prof_t*)self_p->prof;
+    mddl_mallocater_prof_sample_t smp;
+
+    h->stamp.occupied &= ~SAMPLED_FLAG;
+    if( (NULL == pf) || prof_sample_take(pf, GET_HEAD2PTR(h), &smp) ) {
+	/* 計測を止めた後、または再開する前の抜き取り */
+	return;
+    }
+    pf->sites[smp.site].live_bytes -= smp.weight;
+    --(pf->sites[smp.site].live_samples);
+}
+
+/**
+ * @fn static void prof_move(mddl_mallocater_t *const self_p, const void *const old_ptr, mddl_malllocate_header_t *const h)
+ * @brief 抜き取った領域がreallocで移動した時に登録を付け替えます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param old_ptr 移動前のポインタ
+ * @param h 移動後の領域のヘッダ
+ */
+static void prof_move(mddl_mallocater_t *const self_p, const void *const old_ptr, mddl_malllocate_header_t *const h)
+{
+    mddl_mallocater_prof_t *const pf = (mddl_mallocater_prof_t*)self_p->prof;
+    mddl_mallocater_prof_sample_t smp;
+
+    if( (NULL == pf) || prof_sample_take(pf, old_ptr, &smp) ) {
+	return;
+    }
+    smp.ptr = GET_HEAD2PTR(h);
+    pf->samples[prof_sample_pos(pf, smp.ptr)] = smp;
+    ++(pf->nsamples);
+    h->stamp.occupied |= SAMPLED_FLAG;
+}
+
+/**
+ * @fn static void prof_on_failure(mddl_mallocater_t *const self_p)
+ * @brief 割り当てに失敗した時、指定があれば呼び出し元毎の使用量を出力します
+ */
+static void prof_on_failure(mddl_mallocater_t *const self_p)
+{
+    const mddl_mallocater_prof_t *const pf = (const mddl_mallocater_prof_t*)self_p->prof;
+
+    if( (NULL != pf) && pf->dump_on_failure ) {
+	mddl_mallocater_prof_dump_with_obj(self_p);
+    }
+}
+
+/**
+ * @fn int mddl_mallocater_prof_start_with_obj(mddl_mallocater_t *const self_p, const size_t interval, const int dump_on_failure)
+ * @brief 割り当てプロファイラを開始します
+ *	mddl_mallocater_alloc_with_obj()とmddl_mallocater_alloc_hint_with_obj()の割り当てを、
+ *	平均intervalバイトに1回抜き取ってバックトレースを記録します。抜き取らない割り当ての
+ *	オーバーヘッドはカウンタの減算1回なので、運用中も有効にしておけます。
+ *	抜き取った割り当てはスラブを使わずに通常の領域から確保します。バッチ割り当ては抜き取りません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param interval 平均の抜き取り間隔(バイト)。tcmallocの既定値は512KiB
+ * @param dump_on_failure 0以外:割り当て失敗時にmddl_mallocater_prof_dump_with_obj()を呼ぶ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL intervalが0
+ * @retval EBUSY 開始済み
+ * @retval ENOMEM 管理領域を確保できない
+ */
+int mddl_mallocater_prof_start_with_obj(mddl_mallocater_t *const self_p, const size_t interval, const int dump_on_failure)
+{
+    mddl_mallocater_prof_t *pf;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( 0 == interval ) {
+	return EINVAL;
+    } else if( NULL != self_p->prof ) {
+	return EBUSY;
+    }
+
+    pf = (mddl_mallocater_prof_t*)mddl_mallocater_alloc_with_obj(self_p, sizeof(mddl_mallocater_prof_t));
+    if( NULL == pf ) {
+	return ENOMEM;
+    }
+    memset(pf, 0x0, sizeof(mddl_mallocater_prof_t));
+    pf->interval = interval;
+    pf->rnd = ((uint64_t)(uintptr_t)self_p << 16) ^ 0x2545F4914F6CDD1Dull;
+    pf->bytes_until_sample = prof_next_interval(pf);
+    pf->dump_on_failure = (dump_on_failure) ? 1 : 0;
+    self_p->prof = pf;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_prof_stop_with_obj(mddl_mallocater_t *const self_p)
+ * @brief 割り当てプロファイラを停止し、管理領域をヒープに戻します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 開始していない
+ */
+int mddl_mallocater_prof_stop_with_obj(mddl_mallocater_t *const self_p)
+{
+    void *pf;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == self_p->prof ) {
+	return EINVAL;
+    }
+    pf = self_p->prof;
+    self_p->prof = NULL;
+    mddl_mallocater_free_with_obj(self_p, pf);
+
+    return 0;
+}
+
+/**
+ * @fn static size_t prof_sorted_sites(const mddl_mallocater_prof_t *const pf, uint8_t *const idx)
+ * @brief 使用中バイト数の多い順に呼び出し元の番号を並べます
+ * @return 呼び出し元の数
+ */
+static size_t prof_sorted_sites(const mddl_mallocater_prof_t *const pf, uint8_t *const idx)
+{
+    size_t i, j, n = 0;
+
+    for( i=0; i < MDDL_MALLOCATER_PROF_SITE_COUNT; ++i ) {
+	if( 0 == pf->sites[i].depth ) {
+	    continue;
+	}
+	for( j = n++; (j > 0) && (pf->sites[idx[j - 1]].live_bytes < pf->sites[i].live_bytes); --j ) {
+	    idx[j] = idx[j - 1];
+	}
+	idx[j] = (uint8_t)i;
+    }
+    return n;
+}
+
+/**
+ * @fn int mddl_mallocater_prof_get_sites_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_prof_site_t *const sites, const size_t max_sites, size_t *const nsites_p)
+ * @brief 呼び出し元毎の推定使用量を、使用中バイト数の多い順に取得します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param sites 格納先
+ * @param max_sites sitesの要素数
+ * @param nsites_p 格納した数
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 開始していない
+ */
+int mddl_mallocater_prof_get_sites_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_prof_site_t *const sites, const size_t max_sites, size_t *const nsites_p)
+{
+    const mddl_mallocater_prof_t *const pf = (const mddl_mallocater_prof_t*)self_p->prof;
+    uint8_t idx[MDDL_MALLOCATER_PROF_SITE_COUNT];
+    size_t n, i;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == pf ) {
+	return EINVAL;
+    }
+
+    n = prof_sorted_sites(pf, idx);
+    for( i=0; (i < n) && (i < max_sites); ++i ) {
+	sites[i] = pf->sites[idx[i]];
+    }
+    if( NULL != nsites_p ) {
+	*nsites_p = i;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_prof_dump_with_obj(mddl_mallocater_t *const self_p)
+ * @brief 呼び出し元毎の推定使用量とバックトレースを、使用中バイト数の多い順に出力します
+ *	glibcではシンボル名も出力します(malloc()を使わないbacktrace_symbols_fd()を使います)。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 開始していない
+ */
+int mddl_mallocater_prof_dump_with_obj(mddl_mallocater_t *const self_p)
+{
+    const mddl_mallocater_prof_t *const pf = (const mddl_mallocater_prof_t*)self_p->prof;
+    uint8_t idx[MDDL_MALLOCATER_PROF_SITE_COUNT];
+    size_t n, i;
+    uint32_t f;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == pf ) {
+	return EINVAL;
+    }
+
+    n = prof_sorted_sites(pf, idx);
+    DMSG( "mallocater_prof interval=%llu sites=%llu samples=%llu dropped=%llu live_bytes=%llu" EOL_CRLF,
+	(unsigned long long)pf->interval, (unsigned long long)n, (unsigned long long)pf->nsamples,
+	(unsigned long long)pf->dropped, (unsigned long long)self_p->stats.live_bytes);
+    for( i=0; i < n; ++i ) {
+	const mddl_mallocater_prof_site_t *const st = &pf->sites[idx[i]];
+
+	DMSG( "#%llu live=%llu bytes (%llu samples) total=%llu bytes (%llu samples)" EOL_CRLF,
+	    (unsigned long long)i, (unsigned long long)st->live_bytes, (unsigned long long)st->live_samples,
+	    (unsigned long long)st->total_bytes, (unsigned long long)st->total_samples);
+#if defined(MDDL_MALLOCATER_HAS_BACKTRACE)
+	fflush(stderr);
+	backtrace_symbols_fd(st->frames, (int)st->depth, 2);
+	(void)f;
+#else
+	for( f=0; f < st->depth; ++f ) {
+	    DMSG( "    %p" EOL_CRLF, st->frames[f]);
+	}
+#endif
+    }
+
+    return 0;
+}
+
+/**
+ * @fn void *mddl_mallocater_alloc_with_obj(mddl_mallocater_t *const self_p, const size_t sz)
+ * @brief メモリの空き領域から線形領域を確保します。
+ *	空きリストのビットマップから要求を満たす領域を直接求めるので、確保済み領域数に依存しません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param sz 確保領域
+ * @retval NULL 確保できない
+ * @retval NULL以外 確保したメモリのポインタ
+ **/
+void *mddl_mallocater_alloc_with_obj(mddl_mallocater_t *const self_p, const size_t sz)
+{
+    mddl_malllocate_header_t *p;
+    int result;
+    const size_t totalsz = AREASIZE_OF(sz); // Ceilling
+    void *retptr = NULL;
+    int sampled;
+
+    DBMS5( "mddl_mallocater_alloc_with_obj : execute" EOL_CRLF);
+
+    if(!self_p->init.f.initialized ) {
+	errno = EPERM;
+	return NULL;
+    } else if (( totalsz == 0 ) || ( totalsz < sz )) {
+	// DMSG( "mddl_mallocater_alloc_with_obj : totalsz=0:sz=%d" EOL_CRLF, sz);
+	++(self_p->stats.failed_cnt);
+	errno = EINVAL;
+	return NULL;
+    }
+
+    /* 抜き取る割り当てはヘッダに印を付けるため、スラブを使わない */
+    sampled = prof_should_sample(self_p, sz);
+    if( !sampled && self_p->slab_enable && (sz <= SLAB_MAX_SIZE) ) {
+	/* 小サイズはスラブから割り当てる。用意できなければ通常の領域にする */
+	retptr = slab_alloc(self_p, sz);
+	if( NULL != retptr ) {
+	    ++(self_p->stats.alloc_cnt);
+	    return retptr;
+	}
+    }
+
+    IFDBG3THEN {
+	DBMS3( "%s : header size = %s : malloc size = %s, totalsize = %s" EOL_CRLF,
+	    __func__, SIZEOF_ALLOCATEHEADER, sz, totalsz);
+    }
+
+    /* 空きリストのインデックスから要求を満たす領域を探す */
+    DBMS3( "%s : search free area from index" EOL_CRLF, __func__);
+    p = free_index_search(self_p, totalsz);
+    if( (NULL == p) && (NULL != self_p->grow.region_alloc) ) {
+	/* 足りなければ領域を追加して探し直す */
+	if( !region_grow(self_p, totalsz) ) {
+	    p = free_index_search(self_p, totalsz);
+	}
+    }
+    if( NULL != p ) {
+	DBMS3( "Found area" EOL_CRLF);
+	free_index_remove(self_p, p);
+
+	if((p->size - totalsz) < SIZEOF_MINAREA ) {
+	    /**
+	     * @note 後半ブロックを使うにはサイズが小さすぎるので、
+	     * そのままのサイズを割り当てる
+	     **/
+
+	    /* ヘッダの再構成　*/
+	    p->stamp.magic_no = MAGIC_NO;
+	    p->stamp.occupied |= ALLOCATED_FLAG;
+	    SET_FOOTER(p);
+	    retptr = GET_HEAD2PTR(p);
+	} else {
+	    /* 後半を空き領域にする */
+	    mddl_malllocate_header_t * const s =
+		(mddl_malllocate_header_t*)((uintptr_t)p+totalsz);
+	    s->size = p->size - totalsz;
+	    s->stamp.magic_no = MAGIC_NO;
+	    s->stamp.occupied &= ~ALLOCATED_FLAG;
+	    SET_FOOTER(s);
+
+	    /* sを双方向リンクに追加 */
+	    HEAD_SET_PREV(HEAD_NEXT(p), s);
+	    HEAD_SET_NEXT(s, HEAD_NEXT(p));
+	    HEAD_SET_NEXT(p, s);
+	    HEAD_SET_PREV(s, p);
+	    free_index_insert(self_p, s);
+
+	    IFDBG3THEN {
+		DBMS3( "%s : p=0x%p s=0x%p" EOL_CRLF, __func__, p, s);
+		DBMS3( "%s : p->prev_p=0x%p p->next_p=0x%p s->prev_p=0x%p s->next_p=0x%p" EOL_CRLF,
+		    __func__, HEAD_PREV(p), HEAD_NEXT(p), HEAD_PREV(s), HEAD_NEXT(s));
+	    }
+
+	    /* 前半の長さを調整して使用中のマークをつける */
+	    p->size = totalsz;
+	    p->stamp.magic_no = MAGIC_NO;
+	    p->stamp.occupied |= ALLOCATED_FLAG;
+	    SET_FOOTER(p);
+	    retptr = GET_HEAD2PTR(p);
+	}
+    }
+	   
+    if(NULL != retptr) {
+	p = GET_PTR2HEAD(retptr); 
+	IFDBG3THEN {
+	    DBMS3( "%s : retptr=0x%p" EOL_CRLF, __func__, retptr);
+	}
+
+	IFDBG4THEN {
+	    _mddl_mallocater_dump_region_list(self_p);
+	}
+
+	result = region_pointer_check(self_p, p);
+	if(result) {
+	    // DMSG("%s : post(0x%08x) check is error" EOL_CRLF, myfunc, (uintptr_t)p);
+	    // _mddl_mallocater_dump_region_list(self_p);
+	    abort();
+	}
+	stats_add_live(self_p, p->size, 0);
+	++(self_p->stats.live_blocks);
+	++(self_p->stats.alloc_cnt);
+	if( sampled ) {
+#if defined(__GNUC__)
+	    prof_track(self_p, p, sz, __builtin_return_address(0));
+#else
+	    prof_track(self_p, p, sz, NULL);
+#endif
+	}
+    	return retptr;
+    }
+
+    // DMSG("%s : ENOMEM" EOL_CRLF, myfunc);
+
+    /* 空き領域を用意できなかった */
+    ++(self_p->stats.failed_cnt);
+    prof_on_failure(self_p);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/**
+ * @fn static mddl_malllocate_header_t *free_search_top(mddl_mallocater_t *const self_p, const size_t totalsz)
+ * @brief 上端に近いtotalsz以上の空き領域を探します
+ *	先に空きリストのインデックスで収まる領域があるかを調べ、無ければ領域リストを辿りません。
+ *	領域リストは末尾(最後の領域の上端)からLONG_SEARCH_LIMIT個までしか辿らず、
+ *	見つからなければインデックスで見つけた領域を返します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param totalsz 要求領域サイズ(ヘッダ・フッタ込み)
+ * @retval NULL 空き領域がない
+ * @retval NULL以外 空き領域のヘッダ(空きリストからは外していません)
+ */
+static mddl_malllocate_header_t *free_search_top(mddl_mallocater_t *const self_p, const size_t totalsz)
+{
+    mddl_malllocate_header_t *const fit = free_index_search(self_p, totalsz);
+    mddl_malllocate_header_t *p;
+    unsigned int n;
+
+    if( NULL == fit ) {
+	return NULL;
+    }
+
+    for( p=HEAD_PREV(HEAD_BASE(self_p)), n=0; (p != HEAD_BASE(self_p)) && (n < LONG_SEARCH_LIMIT); p=HEAD_PREV(p), ++n ) {
+	if( AREA_IS_FREE(p) && (p->size >= totalsz) ) {
+	    return p;
+	}
+    }
+
+    return fit;
+}
+
+/**
+ * @fn void *mddl_mallocater_alloc_hint_with_obj(mddl_mallocater_t *const self_p, const size_t sz, const enum_mddl_mallocater_lifetime_t hint)
+ * @brief 寿命のヒントを指定して線形領域を確保します
+ *	MDDL_MALLOCATER_LIFETIME_LONGは、ヒープの上端に近い空き領域の後端から切り出します。
+ *	通常の確保は空き領域の先頭から切り出すので、長寿命の領域が短寿命の領域の間に挟まらず、
+ *	最大の空き領域が断片化しにくくなります。スラブは使いません。
+ *	それ以外のヒントはmddl_mallocater_alloc_with_obj()と同じです。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param sz 確保領域
+ * @param hint 寿命のヒント
+ * @retval NULL 確保できない(errno参照)
+ * @retval NULL以外 確保したメモリのポインタ
+ **/
+void *mddl_mallocater_alloc_hint_with_obj(mddl_mallocater_t *const self_p, const size_t sz, const enum_mddl_mallocater_lifetime_t hint)
+{
+    mddl_malllocate_header_t *p, *a;
+    const size_t totalsz = AREASIZE_OF(sz);
+
+    if( MDDL_MALLOCATER_LIFETIME_LONG != hint ) {
+	return mddl_mallocater_alloc_with_obj(self_p, sz);
+    }
+
+    if(!self_p->init.f.initialized ) {
+	errno = EPERM;
+	return NULL;
+    } else if (( totalsz == 0 ) || ( totalsz < sz )) {
+	++(self_p->stats.failed_cnt);
+	errno = EINVAL;
+	return NULL;
+    }
+
+    p = free_search_top(self_p, totalsz);
+    if( (NULL == p) && (NULL != self_p->grow.region_alloc) ) {
+	/* 追加した領域は末尾に繋がるので、上端から探し直す */
+	if( !region_grow(self_p, totalsz) ) {
+	    p = free_search_top(self_p, totalsz);
+	}
+    }
+    if( NULL == p ) {
+	++(self_p->stats.failed_cnt);
+	prof_on_failure(self_p);
+	errno = ENOMEM;
+	return NULL;
+    }
+    free_index_remove(self_p, p);
+
+    if( (p->size - totalsz) < SIZEOF_MINAREA ) {
+	/* 残りが小さすぎるので、そのままのサイズを割り当てる */
+	a = p;
+    } else {
+	/* 後端を切り出し、前半は空き領域のまま残す */
+	a = (mddl_malllocate_header_t*)((uintptr_t)p + p->size - totalsz);
+	a->size = totalsz;
+	HEAD_SET_PREV(HEAD_NEXT(p), a);
+	HEAD_SET_NEXT(a, HEAD_NEXT(p));
+	HEAD_SET_NEXT(p, a);
+	HEAD_SET_PREV(a, p);
+
+	p->size -= totalsz;
+	SET_FOOTER(p);
+	free_index_insert(self_p, p);
+    }
+    a->stamp.magic_no = MAGIC_NO;
+    a->stamp.occupied |= ALLOCATED_FLAG;
+    SET_FOOTER(a);
+
+    if( region_pointer_check(self_p, a) ) {
+	DBMS("%s : post chk err" EOL_CRLF, __func__);
+	abort();
+    }
+    stats_add_live(self_p, a->size, 0);
+    ++(self_p->stats.live_blocks);
+    ++(self_p->stats.alloc_cnt);
+    if( prof_should_sample(self_p, sz) ) {
+#if defined(__GNUC__)
+	prof_track(self_p, a, sz, __builtin_return_address(0));
+#else
+	prof_track(self_p, a, sz, NULL);
+#endif
+    }
+
+    return GET_HEAD2PTR(a);
+}
+
+static int region_pointer_check(mddl_mallocater_t *const self_p, const mddl_malllocate_header_t * const cur)
+{
+    const mddl_malllocate_header_t *p, *n;
+    int result = 0;
+
+    switch( self_p->check_level ) {
+    case MDDL_MALLOCATER_CHECK_OFF:
+	return 0;
+    case MDDL_MALLOCATER_CHECK_CHEAP:
+	return HEAD_MAGIC_IS_NG(cur) ? ~0 : 0;
+    default:
+	break;
+    }
+    p = HEAD_PREV(cur);
+    n = HEAD_NEXT(cur);
+
+    /* 指定位置の周囲のポインタがあっているかチェックする */
+
+    /* 現在地 */
+    if( HEAD_MAGIC_IS_NG(cur) ) {
+	// DMSG(  "cur(%08x)  MAGIC no is ignore, or invalid" EOL_CRLF, c);
+	result |= ~0;
     }
 
     if( AREA_IS_ALLOC(cur) && AREA_FOOTER_IS_NG(cur) ) {
@@ -387,85 +1967,1384 @@ static int region_pointer_check(mddl_mallocater_t *const self_p, const mddl_mall
 	result |= ~0;
     }
 
-    /* 前の領域 */
-    if( &self_p->base != p ) {
-	if ( HEAD_MAGIC_IS_NG(p) || (AREA_IS_ALLOC(p) && AREA_FOOTER_IS_NG(p)) ) {
-	    // DMSG(  "cur(%08x)->prev_p is NG(%08x)" EOL_CRLF, (uintptr_t)c, (uintptr_t)p);
-	    result |= ~0;
-	} 
-    } 
+    /* 前の領域 */
+    if( HEAD_BASE(self_p) != p ) {
+	if ( HEAD_MAGIC_IS_NG(p) || (AREA_IS_ALLOC(p) && AREA_FOOTER_IS_NG(p)) ) {
+	    // DMSG(  "cur(%08x)->prev_p is NG(%08x)" EOL_CRLF, (uintptr_t)c, (uintptr_t)p);
+	    result |= ~0;
+	} 
+    } 
+
+    /* 後の領域 */
+    if( HEAD_BASE(self_p) != n && AREA_IS_ALLOC(n)) {
+	if ( HEAD_MAGIC_IS_NG(n) || AREA_FOOTER_IS_NG(n) ) {
+	    // DMSG(  "cur(%08x)->next_p is NG(%08x)" EOL_CRLF, (uintptr_t)c, (uintptr_t)n);
+	    result |= ~0;
+	}
+    } 
+    return result;
+}
+
+/**
+ * @fn static int area_is_fence(const mddl_mallocater_t *const self_p, const mddl_malllocate_header_t *const h)
+ * @brief 領域が追加領域の先頭のフェンスかどうかを記述子リストから調べます
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 領域のヘッダ
+ * @retval 0 フェンスではない
+ * @retval 1 フェンス
+ */
+static int area_is_fence(const mddl_mallocater_t *const self_p, const mddl_malllocate_header_t *const h)
+{
+    const mddl_mallocater_region_t *r;
+
+    if( AREA_IS_FREE(h) || (h->size != SIZEOF_FENCEAREA) ) {
+	return 0;
+    }
+    for( r=(const mddl_mallocater_region_t*)self_p->regions; NULL != r; r=r->next ) {
+	if( GET_PTR2HEAD(r) == h ) {
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_trim_with_obj(mddl_mallocater_t *const self_p, size_t *const purged_p)
+ * @brief 大きな空き領域の内側のページを直ちにOSに返します(MADV_DONTNEED)
+ *	対象はinit_obj_exで指定したpurge_threshold以上(0の場合はページを含む全て)の空き領域です。
+ *	領域リストを走査するので、領域数に比例した時間がかかります。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param purged_p 返したバイト数の格納先(NULLの場合は格納しない)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval ENOSYS madviseが使えない環境
+ **/
+int mddl_mallocater_trim_with_obj(mddl_mallocater_t *const self_p, size_t *const purged_p)
+{
+#if defined(MDDL_MALLOCATER_HAS_MMAP)
+    const mddl_malllocate_header_t *p;
+    size_t purged = 0;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+
+    for( p=HEAD_NEXT(HEAD_BASE(self_p)); p != HEAD_BASE(self_p); p=HEAD_NEXT(p) ) {
+	if( AREA_IS_FREE(p) && (p->size >= self_p->purge_threshold) ) {
+	    purged += area_purge_free(self_p, p, (uintptr_t)p, (uintptr_t)p + p->size, 0);
+	}
+    }
+    if( NULL != purged_p ) {
+	*purged_p = purged;
+    }
+
+    return 0;
+#else
+    (void)purged_p;
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn int mddl_mallocater_set_check_level_with_obj(mddl_mallocater_t *const self_p, const enum_mddl_mallocater_check_level_t level)
+ * @brief alloc/free/realloc毎に行うヘッダ・フッタ検査のレベルを設定します
+ *	MDDL_MALLOCATER_CHECK_OFFにした場合、破損したポインタを渡されてもabort()しません。
+ *	mddl_mallocater_verify_with_obj()を定期的に呼び出して破損を検出してください。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param level 検査レベル
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL levelが不正
+ **/
+int mddl_mallocater_set_check_level_with_obj(mddl_mallocater_t *const self_p, const enum_mddl_mallocater_check_level_t level)
+{
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+
+    switch( level ) {
+    case MDDL_MALLOCATER_CHECK_OFF:
+    case MDDL_MALLOCATER_CHECK_CHEAP:
+    case MDDL_MALLOCATER_CHECK_FULL:
+	break;
+    default:
+	return EINVAL;
+    }
+    self_p->check_level = (uint8_t)level;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_verify_with_obj(mddl_mallocater_t *const self_p, void **const badptr_p)
+ * @brief ヒープ全体の整合性を検査します
+ *	領域リストの全領域のマジック番号・フッタ・前後のリンク・隣接関係と、
+ *	空きリストのインデックス、スラブのリスト、割り当て統計が一致していることを確認します。
+ *	領域数に比例した時間がかかるので、ウォッチドッグ等から定期的に呼び出してください。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param badptr_p 破損を検出した領域のポインタの格納先(NULLの場合は格納しない)
+ *	領域を特定できない破損の場合はNULLを格納します。
+ * @retval 0 破損なし
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EFAULT 破損を検出した
+ **/
+int mddl_mallocater_verify_with_obj(mddl_mallocater_t *const self_p, void **const badptr_p)
+{
+    const mddl_malllocate_header_t *const base = HEAD_BASE(self_p);
+    const mddl_malllocate_header_t *p, *n, *bad = NULL;
+    const mddl_mallocater_region_t *r;
+    const char *why = NULL;
+    size_t live_bytes = 0, live_blocks = 0, free_blocks = 0, fences = 0, nregions = 0, indexed = 0, slabs = 0;
+    int fl, sl, ifl, isl, cls;
+
+    if( NULL != badptr_p ) {
+	*badptr_p = NULL;
+    }
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+
+    /* 領域リスト */
+    if( HEAD_MAGIC_IS_NG(base) || AREA_IS_FREE(base) || (HEAD_PREV(HEAD_NEXT(base)) != base) ) {
+	why = "base";
+    }
+    for( p=HEAD_NEXT(base); (NULL == why) && (p != base); p=n ) {
+	n = HEAD_NEXT(p);
+	if( HEAD_MAGIC_IS_NG(p) ) {
+	    why = "magic";
+	} else if( (p->size < SIZEOF_MINAREA) || (p->size & (ALLOCATER_ALIGN - 1)) || (p->size > self_p->bufsiz) ) {
+	    why = "size";
+	} else if( AREA_FOOTER_IS_NG(p) ) {
+	    why = "footer";
+	} else if( HEAD_PREV(n) != p ) {
+	    why = "link";
+	} else if( (n != base) && (((uintptr_t)p + p->size) != (uintptr_t)n) && !area_is_fence(self_p, n) ) {
+	    why = "adjacency";
+	} else if( AREA_IS_FREE(p) ) {
+	    if( (n != base) && AREA_IS_FREE(n) ) {
+		why = "uncoalesced";
+	    }
+	    ++free_blocks;
+	} else if( area_is_fence(self_p, p) ) {
+	    ++fences;
+	} else {
+	    live_bytes += p->size;
+	    ++live_blocks;
+	}
+	if( NULL != why ) {
+	    bad = p;
+	}
+    }
+
+    /* 空きリストのインデックス */
+    for( fl=0; (NULL == why) && (fl < FL_INDEX_COUNT); ++fl ) {
+	if( !(self_p->fl_bitmap & ((uint32_t)1 << fl)) != !self_p->sl_bitmap[fl] ) {
+	    why = "fl_bitmap";
+	    break;
+	}
+	for( sl=0; (NULL == why) && (sl < SL_INDEX_COUNT); ++sl ) {
+	    const mddl_malllocate_header_t *prev = NULL;
+
+	    if( !(self_p->sl_bitmap[fl] & ((uint32_t)1 << sl)) != (NULL == self_p->free_heads[fl][sl]) ) {
+		why = "sl_bitmap";
+		break;
+	    }
+	    for( p=self_p->free_heads[fl][sl]; NULL != p; p=GET_FREE_LINKS(p)->next_p ) {
+		if( HEAD_MAGIC_IS_NG(p) || AREA_IS_ALLOC(p) ) {
+		    why = "index entry";
+		} else if( GET_FREE_LINKS(p)->prev_p != prev ) {
+		    why = "index link";
+		} else if( ++indexed > free_blocks ) {
+		    why = "index count";
+		} else {
+		    mapping_insert( p->size, &ifl, &isl);
+		    if( (ifl != fl) || (isl != sl) ) {
+			why = "index class";
+		    }
+		}
+		if( NULL != why ) {
+		    bad = p;
+		    break;
+		}
+		prev = p;
+	    }
+	}
+    }
+
+    /* 空きのあるスラブのリスト */
+    for( cls=0; (NULL == why) && (cls < SLAB_CLASS_COUNT); ++cls ) {
+	const mddl_mallocater_slab_t *sp, *prev = NULL;
+
+	for( sp=(const mddl_mallocater_slab_t*)self_p->slab_partial[cls]; NULL != sp; sp=sp->next_p ) {
+	    if( (sp->magic_no != SLAB_MAGIC_NO) || (sp->owner != (void*)self_p) || (sp->self_p != sp)
+		|| (sp->cls != cls) || (sp->prev_p != prev) || AREA_IS_FREE(GET_PTR2HEAD(sp)) ) {
+		why = "slab";
+	    } else if( (0 == sp->nfree) || (sp->nfree > sp->nslots) ) {
+		why = "slab nfree";
+	    } else if( ++slabs > self_p->slab_cnt ) {
+		why = "slab count";
+	    }
+	    if( NULL != why ) {
+		bad = GET_PTR2HEAD(sp);
+		break;
+	    }
+	    prev = sp;
+	}
+    }
+
+    /* 集計値 */
+    if( NULL == why ) {
+	for( r=(const mddl_mallocater_region_t*)self_p->regions; NULL != r; r=r->next ) {
+	    ++nregions;
+	}
+	if( indexed != free_blocks ) {
+	    why = "index count";
+	} else if( fences != nregions ) {
+	    why = "region count";
+	} else if( (live_bytes != self_p->stats.live_bytes) || (live_blocks != self_p->stats.live_blocks) ) {
+	    why = "stats";
+	}
+    }
+
+    if( NULL == why ) {
+	return 0;
+    }
+
+    DBMS1( "%s : %s error at 0x%p" EOL_CRLF, __func__, why, (const void*)bad);
+    if( (NULL != badptr_p) && (NULL != bad) ) {
+	*badptr_p = GET_HEAD2PTR(bad);
+    }
+
+    return EFAULT;
+}
+
+/**
+ * @fn static size_t area_purge(const mddl_mallocater_t *const self_p, const uintptr_t top, const uintptr_t end, const int lazy)
+ * @brief 範囲に完全に含まれるページをOSに返します。内容は失われます
+ *	lazyの場合はMADV_FREEで、メモリが逼迫した時にOSが回収します(再利用時のページフォルトを避けられます)。
+ *	MADV_FREEが使えない領域(共有マッピング等)やlazyでない場合はMADV_DONTNEEDで直ちに返します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param top 範囲の先頭
+ * @param end 範囲の終端
+ * @param lazy 0以外:MADV_FREEを優先する
+ * @return 返したバイト数
+ */
+static size_t area_purge(const mddl_mallocater_t *const self_p, const uintptr_t top, const uintptr_t end, const int lazy)
+{
+#if defined(MDDL_MALLOCATER_HAS_MMAP)
+    const uintptr_t mask = (uintptr_t)self_p->pagesize - 1;
+    const uintptr_t ptop = (top + mask) & ~mask;
+    const uintptr_t pend = end & ~mask;
+    int result = -1;
+
+    if( (0 == self_p->pagesize) || (pend <= ptop) ) {
+	return 0;
+    }
+#if defined(MADV_FREE)
+    if( lazy ) {
+	result = madvise((void*)ptop, (size_t)(pend - ptop), MADV_FREE);
+    }
+#endif
+    if( result ) {
+	result = madvise((void*)ptop, (size_t)(pend - ptop), MADV_DONTNEED);
+    }
+    if( result ) {
+	DBMS3( "%s : madvise fail errno=%d" EOL_CRLF, __func__, errno);
+	return 0;
+    }
+
+    return (size_t)(pend - ptop);
+#else
+    (void)self_p;
+    (void)top;
+    (void)end;
+    (void)lazy;
+    return 0;
+#endif
+}
+
+/**
+ * @fn static size_t area_purge_free(const mddl_mallocater_t *const self_p, const mddl_malllocate_header_t *const h, uintptr_t top, uintptr_t end, const int lazy)
+ * @brief 空き領域のうち、ヘッダ・空きリストのリンク・フッタを除いた範囲をtop〜endに切り詰めてページを返します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 空き領域のヘッダ
+ * @param top 対象範囲の先頭
+ * @param end 対象範囲の終端
+ * @param lazy 0以外:MADV_FREEを優先する
+ * @return 返したバイト数
+ */
+static size_t area_purge_free(const mddl_mallocater_t *const self_p, const mddl_malllocate_header_t *const h, uintptr_t top, uintptr_t end, const int lazy)
+{
+    const uintptr_t itop = (uintptr_t)GET_HEAD2PTR(h) + sizeof(mddl_mallocater_free_links_t);
+    const uintptr_t iend = (uintptr_t)GET_FOOTER_PTR(h);
+
+    if( top < itop ) {
+	top = itop;
+    }
+    if( end > iend ) {
+	end = iend;
+    }
+
+    return (end > top) ? area_purge(self_p, top, end, lazy) : 0;
+}
+
+/**
+ * @fn static void area_release(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *cur)
+ * @brief 使用中の領域を空き領域にし、前後の空き領域と併合して空きリストに登録します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param cur 開放する領域のヘッダ
+ */
+static void area_release(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *cur)
+{
+    const uintptr_t rtop = (uintptr_t)cur, rend = (uintptr_t)cur + cur->size;
+    int result;
+
+    stats_add_live(self_p, 0, cur->size);
+    --(self_p->stats.live_blocks);
+
+    /* もし直前が空きブロックだったら、 併合して1つの領域にする */
+//    if (!(cur->prev_p->stamp.occupied & ALLOCATED_FLAG) ) {
+    if (AREA_IS_FREE(HEAD_PREV(cur))) {
+	free_index_remove(self_p, HEAD_PREV(cur));
+	HEAD_SET_PREV(HEAD_NEXT(cur), HEAD_PREV(cur));
+	HEAD_SET_NEXT(HEAD_PREV(cur), HEAD_NEXT(cur));
+	(HEAD_PREV(cur))->size += cur->size;
+	cur = HEAD_PREV(cur);
+    }
+
+    /* もし、 直後が空きブロックだったら、 併合して1つの領域にする */
+//    if (!(cur->next_p->stamp.occupied & ALLOCATED_FLAG)) {
+    if (AREA_IS_FREE(HEAD_NEXT(cur))) {
+	free_index_remove(self_p, HEAD_NEXT(cur));
+	HEAD_SET_PREV(HEAD_NEXT(HEAD_NEXT(cur)), cur);
+	cur->size  += (HEAD_NEXT(cur))->size;
+	HEAD_SET_NEXT(cur, HEAD_NEXT(HEAD_NEXT(cur)));
+    }
+
+    /* 空きブロックのマークをつける */
+    cur->stamp.occupied = MAGIC_NO;
+    cur->stamp.occupied &= ~ALLOCATED_FLAG;
+    SET_FOOTER(cur);
+    free_index_insert(self_p, cur);
+
+    /* 大きな空き領域になったら、今回開放した部分のページを返す */
+    if( self_p->purge_on_free && (cur->size >= self_p->purge_threshold) ) {
+	area_purge_free(self_p, cur, rtop, rend, 1);
+    }
+
+    /* ヘッダー フッターの再チェック */
+    result = region_pointer_check(self_p, cur);
+    if(result) {
+	DBMS("%s : post chk err" EOL_CRLF, __func__);
+	// _mddl_mallocater_dump_region_list(self_p);
+	abort();
+    }
+}
+
+/**
+ * @fn void mddl_mallocater_free_with_obj(mddl_mallocater_t *const self_p, void * const ptr)
+ * @brief 確保した線形領域を開放します
+ *	スラブから割り当てたオブジェクトはスラブに戻します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param ptr 開放するバッファのポインタ
+ */
+void mddl_mallocater_free_with_obj(mddl_mallocater_t *const self_p, void * const ptr)
+{
+    mddl_malllocate_header_t *cur;
+    mddl_mallocater_slab_t *slab;
+    int result;
+    const char *const myfunc=__FUNCTION__;
+    DBMS5(  "mddl_mallocater_free_with_obj : execute" EOL_CRLF);
+
+    if(!self_p->init.f.initialized ) {
+	errno = EPERM;
+	abort();
+    }
+    if(!ptr) return;
+
+    slab = slab_lookup(self_p, ptr);
+    if( NULL != slab ) {
+	++(self_p->stats.free_cnt);
+	slab_free(self_p, slab, ptr);
+	return;
+    }
+
+    /* dealloc するヘッダを得る */
+    cur = GET_PTR2HEAD(ptr);
+
+    /* ヘッダー フッターのチェック */
+    result = region_pointer_check(self_p, cur);
+    if(result) {
+	DBMS("%s : pre chk err" EOL_CRLF, myfunc);
+	// _mddl_mallocater_dump_region_list(self_p);
+	abort();
+    }
+    ++(self_p->stats.free_cnt);
+    if( AREA_IS_SAMPLED(cur) ) {
+	prof_untrack(self_p, cur);
+    }
+
+    area_release(self_p, cur);
+
+    return;
+}
+
+/**
+ * @fn static size_t area_carve_batch(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const p, const size_t totalsz, const size_t cnt, void **const ptrs)
+ * @brief 空き領域の先頭からtotalszの領域をcnt個続けて切り出します
+ *	残りが最小領域に満たない場合は最後の領域に含めます。ヘッダ・フッタの検査は両端だけ行います。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param p 空き領域のヘッダ(空きリストに登録されたもの。p->size >= totalsz * cnt)
+ * @param totalsz 1つの領域サイズ(ヘッダ・フッタ込み)
+ * @param cnt 切り出す数
+ * @param ptrs 確保したポインタの格納先
+ */
+static void area_carve_batch(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const p, const size_t totalsz, const size_t cnt, void **const ptrs)
+{
+    mddl_malllocate_header_t *const n = HEAD_NEXT(p);
+    mddl_malllocate_header_t *h = p, *prev = HEAD_PREV(p);
+    size_t rest = p->size, i;
+
+    free_index_remove(self_p, p);
+
+    for( i=0; i < cnt; ++i ) {
+	h->size = totalsz;
+	if( (i == (cnt - 1)) && ((rest - totalsz) < SIZEOF_MINAREA) ) {
+	    h->size = rest;
+	}
+	rest -= h->size;
+	h->stamp.magic_no = MAGIC_NO;
+	h->stamp.occupied |= ALLOCATED_FLAG;
+	HEAD_SET_PREV(h, prev);
+	HEAD_SET_NEXT(prev, h);
+	SET_FOOTER(h);
+	ptrs[i] = GET_HEAD2PTR(h);
+	stats_add_live(self_p, h->size, 0);
+	prev = h;
+	h = (mddl_malllocate_header_t*)((uintptr_t)h + h->size);
+    }
+
+    if( rest ) {
+	/* 残りを空き領域にする */
+	h->size = rest;
+	h->stamp.magic_no = MAGIC_NO;
+	h->stamp.occupied &= ~ALLOCATED_FLAG;
+	HEAD_SET_PREV(h, prev);
+	HEAD_SET_NEXT(prev, h);
+	SET_FOOTER(h);
+	free_index_insert(self_p, h);
+	prev = h;
+    }
+    HEAD_SET_NEXT(prev, n);
+    HEAD_SET_PREV(n, prev);
+
+    self_p->stats.live_blocks += cnt;
+    self_p->stats.alloc_cnt += cnt;
+
+    if( region_pointer_check(self_p, GET_PTR2HEAD(ptrs[0]))
+	|| region_pointer_check(self_p, GET_PTR2HEAD(ptrs[cnt - 1])) ) {
+	DBMS("%s : post chk err" EOL_CRLF, __func__);
+	abort();
+    }
+}
+
+/**
+ * @fn int mddl_mallocater_alloc_batch_with_obj(mddl_mallocater_t *const self_p, const size_t size, const size_t n, void **const ptrs)
+ * @brief 同じサイズの領域をn個まとめて確保します
+ *	n個分が入る空き領域を1回の探索で求めて連続して切り出すので、1個ずつ確保するより速く、
+ *	確保した領域もアドレス順に並びます。1つの空き領域に収まらない場合は分割して探します。
+ *	スラブが有効で小サイズの場合はスラブから確保します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param size 1つの領域のサイズ
+ * @param n 確保する数
+ * @param ptrs 確保したポインタの格納先(n個分)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL sizeが不正
+ * @retval ENOMEM 空き領域が足りない(1つも確保しません)
+ **/
+int mddl_mallocater_alloc_batch_with_obj(mddl_mallocater_t *const self_p, const size_t size, const size_t n, void **const ptrs)
+{
+    const size_t totalsz = AREASIZE_OF(size);
+    mddl_malllocate_header_t *p;
+    size_t done = 0, cnt;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if (( totalsz == 0 ) || ( totalsz < size ) || (NULL == ptrs)) {
+	return EINVAL;
+    }
+
+    if( self_p->slab_enable && (size <= SLAB_MAX_SIZE) ) {
+	for( ; done < n; ++done ) {
+	    ptrs[done] = slab_alloc(self_p, size);
+	    if( NULL == ptrs[done] ) {
+		break;
+	    }
+	    ++(self_p->stats.alloc_cnt);
+	}
+    }
+
+    for( cnt = n - done; done < n; ) {
+	if( cnt > ((n - done)) ) {
+	    cnt = n - done;
+	}
+	/* cnt個分が入る空き領域を探し、無ければ個数を半分にして探し直す */
+	p = ( cnt <= (~(size_t)0 / totalsz) ) ? free_index_search(self_p, totalsz * cnt) : NULL;
+	if( (NULL == p) && (NULL != self_p->grow.region_alloc) && ( cnt <= (~(size_t)0 / totalsz) ) ) {
+	    if( !region_grow(self_p, totalsz * cnt) ) {
+		p = free_index_search(self_p, totalsz * cnt);
+	    }
+	}
+	if( NULL == p ) {
+	    if( cnt > 1 ) {
+		cnt /= 2;
+		continue;
+	    }
+	    /* 確保できた分を戻す */
+	    mddl_mallocater_free_batch_with_obj(self_p, ptrs, done);
+	    self_p->stats.free_cnt -= done;
+	    self_p->stats.alloc_cnt -= done;
+	    ++(self_p->stats.failed_cnt);
+	    return ENOMEM;
+	}
+	area_carve_batch(self_p, p, totalsz, cnt, &ptrs[done]);
+	done += cnt;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn static int ptr_addr_compare(const void *const a, const void *const b)
+ * @brief qsort用にポインタをアドレス順に比較します
+ */
+static int ptr_addr_compare(const void *const a, const void *const b)
+{
+    const uintptr_t pa = (uintptr_t)*(void *const *)a;
+    const uintptr_t pb = (uintptr_t)*(void *const *)b;
+
+    return (pa < pb) ? -1 : ((pa > pb) ? 1 : 0);
+}
+
+/**
+ * @fn void mddl_mallocater_free_batch_with_obj(mddl_mallocater_t *const self_p, void **const ptrs, const size_t n)
+ * @brief 複数の領域をまとめて開放します
+ *	ptrsをアドレス順に並べ替え、隣接する領域は1つにまとめてから開放するので、
+ *	空きリストの更新は連続する領域毎に1回で済みます。NULLは無視します。
+ *	同じポインタが含まれている場合はabort()します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param ptrs 開放するポインタの配列(アドレス順に並べ替えます)
+ * @param n ptrsの要素数
+ */
+void mddl_mallocater_free_batch_with_obj(mddl_mallocater_t *const self_p, void **const ptrs, const size_t n)
+{
+    mddl_malllocate_header_t *run, *cur;
+    mddl_mallocater_slab_t *slab;
+    size_t i, cnt = 0;
+
+    if(!self_p->init.f.initialized ) {
+	errno = EPERM;
+	abort();
+    }
+    if( (NULL == ptrs) || (0 == n) ) {
+	return;
+    }
+
+    qsort(ptrs, n, sizeof(void*), ptr_addr_compare);
+
+    for( i=0, run=NULL; i < n; ++i ) {
+	if( NULL == ptrs[i] ) {
+	    continue;
+	}
+	if( (i > 0) && (ptrs[i] == ptrs[i - 1]) ) {
+	    DBMS("%s : double free 0x%p" EOL_CRLF, __func__, ptrs[i]);
+	    abort();
+	}
+	++cnt;
+
+	slab = slab_lookup(self_p, ptrs[i]);
+	if( NULL != slab ) {
+	    slab_free(self_p, slab, ptrs[i]);
+	    continue;
+	}
+
+	cur = GET_PTR2HEAD(ptrs[i]);
+	if( region_pointer_check(self_p, cur) ) {
+	    DBMS("%s : pre chk err" EOL_CRLF, __func__);
+	    abort();
+	}
+	if( AREA_IS_SAMPLED(cur) ) {
+	    prof_untrack(self_p, cur);
+	}
+
+	if( (NULL != run) && (HEAD_NEXT(run) == cur) ) {
+	    /* 直前の領域と隣接しているので1つの使用中領域にまとめる */
+	    HEAD_SET_PREV(HEAD_NEXT(cur), run);
+	    HEAD_SET_NEXT(run, HEAD_NEXT(cur));
+	    run->size += cur->size;
+	    SET_FOOTER(run);
+	    --(self_p->stats.live_blocks);
+	    continue;
+	}
+	if( NULL != run ) {
+	    area_release(self_p, run);
+	}
+	run = cur;
+    }
+    if( NULL != run ) {
+	area_release(self_p, run);
+    }
+    self_p->stats.free_cnt += cnt;
+}
+
+/**
+ * @note 移動可能な領域(ハンドル)
+ *	ハンドルの領域は通常の領域で、ヘッダにHANDLE_FLAGを立て、ペイロードの先頭HANDLE_PREFIX_SIZEに
+ *	ハンドル表の番号を持ちます。利用者にはその後ろを渡します。
+ *	mddl_mallocater_compact_with_obj()は、空き領域の直後にあるロックされていないハンドルの領域を
+ *	空き領域の先頭へずらし、空き領域を後ろへ集めます。
+ *	ハンドル表は移動の障害にならないようにヒープの上端(MDDL_MALLOCATER_LIFETIME_LONG)に置きます。
+ */
+#define HANDLE_PREFIX_SIZE ALLOCATER_ALIGN
+#define HANDLE_TABLE_MIN_CNT 64
+
+typedef struct _mddl_mallocater_handle_entry {
+    void *ptr;			/* 領域のペイロード(ハンドル番号の位置)。NULLは未使用 */
+    uint32_t lock_cnt;
+    uint32_t next_free;		/* 未使用エントリのリスト(番号+1) */
+} mddl_mallocater_handle_entry_t;
+
+#define HANDLE_ENTRY(o, h) (&((mddl_mallocater_handle_entry_t*)(o)->htab)[(h) - 1])
+
+/**
+ * @fn static mddl_mallocater_handle_entry_t *handle_entry(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+ * @brief ハンドルから使用中のハンドル表のエントリを得ます
+ * @retval NULL ハンドルが無効
+ * @retval NULL以外 エントリ
+ */
+static mddl_mallocater_handle_entry_t *handle_entry(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_handle_entry_t *e;
+
+    if( (0 == h) || (h > self_p->htab_cnt) ) {
+	return NULL;
+    }
+    e = HANDLE_ENTRY(self_p, h);
+
+    return (NULL == e->ptr) ? NULL : e;
+}
+
+/**
+ * @fn static int handle_table_grow(mddl_mallocater_t *const self_p)
+ * @brief ハンドル表の要素数を倍にします
+ * @retval 0 成功
+ * @retval ENOMEM 表を確保できない
+ */
+static int handle_table_grow(mddl_mallocater_t *const self_p)
+{
+    const uint32_t oldcnt = self_p->htab_cnt;
+    const uint32_t newcnt = (oldcnt) ? (oldcnt * 2) : HANDLE_TABLE_MIN_CNT;
+    mddl_mallocater_handle_entry_t *tab;
+    uint32_t n;
+
+    if( newcnt <= oldcnt ) {
+	return ENOMEM;
+    }
+    tab = (mddl_mallocater_handle_entry_t*)mddl_mallocater_alloc_hint_with_obj(self_p,
+	    sizeof(mddl_mallocater_handle_entry_t) * newcnt, MDDL_MALLOCATER_LIFETIME_LONG);
+    if( NULL == tab ) {
+	return ENOMEM;
+    }
+    if( oldcnt ) {
+	memcpy(tab, self_p->htab, sizeof(mddl_mallocater_handle_entry_t) * oldcnt);
+	mddl_mallocater_free_with_obj(self_p, self_p->htab);
+    }
+
+    /* 追加したエントリを未使用リストの先頭に繋ぐ */
+    for( n=oldcnt; n < newcnt; ++n ) {
+	tab[n].ptr = NULL;
+	tab[n].lock_cnt = 0;
+	tab[n].next_free = ((n + 1) < newcnt) ? (n + 2) : self_p->htab_free;
+    }
+    self_p->htab = tab;
+    self_p->htab_cnt = newcnt;
+    self_p->htab_free = oldcnt + 1;
+
+    return 0;
+}
+
+/**
+ * @fn mddl_mallocater_handle_t mddl_mallocater_halloc_with_obj(mddl_mallocater_t *const self_p, const size_t size)
+ * @brief 移動可能な領域を確保し、ハンドルを返します
+ *	領域はmddl_mallocater_compact_with_obj()で移動することがあるので、アクセスする間は
+ *	mddl_mallocater_hlock_with_obj()でポインタを取り出してロックしてください。スラブは使いません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param size 確保するサイズ
+ * @retval 0 確保できない(errno参照)
+ *	EPERM オブジェクトが初期化されていない
+ *	EINVAL sizeが不正
+ *	ENOMEM メモリが足りない
+ * @retval 0以外 ハンドル
+ */
+mddl_mallocater_handle_t mddl_mallocater_halloc_with_obj(mddl_mallocater_t *const self_p, const size_t size)
+{
+    mddl_mallocater_handle_entry_t *e;
+    mddl_mallocater_handle_t h;
+    mddl_malllocate_header_t *p;
+    uint8_t slab_enable;
+    void *ptr;
+
+    if(!self_p->init.f.initialized ) {
+	errno = EPERM;
+	return 0;
+    } else if( (size + HANDLE_PREFIX_SIZE) < size ) {
+	errno = EINVAL;
+	return 0;
+    }
+    if( (0 == self_p->htab_free) && handle_table_grow(self_p) ) {
+	errno = ENOMEM;
+	return 0;
+    }
+
+    /* ヘッダに印を付けるので、スラブを使わずに確保する */
+    slab_enable = self_p->slab_enable;
+    self_p->slab_enable = 0;
+    ptr = mddl_mallocater_alloc_with_obj(self_p, size + HANDLE_PREFIX_SIZE);
+    self_p->slab_enable = slab_enable;
+    if( NULL == ptr ) {
+	return 0;
+    }
 
-    /* 後の領域 */
-    if( &self_p->base != n && AREA_IS_ALLOC(n)) {
-	if ( HEAD_MAGIC_IS_NG(p) || (AREA_IS_ALLOC(p) && AREA_FOOTER_IS_NG(p)) ) {
-	    // DMSG(  "cur(%08x)->next_p is NG(%08x)" EOL_CRLF, (uintptr_t)c, (uintptr_t)n);
-	    result |= ~0;
+    h = self_p->htab_free;
+    e = HANDLE_ENTRY(self_p, h);
+    self_p->htab_free = e->next_free;
+    e->ptr = ptr;
+    e->lock_cnt = 0;
+    e->next_free = 0;
+
+    *(size_t*)ptr = (size_t)h;
+    p = GET_PTR2HEAD(ptr);
+    p->stamp.occupied |= HANDLE_FLAG;
+
+    return h;
+}
+
+/**
+ * @fn int mddl_mallocater_hfree_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+ * @brief ハンドルの領域を開放します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h ハンドル
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL ハンドルが無効
+ * @retval EBUSY ロックされている
+ */
+int mddl_mallocater_hfree_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_handle_entry_t *e;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+    e = handle_entry(self_p, h);
+    if( NULL == e ) {
+	return EINVAL;
+    } else if( e->lock_cnt ) {
+	return EBUSY;
+    }
+
+    GET_PTR2HEAD(e->ptr)->stamp.occupied &= ~HANDLE_FLAG;
+    mddl_mallocater_free_with_obj(self_p, e->ptr);
+
+    e->ptr = NULL;
+    e->next_free = self_p->htab_free;
+    self_p->htab_free = h;
+
+    return 0;
+}
+
+/**
+ * @fn void *mddl_mallocater_hlock_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+ * @brief ハンドルの領域をロックしてポインタを返します
+ *	ロックは入れ子にでき、同じ回数mddl_mallocater_hunlock_with_obj()を呼ぶまで領域は移動しません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h ハンドル
+ * @retval NULL ハンドルが無効
+ * @retval NULL以外 領域のポインタ
+ */
+void *mddl_mallocater_hlock_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_handle_entry_t *const e = handle_entry(self_p, h);
+
+    if( NULL == e ) {
+	errno = EINVAL;
+	return NULL;
+    }
+    ++(e->lock_cnt);
+
+    return (void*)((uintptr_t)e->ptr + HANDLE_PREFIX_SIZE);
+}
+
+/**
+ * @fn int mddl_mallocater_hunlock_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+ * @brief ハンドルの領域のロックを1つ外します
+ *	ロックが全て外れると、以前に得たポインタは次のコンパクションまでしか有効ではありません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h ハンドル
+ * @retval 0 成功
+ * @retval EINVAL ハンドルが無効かロックされていない
+ */
+int mddl_mallocater_hunlock_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_handle_entry_t *const e = handle_entry(self_p, h);
+
+    if( (NULL == e) || (0 == e->lock_cnt) ) {
+	return EINVAL;
+    }
+    --(e->lock_cnt);
+
+    return 0;
+}
+
+/**
+ * @fn static mddl_malllocate_header_t *area_slide_down(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const f, mddl_malllocate_header_t *const a)
+ * @brief 空き領域fの直後の使用中領域aをfの先頭へずらし、空き領域をその後ろに移します
+ *	ずらした後の空き領域は、直後が空き領域なら併合します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param f 空き領域
+ * @param a fの直後の使用中領域
+ * @return 移動後のaのヘッダ
+ */
+static mddl_malllocate_header_t *area_slide_down(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const f, mddl_malllocate_header_t *const a)
+{
+    mddl_malllocate_header_t *const b = HEAD_PREV(f);
+    mddl_malllocate_header_t *const n = HEAD_NEXT(a);
+    const size_t fsz = f->size, asz = a->size;
+    const uint32_t stamp = a->stamp.occupied;
+    mddl_malllocate_header_t *h, *s;
+
+    free_index_remove(self_p, f);
+
+    /* ヘッダ・フッタごと移動してから、リンクとフッタを書き直す */
+    h = f;
+    own_memmove(h, a, asz);
+    h->size = asz;
+    h->stamp.occupied = stamp;
+    HEAD_SET_PREV(h, b);
+    HEAD_SET_NEXT(b, h);
+    SET_FOOTER(h);
+
+    s = (mddl_malllocate_header_t*)((uintptr_t)h + asz);
+    s->size = fsz;
+    s->stamp.magic_no = MAGIC_NO;
+    s->stamp.occupied &= ~ALLOCATED_FLAG;
+    HEAD_SET_NEXT(h, s);
+    HEAD_SET_PREV(s, h);
+    if( AREA_IS_FREE(n) ) {
+	free_index_remove(self_p, n);
+	s->size += n->size;
+	HEAD_SET_NEXT(s, HEAD_NEXT(n));
+	HEAD_SET_PREV(HEAD_NEXT(n), s);
+    } else {
+	HEAD_SET_NEXT(s, n);
+	HEAD_SET_PREV(n, s);
+    }
+    SET_FOOTER(s);
+    free_index_insert(self_p, s);
+
+    return h;
+}
+
+/**
+ * @fn int mddl_mallocater_compact_with_obj(mddl_mallocater_t *const self_p, const size_t budget, size_t *const moved_p)
+ * @brief ロックされていないハンドルの領域をヒープの先頭側へ詰め、空き領域を後ろへまとめます
+ *	1回の呼び出しで移動するバイト数をbudgetで制限できるので、処理の合間に少しずつ呼べます。
+ *	ハンドル以外の領域やロック中の領域は移動しないので、その手前の空き領域は残ります。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param budget 1回に移動するバイト数の上限(0は無制限)。1つの領域は途中で止めません
+ * @param moved_p 移動したバイト数(NULL可)
+ * @retval 0 移動できる領域が残っていない
+ * @retval EAGAIN budgetに達した。続きがあるので再度呼んでください
+ * @retval EPERM オブジェクトが初期化されていない
+ */
+int mddl_mallocater_compact_with_obj(mddl_mallocater_t *const self_p, const size_t budget, size_t *const moved_p)
+{
+    mddl_malllocate_header_t *const base = HEAD_BASE(self_p);
+    mddl_malllocate_header_t *p, *n, *h;
+    size_t moved = 0;
+    int result = 0;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+
+    for( p=HEAD_NEXT(base); p != base; p=HEAD_NEXT(p) ) {
+	mddl_mallocater_handle_entry_t *e;
+	void *old_ptr;
+	int sampled;
+
+	n = HEAD_NEXT(p);
+	if( AREA_IS_ALLOC(p) || (n == base) || AREA_IS_FREE(n) || !AREA_IS_HANDLE(n) ) {
+	    continue;
 	}
-    } 
+	old_ptr = GET_HEAD2PTR(n);
+	e = handle_entry(self_p, (mddl_mallocater_handle_t)*(size_t*)old_ptr);
+	if( (NULL == e) || (e->ptr != old_ptr) ) {
+	    DBMS("%s : handle broken 0x%p" EOL_CRLF, __func__, old_ptr);
+	    abort();
+	}
+	if( e->lock_cnt ) {
+	    continue;
+	}
+	if( budget && (moved >= budget) ) {
+	    result = EAGAIN;
+	    break;
+	}
+
+	sampled = AREA_IS_SAMPLED(n);
+	h = area_slide_down(self_p, p, n);
+	e->ptr = GET_HEAD2PTR(h);
+	if( sampled ) {
+	    prof_move(self_p, old_ptr, h);
+	}
+	moved += h->size;
+
+	if( region_pointer_check(self_p, h) || region_pointer_check(self_p, HEAD_NEXT(h)) ) {
+	    DBMS("%s : post chk err" EOL_CRLF, __func__);
+	    abort();
+	}
+	/* 次はずらした後ろの空き領域から続ける */
+	p = h;
+    }
+    if( NULL != moved_p ) {
+	*moved_p = moved;
+    }
+
     return result;
 }
 
 /**
- * @fn void mddl_mallocater_free_with_obj(mddl_mallocater_t *const self_p, void * const ptr)
- * @brief 確保した線形領域を開放します
+ * @note 永続ヒープ
+ *	ファイルの先頭PERSIST_HEADER_SIZEに管理情報を置き、その後ろをヒープとしてMAP_SHAREDでマップします。
+ *	ヒープ内のリンクは_MDDL_MALLOCATER_COMPACT_HEADERの自己相対リンクなので、異なるアドレスに
+ *	マップしても辿れます。フッタ(アドレスの下位32bit)とハンドル表は接続時に付け替えます。
+ *	空きリストのインデックスと統計は接続時に領域リストを走査して作り直します。
+ *	前回と同じアドレスにマップできるように、前回のアドレスをmmap()のヒントにします。
+ */
+#if defined(MDDL_MALLOCATER_HAS_MMAP) && defined(_MDDL_MALLOCATER_COMPACT_HEADER)
+#define MDDL_MALLOCATER_HAS_PERSIST
+#define PERSIST_MAGIC "MDDLHEAP"
+#define PERSIST_VERSION 1
+#define PERSIST_HEADER_SIZE 4096
+#define PERSIST_LAYOUT ((uint32_t)((SIZEOF_ALLOCATEHEADER << 16) | (SIZEOF_ALLOCATEFOOTER << 8) | ALLOCATER_ALIGN))
+
+typedef struct _mddl_mallocater_persist_header {
+    char magic[8];		/* PERSIST_MAGIC */
+    uint32_t version;		/* PERSIST_VERSION */
+    uint32_t layout;		/* PERSIST_LAYOUT */
+    uint64_t mapsiz;		/* ファイルサイズ */
+    uint64_t map_addr;		/* 前回マップしたアドレス */
+    uint64_t root_ofs;		/* ルートオブジェクトのファイル先頭からの位置(0はNULL) */
+    uint64_t htab_ofs;		/* ハンドル表の位置(0は無し) */
+    uint32_t htab_cnt;
+    uint32_t htab_free;
+} mddl_mallocater_persist_header_t;
+
+/**
+ * @fn static int persist_check(mddl_mallocater_t *const self_p, const void *const map, const size_t mapsiz)
+ * @brief マップしたファイルのヒープを読むだけで検査します
+ *	mddl_mallocater_verify_with_obj()と同じ条件を、フッタは前回のアドレスで確かめます。
+ *	self_pにはheap_geometry()で範囲だけを設定しておいてください。
  * @param self_p オブジェクトインスタンスポインタ
- * @param ptr 開放するバッファのポインタ
+ * @param map マップしたファイルの先頭
+ * @param mapsiz マップしたサイズ
+ * @retval 0 成功
+ * @retval EFAULT ヒープが壊れている
  */
-void mddl_mallocater_free_with_obj(mddl_mallocater_t *const self_p, void * const ptr)
+static int persist_check(mddl_mallocater_t *const self_p, const void *const map, const size_t mapsiz)
 {
-    mddl_malllocate_header_t *cur;
-    int result;
-    const char *const myfunc=__FUNCTION__;
-    DBMS5(  "mddl_mallocater_free_with_obj : execute" EOL_CRLF);
+    const mddl_mallocater_t * const o = self_p;
+    const mddl_mallocater_persist_header_t *const ph = (const mddl_mallocater_persist_header_t*)map;
+    const uintptr_t delta = (uintptr_t)map - (uintptr_t)ph->map_addr;
+    const mddl_malllocate_header_t *base, *h, *prev;
+    uintptr_t expect, end;
+    uint32_t n;
+
+    base = HEAD_BASE(o);
+    if( HEAD_MAGIC_IS_NG(base) || !AREA_IS_ALLOC(base) ) {
+	return EFAULT;
+    }
 
-    if(!self_p->init.f.initialized ) {
-	errno = EPERM;
-	abort();
+    /* 領域は隙間なく並んでいるので、アドレス順に辿れることを確かめる */
+    expect = (uintptr_t)o->buf + SIZEOF_SENTINEL;
+    end = (uintptr_t)o->buf + o->initsiz;
+    for( prev=base, h=HEAD_NEXT(base); h != base; prev=h, h=HEAD_NEXT(h) ) {
+	if( ((uintptr_t)h != expect) || (h->size < SIZEOF_MINAREA) || (h->size & (ALLOCATER_ALIGN - 1))
+		|| (h->size > (end - (uintptr_t)h)) || HEAD_MAGIC_IS_NG(h) || (HEAD_PREV(h) != prev)
+		|| (*(const mddl_mallocater_footer_t*)GET_FOOTER_PTR(h) != (mddl_mallocater_footer_t)((uintptr_t)h - delta))
+		|| ((prev != base) && AREA_IS_FREE(prev) && AREA_IS_FREE(h)) ) {
+	    DBMS("%s : broken area 0x%p" EOL_CRLF, __func__, h);
+	    return EFAULT;
+	}
+	expect += h->size;
+    }
+    if( (expect != end) || (HEAD_PREV(base) != prev) ) {
+	return EFAULT;
     }
-    if(!ptr) return;
 
-    /* dealloc するヘッダを得る */
-    cur = GET_PTR2HEAD(ptr);
+    /* ハンドル表は付け替え後のポインタがヒープ内に収まること */
+    if( ph->htab_ofs ) {
+	const mddl_mallocater_handle_entry_t *tab;
 
-    /* ヘッダー フッターのチェック */
-    result = region_pointer_check(self_p, cur);
-    if(result) {
-	DBMS("%s : pre chk err" EOL_CRLF, myfunc);
-	// _mddl_mallocater_dump_region_list(self_p);
-	abort();
+	if( (ph->htab_ofs < PERSIST_HEADER_SIZE) || (ph->htab_ofs >= mapsiz) || (0 == ph->htab_cnt)
+		|| (((mapsiz - ph->htab_ofs) / sizeof(mddl_mallocater_handle_entry_t)) < ph->htab_cnt)
+		|| (ph->htab_free > ph->htab_cnt) ) {
+	    return EFAULT;
+	}
+	tab = (const mddl_mallocater_handle_entry_t*)((uintptr_t)map + (uintptr_t)ph->htab_ofs);
+	for( n=0; n < ph->htab_cnt; ++n ) {
+	    const uintptr_t ptr = (uintptr_t)tab[n].ptr + delta;
+	    if( (NULL != tab[n].ptr) && ((ptr < (uintptr_t)o->buf) || (ptr >= end)) ) {
+		return EFAULT;
+	    }
+	}
     }
 
-    /* もし直前が空きブロックだったら、 併合して1つの領域にする */
-//    if (!(cur->prev_p->stamp.occupied & ALLOCATED_FLAG) ) {
-    if (AREA_IS_FREE(cur->prev_p)) {
-	(cur->next_p)->prev_p = cur->prev_p;
-	(cur->prev_p)->next_p = cur->next_p;
-	(cur->prev_p)->size += cur->size;
-	cur = cur->prev_p;
+    return 0;
+}
+
+/**
+ * @fn static int persist_attach(mddl_mallocater_t *const self_p, void *const map, const size_t mapsiz)
+ * @brief マップしたファイルのヒープを検査して、オブジェクトを組み立てます
+ *	検査はpersist_check()で書き込まずに行うので、壊れたファイルは変更しません。
+ *	検査に通った後でフッタを付け替えて空きリストを作り、verifyで確認してから
+ *	サンプリングの印とハンドル表を書き換えます。verifyに失敗した場合はフッタを元に戻します
+ *	(空き領域の中身は空きリストの作業領域なので、元の値は保存しません)。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param map マップしたファイルの先頭
+ * @param mapsiz マップしたサイズ
+ * @retval 0 成功
+ * @retval EFAULT ヒープが壊れている
+ */
+static int persist_attach(mddl_mallocater_t *const self_p, void *const map, const size_t mapsiz)
+{
+    mddl_mallocater_t * const o = self_p;
+    const mddl_mallocater_persist_header_t *const ph = (const mddl_mallocater_persist_header_t*)map;
+    const uintptr_t delta = (uintptr_t)map - (uintptr_t)ph->map_addr;
+    mddl_malllocate_header_t *base, *h;
+    uint32_t n;
+
+    memset(o, 0x0, sizeof(mddl_mallocater_t));
+    heap_geometry(o, (void*)((uintptr_t)map + PERSIST_HEADER_SIZE), mapsiz - PERSIST_HEADER_SIZE);
+    o->check_level = MDDL_MALLOCATER_CHECK_FULL;
+    o->pagesize = (size_t)sysconf(_SC_PAGESIZE);
+
+    if( persist_check(o, map, mapsiz) ) {
+	return EFAULT;
     }
 
-    /* もし、 直後が空きブロックだったら、 併合して1つの領域にする */
-//    if (!(cur->next_p->stamp.occupied & ALLOCATED_FLAG)) {
-    if (AREA_IS_FREE(cur->next_p)) {
-	((cur->next_p)->next_p)->prev_p = cur;
-	cur->size  += (cur->next_p)->size;
-	cur->next_p = (cur->next_p)->next_p;
+    base = HEAD_BASE(o);
+    for( h=HEAD_NEXT(base); h != base; h=HEAD_NEXT(h) ) {
+	SET_FOOTER(h);
+	if( AREA_IS_FREE(h) ) {
+	    free_index_insert(o, h);
+	} else {
+	    stats_add_live(o, h->size, 0);
+	    ++(o->stats.live_blocks);
+	}
     }
+    o->init.f.initialized = 1;
 
-    /* 空きブロックのマークをつける */
-    cur->stamp.occupied = MAGIC_NO;
-    cur->stamp.occupied &= ~ALLOCATED_FLAG;
-    *(uintptr_t*)GET_FOOTER_PTR(cur) = (uintptr_t)cur;
+    /* 組み立てたインデックスも含めて最終確認する */
+    if( mddl_mallocater_verify_with_obj(o, NULL) ) {
+	for( h=HEAD_NEXT(base); h != base; h=HEAD_NEXT(h) ) {
+	    *(mddl_mallocater_footer_t*)GET_FOOTER_PTR(h) = (mddl_mallocater_footer_t)((uintptr_t)h - delta);
+	}
+	o->init.f.initialized = 0;
+	return EFAULT;
+    }
 
-    /* ヘッダー フッターの再チェック */
-    result = region_pointer_check(self_p, cur);
-    if(result) {
-	DBMS("%s : post chk err" EOL_CRLF, myfunc);
-	// _mddl_mallocater_dump_region_list(self_p);
-	abort();
+    for( h=HEAD_NEXT(base); h != base; h=HEAD_NEXT(h) ) {
+	h->stamp.occupied &= ~SAMPLED_FLAG;
+    }
+
+    /* ハンドル表のポインタを付け替える。ロックは引き継がない */
+    if( ph->htab_ofs ) {
+	mddl_mallocater_handle_entry_t *const tab =
+	    (mddl_mallocater_handle_entry_t*)((uintptr_t)map + (uintptr_t)ph->htab_ofs);
+	for( n=0; n < ph->htab_cnt; ++n ) {
+	    if( NULL != tab[n].ptr ) {
+		tab[n].ptr = (void*)((uintptr_t)tab[n].ptr + delta);
+	    }
+	    tab[n].lock_cnt = 0;
+	}
+	o->htab = tab;
+	o->htab_cnt = ph->htab_cnt;
+	o->htab_free = ph->htab_free;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn static void persist_write_header(mddl_mallocater_t *const self_p)
+ * @brief ファイルの管理情報を現在の状態に更新します
+ */
+static void persist_write_header(mddl_mallocater_t *const self_p)
+{
+    mddl_mallocater_persist_header_t *const ph = (mddl_mallocater_persist_header_t*)self_p->persist.map;
+
+    ph->map_addr = (uint64_t)(uintptr_t)self_p->persist.map;
+    ph->htab_ofs = (NULL == self_p->htab) ? 0 : (uint64_t)((uintptr_t)self_p->htab - (uintptr_t)self_p->persist.map);
+    ph->htab_cnt = self_p->htab_cnt;
+    ph->htab_free = self_p->htab_free;
+}
+#endif /* end of MDDL_MALLOCATER_HAS_PERSIST */
+
+/**
+ * @fn int mddl_mallocater_persist_open_with_obj(mddl_mallocater_t *const self_p, const char *const path, const size_t size, int *const attached_p)
+ * @brief ファイルにマップした永続ヒープを作成、または既存のものに接続します
+ *	pathが無いか空の場合はsizeのファイルを作って初期化し、既存の場合はファイルのヒープを検査して接続します。
+ *	接続はヒープの領域数に比例する走査だけなので、構築済みのデータを作り直すより速く再開できます。
+ *	前回と同じアドレスにマップできなかった場合、ヒープ内のデータが持つ絶対アドレスは無効になるので、
+ *	ヒープ内ではルートオブジェクトからの相対位置かハンドルで参照してください。
+ *	永続ヒープでは領域の追加、成長、スラブは使えません。複数プロセスからの同時使用はできません。
+ *	_MDDL_MALLOCATER_COMPACT_HEADERを定義したPOSIX環境でのみ使えます。
+ * @param self_p オブジェクトインスタンスポインタ(初期化前)
+ * @param path ファイル名
+ * @param size 新規作成時のファイルサイズ(既存の場合は無視)
+ * @param attached_p 既存のヒープに接続した場合は1、新規に作成した場合は0(NULL可)
+ * @retval 0 成功
+ * @retval EINVAL pathがNULL、またはファイルが永続ヒープではない(形式・レイアウトが異なる)
+ * @retval EFAULT ヒープが壊れている
+ * @retval ENOMEM sizeが小さすぎる
+ * @retval ERANGE sizeが1GiB以上
+ * @retval ENOSYS 永続ヒープが使えないビルド
+ * @retval 上記以外 open()/mmap()等のerrno
+ */
+int mddl_mallocater_persist_open_with_obj(mddl_mallocater_t *const self_p, const char *const path, const size_t size, int *const attached_p)
+{
+#if defined(MDDL_MALLOCATER_HAS_PERSIST)
+    mddl_mallocater_persist_header_t hdr, *ph;
+    mddl_mallocater_attr_t attr;
+    struct stat st;
+    void *hint = NULL, *map;
+    size_t mapsiz;
+    int fd, attach = 0, result;
+
+    if( NULL == path ) {
+	return EINVAL;
+    }
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if( fd < 0 ) {
+	return errno;
+    }
+    if( fstat(fd, &st) ) {
+	result = errno;
+	close(fd);
+	return result;
+    }
+
+    if( 0 == st.st_size ) {
+	if( size <= PERSIST_HEADER_SIZE ) {
+	    close(fd);
+	    return ENOMEM;
+	} else if( (size - PERSIST_HEADER_SIZE) >= COMPACT_SPAN ) {
+	    close(fd);
+	    return ERANGE;
+	} else if( ftruncate(fd, (off_t)size) ) {
+	    result = errno;
+	    close(fd);
+	    return result;
+	}
+	mapsiz = size;
+    } else {
+	mapsiz = (size_t)st.st_size;
+	if( (sizeof(hdr) != pread(fd, &hdr, sizeof(hdr), 0))
+		|| memcmp(hdr.magic, PERSIST_MAGIC, sizeof(hdr.magic))
+		|| (PERSIST_VERSION != hdr.version) || (PERSIST_LAYOUT != hdr.layout)
+		|| (hdr.mapsiz != (uint64_t)mapsiz) || (mapsiz <= PERSIST_HEADER_SIZE) ) {
+	    close(fd);
+	    return EINVAL;
+	}
+	hint = (void*)(uintptr_t)hdr.map_addr;
+	attach = 1;
+    }
+
+    map = mmap(hint, mapsiz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if( MAP_FAILED == map ) {
+	result = errno;
+	close(fd);
+	return result;
+    }
+
+    if( attach ) {
+	result = persist_attach(self_p, map, mapsiz);
+    } else {
+	/* 新しいファイルは0で埋まっているので、初期化時の0クリアを省く */
+	memset(&attr, 0x0, sizeof(attr));
+	attr.ext.f.zero_filled = 1;
+	result = mddl_mallocater_init_obj_ex(self_p, (void*)((uintptr_t)map + PERSIST_HEADER_SIZE),
+		mapsiz - PERSIST_HEADER_SIZE, &attr);
+	if( !result ) {
+	    ph = (mddl_mallocater_persist_header_t*)map;
+	    memset(ph, 0x0, sizeof(mddl_mallocater_persist_header_t));
+	    memcpy(ph->magic, PERSIST_MAGIC, sizeof(ph->magic));
+	    ph->version = PERSIST_VERSION;
+	    ph->layout = PERSIST_LAYOUT;
+	    ph->mapsiz = (uint64_t)mapsiz;
+	}
+    }
+    if( result ) {
+	self_p->init.f.initialized = 0;
+	munmap(map, mapsiz);
+	close(fd);
+	return result;
+    }
+
+    /* 管理情報は検査に通ってから書き換える */
+    self_p->persist.map = map;
+    self_p->persist.mapsiz = mapsiz;
+    self_p->persist.fd = fd;
+    persist_write_header(self_p);
+
+    if( NULL != attached_p ) {
+	*attached_p = attach;
+    }
+
+    return 0;
+#else
+    (void)self_p;
+    (void)path;
+    (void)size;
+    (void)attached_p;
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn int mddl_mallocater_persist_sync_with_obj(mddl_mallocater_t *const self_p)
+ * @brief 永続ヒープの内容をファイルに書き出します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 永続ヒープではない
+ * @retval 上記以外 msync()のerrno
+ */
+int mddl_mallocater_persist_sync_with_obj(mddl_mallocater_t *const self_p)
+{
+#if defined(MDDL_MALLOCATER_HAS_PERSIST)
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == self_p->persist.map ) {
+	return EINVAL;
+    }
+    persist_write_header(self_p);
+
+    return (msync(self_p->persist.map, self_p->persist.mapsiz, MS_SYNC)) ? errno : 0;
+#else
+    (void)self_p;
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn int mddl_mallocater_persist_close_with_obj(mddl_mallocater_t *const self_p)
+ * @brief 永続ヒープをファイルに書き出して切り離します
+ *	mddl_mallocater_destroy()も永続ヒープではこの関数を呼びます。プロファイラは停止します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 永続ヒープではない
+ * @retval 上記以外 msync()のerrno(切り離しは行います)
+ */
+int mddl_mallocater_persist_close_with_obj(mddl_mallocater_t *const self_p)
+{
+#if defined(MDDL_MALLOCATER_HAS_PERSIST)
+    int result;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == self_p->persist.map ) {
+	return EINVAL;
+    }
+    if( NULL != self_p->prof ) {
+	mddl_mallocater_prof_stop_with_obj(self_p);
+    }
+
+    result = mddl_mallocater_persist_sync_with_obj(self_p);
+    munmap(self_p->persist.map, self_p->persist.mapsiz);
+    close(self_p->persist.fd);
+    self_p->persist.map = NULL;
+    self_p->init.f.initialized = 0;
+
+    return result;
+#else
+    (void)self_p;
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn int mddl_mallocater_persist_set_root_with_obj(mddl_mallocater_t *const self_p, void *const root)
+ * @brief 永続ヒープのルートオブジェクトを設定します
+ *	再接続後にmddl_mallocater_persist_get_root_with_obj()で取り出せます。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param root ヒープ内のポインタ(NULLで解除)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 永続ヒープではない、またはrootがヒープの外
+ */
+int mddl_mallocater_persist_set_root_with_obj(mddl_mallocater_t *const self_p, void *const root)
+{
+#if defined(MDDL_MALLOCATER_HAS_PERSIST)
+    mddl_mallocater_persist_header_t *ph;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == self_p->persist.map ) {
+	return EINVAL;
+    } else if( (NULL != root) && !area_in_heap(self_p, root, 1) ) {
+	return EINVAL;
+    }
+    ph = (mddl_mallocater_persist_header_t*)self_p->persist.map;
+    ph->root_ofs = (NULL == root) ? 0 : (uint64_t)((uintptr_t)root - (uintptr_t)self_p->persist.map);
+
+    return 0;
+#else
+    (void)self_p;
+    (void)root;
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn void *mddl_mallocater_persist_get_root_with_obj(mddl_mallocater_t *const self_p)
+ * @brief 永続ヒープのルートオブジェクトを取得します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval NULL 設定されていない、または永続ヒープではない
+ * @retval NULL以外 ルートオブジェクト
+ */
+void *mddl_mallocater_persist_get_root_with_obj(mddl_mallocater_t *const self_p)
+{
+#if defined(MDDL_MALLOCATER_HAS_PERSIST)
+    const mddl_mallocater_persist_header_t *ph;
+
+    if( !self_p->init.f.initialized || (NULL == self_p->persist.map) ) {
+	return NULL;
     }
+    ph = (const mddl_mallocater_persist_header_t*)self_p->persist.map;
 
-    return;
+    return (ph->root_ofs) ? (void*)((uintptr_t)self_p->persist.map + (uintptr_t)ph->root_ofs) : NULL;
+#else
+    (void)self_p;
+    return NULL;
+#endif
 }
 
 /**
@@ -483,177 +3362,198 @@ void _mddl_mallocater_dump_region_list(mddl_mallocater_t const *const self_p)
     DBMS5(  "%s : execute" EOL_CRLF, __func__);
 
     DMSG(  "mallocater_dump_region" EOL_CRLF);
-    DMSG(  "self_p=0x%p &self_p->base=0x%p" EOL_CRLF, self_p, self_p->base);
+    DMSG(  "self_p=0x%p &self_p->base=0x%p" EOL_CRLF, self_p, HEAD_BASE(self_p));
 
 
     /* 後方確認 */
     DMSG(  "backword list" EOL_CRLF);
-    for( p=self_p->base.next_p, n=0; p != &self_p->base; p=p->next_p, ++n ) {
+    for( p=HEAD_NEXT(HEAD_BASE(self_p)), n=0; p != HEAD_BASE(self_p); p=HEAD_NEXT(p), ++n ) {
 	magic_is = HEAD_MAGIC_IS_NG(p) ? "NG" : "OK";
 	flag = AREA_IS_ALLOC(p) ? (AREA_FOOTER_IS_NG(p) ? "allocNG" :"allocOK") : "free";
 	// dfmt = "%04d:p=0x%p(buf_ptr:%p) magic_is=%s size=%s FLAG=%s next_ptr=%p" EOL_CRLF;
-	DMSG(  dfmt, n, p, (intptr_t)GET_HEAD2PTR(p), magic_is, p->size, flag, (uintptr_t)&(p->next_p));
+	DMSG(  dfmt, n, p, (intptr_t)GET_HEAD2PTR(p), magic_is, p->size, flag, (uintptr_t)HEAD_NEXT(p));
     }
 
     /* 前方確認 */
     DMSG(  "forword list" EOL_CRLF);
-    for( p=self_p->base.prev_p; p != &self_p->base; p=p->prev_p, --n ) {
+    for( p=HEAD_PREV(HEAD_BASE(self_p)); p != HEAD_BASE(self_p); p=HEAD_PREV(p), --n ) {
 	magic_is = HEAD_MAGIC_IS_NG(p) ? "NG" : "OK";
 	flag = AREA_IS_ALLOC(p) ? (AREA_FOOTER_IS_NG(p) ? "allocNG" :"allocOK") : "free";
 	// dfmt = "%04d:p=0x%p(buf_ptr:%p) magic_is=%s size=%s FLAG=%s next_ptr=%p" EOL_CRLF;
-	DMSG(  dfmt, n, p, (intptr_t)GET_HEAD2PTR(p), magic_is, p->size, flag, (uintptr_t)&(p->next_p));
+	DMSG(  dfmt, n, p, (intptr_t)GET_HEAD2PTR(p), magic_is, p->size, flag, (uintptr_t)HEAD_NEXT(p));
     }
 
     return;
 }
 
+/**
+ * @fn static void area_split_tail(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h, const size_t totalsz)
+ * @brief 使用中の領域をtotalszに縮め、余った後半を空き領域として戻します
+ *	後半が最小領域に満たない場合は何もしません。直後が空き領域なら併合します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param h 使用中の領域のヘッダ
+ * @param totalsz 縮小後の領域サイズ(ヘッダ・フッタ込み)
+ */
+static void area_split_tail(mddl_mallocater_t *const self_p, mddl_malllocate_header_t *const h, const size_t totalsz)
+{
+    mddl_malllocate_header_t *s, *n;
+
+    if((h->size - totalsz) < SIZEOF_MINAREA ) {
+	return;
+    }
+
+    s = (mddl_malllocate_header_t*)((uintptr_t)h + totalsz);
+    s->size = h->size - totalsz;
+    n = HEAD_NEXT(h);
+    if( AREA_IS_FREE(n) ) {
+	/* 直後の空き領域と併合する */
+	free_index_remove(self_p, n);
+	s->size += n->size;
+	n = HEAD_NEXT(n);
+    }
+
+    /* sを双方向リンクに追加 */
+    HEAD_SET_PREV(n, s);
+    HEAD_SET_NEXT(s, n);
+    HEAD_SET_NEXT(h, s);
+    HEAD_SET_PREV(s, h);
+
+    s->stamp.magic_no = MAGIC_NO;
+    s->stamp.occupied &= ~ALLOCATED_FLAG;
+    SET_FOOTER(s);
+    free_index_insert(self_p, s);
+
+    h->size = totalsz;
+    SET_FOOTER(h);
+}
+
 /**
  * @fn void *mddl_mallocater_realloc_with_obj(mddl_mallocater_t *const self_p, void *const ptr, const size_t size)
  * @brief ポインター ptr が示すメモリーブロックのサイズを size バイト に変更する。
- *     開発途上なのでまだ使えません。 * @param ptr 変更前のバッファポインタ
+ *	縮小はその場で行い、拡張は隣接する空き領域を取り込んでその場で行います。
+ *	前方の空き領域を取り込んだ場合はデータを前方に移動します。
+ *	どちらもできない場合に限り、新しい領域を確保してコピーし、元の領域を開放します。
  * @param self_p オブジェクトインスタンスポインタ
+ * @param ptr 変更前のバッファポインタ(NULLの場合はmddl_mallocater_alloc_with_obj()と同等)
  * @param size 変更後のサイズ
- * @retval NULL 失敗
+ * @retval NULL 失敗(errno参照。ptrの領域はそのまま残ります)
  * @retval NULL以外 成功
  **/
 void *mddl_mallocater_realloc_with_obj(mddl_mallocater_t *const self_p, void *const ptr, const size_t size)
 {
-     void *retptr = NULL;
-	(void)self_p;
-    (void)ptr;
-    (void)size;
-#if 0
-    mddl_mallocater_t * const o = self_p;
-    mddl_malllocate_header_t *cur;
+    mddl_malllocate_header_t *cur, *n, *b;
+    mddl_mallocater_slab_t *slab;
     int result;
     void *retptr = NULL;
-    const char *const myfunc = __FUNCTION__;
+    const size_t totalsz = AREASIZE_OF(size);
+    size_t oldsz;
 
-    DBMS5(  "%s : execute" EOL_CRLF, myfunc);
+    DBMS5(  "%s : execute" EOL_CRLF, __func__);
 
     if( NULL == ptr ) {
-	return mddl_mallocater_alloc_with_obj(o, size);
+	return mddl_mallocater_alloc_with_obj(self_p, size);
+    }
+
+    if(!self_p->init.f.initialized ) {
+	errno = EPERM;
+	return NULL;
+    } else if (( totalsz == 0 ) || ( totalsz < size )) {
+	++(self_p->stats.failed_cnt);
+	errno = EINVAL;
+	return NULL;
+    }
+
+    slab = slab_lookup(self_p, ptr);
+    if( NULL != slab ) {
+	/* スラブのオブジェクトはスロットに収まれば、そのまま返す */
+	if( size <= slab->objsize ) {
+	    ++(self_p->stats.realloc_cnt);
+	    return ptr;
+	}
+	retptr = mddl_mallocater_alloc_with_obj(self_p, size);
+	if( NULL != retptr ) {
+	    ++(self_p->stats.realloc_cnt);
+	    own_memmove( retptr, ptr, slab->objsize);
+	    mddl_mallocater_free_with_obj(self_p, ptr);
+	}
+	return retptr;
     }
 
     /* 指定された領域がオーバーフローしていないことを確認する */
     cur = GET_PTR2HEAD (ptr);
     result = region_pointer_check(self_p, cur);
     if(result) {
-	// DMSG(  "%s : cur prechk err" EOL_CRLF, myfunc);
+	DBMS("%s : cur prechk err" EOL_CRLF, __func__);
 	// _mddl_mallocater_dump_region_list(self_p);
 	abort();
     }
-    /* reallocサイズが小さい場合 */
-    if( GET_BUFSIZE(cur) >= size ) {
-	size_t freearea = GET_BUFSIZE(cur) - size;
-	if( freearea > TOTALAREASIZE(1) ) {
-	    const size_t totalsz = freearea - GET_BUFSIZE(cur);
-	    mddl_malllocate_header_t *new = (mddl_malllocate_header_t*)((intptr_t)cur+cur->size);
-	    new->stamp.magic_no = MAGIC_NO;
-	    new->stamp.occupied &= ~ALLOCATED_FLAG;
-	    new->size = totalsz;
-	    *(uintptr_t*)GET_FOOTER_PTR(new) = (uintptr_t)new;
-	    /* リンクリストに追加 */
-	    (cur->next_p)->prev_p = (void*)new;
-	    new->next_p = cur->next_p;
-	    cur->next_p = (void*)new;
-	    new->prev_p = (void*)cur;
-	    retptr = ptr;
-	}
-    } 
-    /* reallocサイズが大きい場合 */
-    if ((retptr == NULL) &&(cur->next_p != &o->base)) {
-        /* 後方が空き領域だったら合併できるか確かめる */
-	mddl_malllocate_header_t *n = (mddl_malllocate_header_t*)cur->next_p;
-	/* 後方バッファが空であることを確認する */
-	if(AREA_IS_FREE(n)) {
-	    const size_t totalsz = TOTALAREASIZE(size);
-	    if((cur->size + n->size) <= totalsz ) {
-		const size_t freearea = totalsz - (cur->size + n->size);
-		if( freearea == 0 || (freearea < TOTALAREASIZE(1))) {
-		    /* 後方エリアを破棄してつなげる */
-		    cur->size += n->size;
-		    (n->next_p)->prev_p = cur;
-		    cur->next_p = n->next_p;
-		    *(uintptr_t*)GET_FOOTER_PTR(cur) = (uintptr_t)cur;
-		    retptr = ptr; /* 完了 */
-		} else {
-		    /* 後方エリアを再定義する */
-		    n = (mddl_malllocate_header_t*)((uintptr_t)cur + totalsz);
-		    n->size = freearea;
-		    n->stamp.magic_no = MAGIC_NO;
-		    n->stamp.occupied &= ~ALLOCATED_FLAG;
-		    *(uintptr_t*)GET_FOOTER_PTR(n) = (uintptr_t)n;
-
-		    /* sを双方向リンクに追加 */
-		    (cur->next_p)->prev_p = (void*)n;
-		    n->next_p = cur->next_p;
-		    cur->next_p = (void*)n;
-		    n->prev_p = (void*)cur;
-		    retptr = ptr; /* 完了 */
-		}
-	    }
-	}
-    }
 
-    /* 前方が空き領域だったら合併できるか確かめる */
-    if((NULL == retptr) && (cur->prev_p != &o->base) ) {
-	mddl_malllocate_header_t *b = (mddl_malllocate_header_t*)cur->prev_p;
-	/* 前方バッファが空であることを確認する */
-	if(AREA_IS_FREE(b)) {
-	    const size_t totalsz = TOTALAREASIZE(size);
-	    if((cur->size + b->size) <= totalsz ) {
-		const size_t freearea = totalsz - (cur->size + b->size);
-		if( freearea > TOTALAREASIZE(0) ) {
-		    /* 残りのエリアがヘッダ部よりも大きかったら空エリアとして登録 */
-		    mddl_malllocate_header_t *new = (mddl_malllocate_header_t*)((intptr_t)cur + totalsz);
-		    /* 最初にデータを移動する */
-		    own_memmove( GET_HEAD2PTR(b), ptr, cur->size - SIZEOF_ALLOCATEHEADER);
-		    /* ヘッダ作成 */
-		    new->size = freearea;
-		    new->stamp.magic_no = MAGIC_NO;
-		    new->stamp.occupied &= ~ALLOCATED_FLAG;
-		    /* newを双方向リンクに追加 */
-		    (b->next_p)->prev_p = (void*)new;
-		    new->next_p = b->next_p;
-		    b->next_p = (void*)new;
-		    new->prev_p = b;
-
-		    retptr = GET_HEAD2PTR(b); /* 完了 */
-		} else {
-		    /* サイズを調整して結合する */
-		    b->size += cur->size;
-		    b->stamp.occupied |= ALLOCATED_FLAG;
-		    *(uintptr_t*)GET_FOOTER_PTR(b) = (uintptr_t)b;
-		    /* カレントを破棄する */
-		    b->next_p = (void*)cur->next_p;
-		    (cur->next_p)->prev_p = (void*)b;
-
-		    /* 最後にデータを移動する */
-		    own_memmove( GET_HEAD2PTR(b), ptr, cur->size - SIZEOF_ALLOCATEHEADER);
-		    retptr = GET_HEAD2PTR(b); /* 完了 */
-		}
-	    }
+    n = HEAD_NEXT(cur);
+    b = HEAD_PREV(cur);
+    oldsz = cur->size;
+    ++(self_p->stats.realloc_cnt);
+
+    if( cur->size >= totalsz ) {
+	/* reallocサイズが小さい場合は後半を切り離す */
+	area_split_tail(self_p, cur, totalsz);
+	stats_add_live(self_p, cur->size, oldsz);
+	retptr = ptr;
+    } else if( AREA_IS_FREE(n) && ((cur->size + n->size) >= totalsz) ) {
+	/* 後方の空き領域を取り込んで拡張する */
+	free_index_remove(self_p, n);
+	HEAD_SET_PREV(HEAD_NEXT(n), cur);
+	HEAD_SET_NEXT(cur, HEAD_NEXT(n));
+	cur->size += n->size;
+	SET_FOOTER(cur);
+	area_split_tail(self_p, cur, totalsz);
+	stats_add_live(self_p, cur->size, oldsz);
+	retptr = ptr;
+    } else if( AREA_IS_FREE(b) &&
+	    ((b->size + cur->size + (AREA_IS_FREE(n) ? n->size : 0)) >= totalsz) ) {
+	/* 前方(と後方)の空き領域を取り込み、データを前方へ移動する */
+	const size_t datasz = GET_BUFSIZE(cur);
+	const int sampled = AREA_IS_SAMPLED(cur);
+
+	if( AREA_IS_FREE(n) ) {
+	    free_index_remove(self_p, n);
+	    HEAD_SET_PREV(HEAD_NEXT(n), cur);
+	    HEAD_SET_NEXT(cur, HEAD_NEXT(n));
+	    cur->size += n->size;
 	}
-    }
-
-    if( NULL == retptr ) {
+	free_index_remove(self_p, b);
+	HEAD_SET_NEXT(b, HEAD_NEXT(cur));
+	HEAD_SET_PREV(HEAD_NEXT(cur), b);
+	b->size += cur->size;
+
+	/* curのヘッダは上書きされるので、リンクの更新後にデータを移動する */
+	own_memmove( GET_HEAD2PTR(b), ptr, datasz);
+
+	b->stamp.magic_no = MAGIC_NO;
+	b->stamp.occupied |= ALLOCATED_FLAG;
+	SET_FOOTER(b);
+	if( sampled ) {
+	    prof_move(self_p, ptr, b);
+	}
+	area_split_tail(self_p, b, totalsz);
+	stats_add_live(self_p, b->size, oldsz);
+	cur = b;
+	retptr = GET_HEAD2PTR(b);
+    } else {
 	/* 他に空き領域があったら入る場所を探す */
-	void *  __restrict new_ptr = NULL;
-	new_ptr = mddl_mallocater_alloc(size);
+	/* 新しい領域はスラブの場合があるので、確保時のチェックで済ませる */
+	void *new_ptr = mddl_mallocater_alloc_with_obj(self_p, size);
 	if( NULL != new_ptr ) {
-	    own_memmove( new_ptr, ptr, cur->size);
-	    mddl_mallocater_free(ptr);
-	    retptr = new_ptr;
+	    own_memmove( new_ptr, ptr, GET_BUFSIZE(cur));
+	    mddl_mallocater_free_with_obj(self_p, ptr);
+	    return new_ptr;
 	}
     }
 
     if( NULL != retptr) {
 	/* 最後にチェック */
-	cur = GET_PTR2HEAD (ptr);
 	result = region_pointer_check(self_p, cur);
         if(result) {
-	    // DMSG(  "%s : cur postchk err" EOL_CRLF, myfunc);
+	    DBMS("%s : cur postchk err" EOL_CRLF, __func__);
 	    // _mddl_mallocater_dump_region_list(self_p);
 	    abort();
 	}
@@ -661,12 +3561,232 @@ void *mddl_mallocater_realloc_with_obj(mddl_mallocater_t *const self_p, void *co
 	/* だめでした */
 	errno = ENOMEM;
     }
-#else
-    errno = ENOSYS;
-#endif    
+
     return retptr;
 }
 
+#if defined(_MDDL_MALLOCATER_TRACE)
+#undef mddl_mallocater_alloc_with_obj
+#undef mddl_mallocater_alloc_hint_with_obj
+#undef mddl_mallocater_free_with_obj
+#undef mddl_mallocater_realloc_with_obj
+#undef mddl_mallocater_alloc_batch_with_obj
+#undef mddl_mallocater_free_batch_with_obj
+
+/**
+ * @fn static uint64_t trace_now_ns(void)
+ * @brief トレースのタイムスタンプ用の単調増加時刻を取得します
+ * @return ナノ秒単位の時刻(取得できない環境では0)
+ */
+static uint64_t trace_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if( clock_gettime(CLOCK_MONOTONIC, &ts) ) {
+	return 0;
+    }
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @fn static int trace_flush(mddl_mallocater_t *const self_p)
+ * @brief バッファに溜めたトレースレコードをファイルに書き出します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EIO 書き込みに失敗した
+ */
+static int trace_flush(mddl_mallocater_t *const self_p)
+{
+    const size_t nrec = self_p->trace.nrec;
+
+    self_p->trace.nrec = 0;
+    if( nrec != fwrite(self_p->trace.rec, sizeof(mddl_mallocater_trace_record_t), nrec, (FILE*)self_p->trace.fp) ) {
+	return EIO;
+    }
+    return 0;
+}
+
+/**
+ * @fn static void trace_put(mddl_mallocater_t *const self_p, const uint32_t op, const void *const id, const void *const id2, const size_t size, const uint32_t arg)
+ * @brief トレースレコードを1件記録します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param op enum_mddl_mallocater_trace_op_t
+ * @param id 対象のポインタ
+ * @param id2 結果のポインタ
+ * @param size 要求サイズ
+ * @param arg 付加情報
+ */
+static void trace_put(mddl_mallocater_t *const self_p, const uint32_t op, const void *const id, const void *const id2, const size_t size, const uint32_t arg)
+{
+    mddl_mallocater_trace_record_t *r;
+    const int err = errno;	/* 呼び出し元の結果を保つ */
+
+    if( NULL == self_p->trace.fp ) {
+	return;
+    }
+    r = &self_p->trace.rec[self_p->trace.nrec];
+    r->ts_ns = trace_now_ns() - self_p->trace.t0_ns;
+    r->id = (uint64_t)(uintptr_t)id;
+    r->id2 = (uint64_t)(uintptr_t)id2;
+    r->size = (uint64_t)size;
+    r->op = op;
+    r->arg = arg;
+
+    if( ++(self_p->trace.nrec) == MDDL_MALLOCATER_TRACE_BUFCNT ) {
+	if( trace_flush(self_p) ) {
+	    DBMS("%s : trace write error, stop tracing" EOL_CRLF, __func__);
+	    fclose((FILE*)self_p->trace.fp);
+	    self_p->trace.fp = NULL;
+	}
+    }
+    errno = err;
+}
+
+void *mddl_mallocater_alloc_with_obj(mddl_mallocater_t *const self_p, const size_t sz)
+{
+    void *const ptr = trace_body_alloc(self_p, sz);
+
+    trace_put(self_p, MDDL_MALLOCATER_TRACE_OP_ALLOC, NULL, ptr, sz, MDDL_MALLOCATER_LIFETIME_DEFAULT);
+    return ptr;
+}
+
+void *mddl_mallocater_alloc_hint_with_obj(mddl_mallocater_t *const self_p, const size_t sz, const enum_mddl_mallocater_lifetime_t hint)
+{
+    void *const ptr = trace_body_alloc_hint(self_p, sz, hint);
+
+    trace_put(self_p, MDDL_MALLOCATER_TRACE_OP_ALLOC, NULL, ptr, sz, (uint32_t)hint);
+    return ptr;
+}
+
+void mddl_mallocater_free_with_obj(mddl_mallocater_t *const self_p, void *const ptr)
+{
+    trace_body_free(self_p, ptr);
+    trace_put(self_p, MDDL_MALLOCATER_TRACE_OP_FREE, ptr, NULL, 0, 0);
+}
+
+void *mddl_mallocater_realloc_with_obj(mddl_mallocater_t *const self_p, void *const ptr, const size_t size)
+{
+    void *const new_ptr = trace_body_realloc(self_p, ptr, size);
+
+    trace_put(self_p, MDDL_MALLOCATER_TRACE_OP_REALLOC, ptr, new_ptr, size, 0);
+    return new_ptr;
+}
+
+int mddl_mallocater_alloc_batch_with_obj(mddl_mallocater_t *const self_p, const size_t size, const size_t n, void **const ptrs)
+{
+    const int result = trace_body_alloc_batch(self_p, size, n, ptrs);
+    size_t i;
+
+    for( i=0; i < n; ++i ) {
+	trace_put(self_p, MDDL_MALLOCATER_TRACE_OP_ALLOC, NULL, (result) ? NULL : ptrs[i], size, MDDL_MALLOCATER_LIFETIME_DEFAULT);
+    }
+    return result;
+}
+
+void mddl_mallocater_free_batch_with_obj(mddl_mallocater_t *const self_p, void **const ptrs, const size_t n)
+{
+    size_t i;
+
+    trace_body_free_batch(self_p, ptrs, n);
+    for( i=0; (NULL != ptrs) && (i < n); ++i ) {
+	trace_put(self_p, MDDL_MALLOCATER_TRACE_OP_FREE, ptrs[i], NULL, 0, 0);
+    }
+}
+#endif /* end of _MDDL_MALLOCATER_TRACE */
+
+/**
+ * @fn int mddl_mallocater_trace_start_with_obj(mddl_mallocater_t *const self_p, const char *const path)
+ * @brief 割り当てトレースの記録を開始します(_MDDL_MALLOCATER_TRACEを定義してビルドした場合のみ)
+ *	以後のalloc/free/realloc(バッチ版・ヒント付きを含む)をpathのファイルに記録します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param path 記録先のファイル名(既存のファイルは上書きします)
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL pathがNULL
+ * @retval EBUSY 記録中
+ * @retval ENOSYS トレース無しでビルドされている
+ * @retval 上記以外 ファイルが作成できない(fopen()のerrno)
+ */
+int mddl_mallocater_trace_start_with_obj(mddl_mallocater_t *const self_p, const char *const path)
+{
+#if defined(_MDDL_MALLOCATER_TRACE)
+    mddl_mallocater_trace_file_header_t hdr;
+    FILE *fp;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == path ) {
+	return EINVAL;
+    } else if( NULL != self_p->trace.fp ) {
+	return EBUSY;
+    }
+
+    fp = fopen(path, "wb");
+    if( NULL == fp ) {
+	return (errno) ? errno : EIO;
+    }
+    memset(&hdr, 0x0, sizeof(hdr));
+    memcpy(hdr.magic, MDDL_MALLOCATER_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = MDDL_MALLOCATER_TRACE_VERSION;
+    hdr.sizof_record = sizeof(mddl_mallocater_trace_record_t);
+    if( 1 != fwrite(&hdr, sizeof(hdr), 1, fp) ) {
+	fclose(fp);
+	return EIO;
+    }
+
+    self_p->trace.nrec = 0;
+    self_p->trace.t0_ns = trace_now_ns();
+    self_p->trace.fp = fp;
+
+    return 0;
+#else
+    (void)self_p;
+    (void)path;
+    return ENOSYS;
+#endif
+}
+
+/**
+ * @fn int mddl_mallocater_trace_stop_with_obj(mddl_mallocater_t *const self_p)
+ * @brief 割り当てトレースの記録を終了し、ファイルを閉じます
+ *	mddl_mallocater_destroy()でも終了します。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ * @retval EINVAL 記録していない
+ * @retval EIO 書き込みに失敗した
+ * @retval ENOSYS トレース無しでビルドされている
+ */
+int mddl_mallocater_trace_stop_with_obj(mddl_mallocater_t *const self_p)
+{
+#if defined(_MDDL_MALLOCATER_TRACE)
+    FILE *fp;
+    int result;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    } else if( NULL == self_p->trace.fp ) {
+	return EINVAL;
+    }
+    fp = (FILE*)self_p->trace.fp;
+
+    result = trace_flush(self_p);
+    self_p->trace.fp = NULL;
+    if( fclose(fp) && !result ) {
+	result = EIO;
+    }
+
+    return result;
+#else
+    (void)self_p;
+    return ENOSYS;
+#endif
+}
+
 /**
  * @fn void *mddl_mallocater_alloc(const size_t size)
  * @brief CRL allocをエミュレートするためのラッパ関数
@@ -686,6 +3806,78 @@ void *mddl_mallocater_alloc(const size_t size)
     return mddl_mallocater_alloc_with_obj( o, size);
 }
 
+/**
+ * @fn void *mddl_mallocater_alloc_hint(const size_t size, const enum_mddl_mallocater_lifetime_t hint)
+ * @brief 寿命のヒントを指定してデフォルトのヒープから確保します
+ * @param size 割り当てるメモリバッファサイズ
+ * @param hint 寿命のヒント
+ * @retval NULL 割り当て失敗（errno番号参照）
+ * @retval NULL以外 割り当て成功
+ **/
+void *mddl_mallocater_alloc_hint(const size_t size, const enum_mddl_mallocater_lifetime_t hint)
+{
+    mddl_mallocater_t * const o = get_allocater_own();
+
+    return mddl_mallocater_alloc_hint_with_obj( o, size, hint);
+}
+
+/**
+ * @fn mddl_mallocater_handle_t mddl_mallocater_halloc(const size_t size)
+ * @brief グローバルヒープから移動可能な領域を確保するラッパ関数
+ * @param size 確保するサイズ
+ * @retval 0 確保できない(errno参照)
+ * @retval 0以外 ハンドル
+ **/
+mddl_mallocater_handle_t mddl_mallocater_halloc(const size_t size)
+{
+    mddl_mallocater_t * const o = get_allocater_own();
+
+    return mddl_mallocater_halloc_with_obj( o, size);
+}
+
+/**
+ * @fn void mddl_mallocater_hfree(const mddl_mallocater_handle_t h)
+ * @brief グローバルヒープの移動可能な領域を開放するラッパ関数
+ *  ハンドルが無効、またはロック中の場合はabort()を実行します
+ * @param h ハンドル(0の場合は何もしない)
+ **/
+void mddl_mallocater_hfree(const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_t * const o = get_allocater_own();
+
+    if( h && mddl_mallocater_hfree_with_obj( o, h) ) {
+	abort();
+    }
+}
+
+/**
+ * @fn void *mddl_mallocater_hlock(const mddl_mallocater_handle_t h)
+ * @brief グローバルヒープの移動可能な領域をロックするラッパ関数
+ * @param h ハンドル
+ * @retval NULL ハンドルが無効
+ * @retval NULL以外 領域のポインタ
+ **/
+void *mddl_mallocater_hlock(const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_t * const o = get_allocater_own();
+
+    return mddl_mallocater_hlock_with_obj( o, h);
+}
+
+/**
+ * @fn int mddl_mallocater_hunlock(const mddl_mallocater_handle_t h)
+ * @brief グローバルヒープの移動可能な領域のロックを外すラッパ関数
+ * @param h ハンドル
+ * @retval 0 成功
+ * @retval EINVAL ハンドルが無効かロックされていない
+ **/
+int mddl_mallocater_hunlock(const mddl_mallocater_handle_t h)
+{
+    mddl_mallocater_t * const o = get_allocater_own();
+
+    return mddl_mallocater_hunlock_with_obj( o, h);
+}
+
 /**
  * @fn void mddl_mallocater_free(void *const ptr)
  * @brief CRL freeをエミュレートするためのラッパ関数
@@ -719,22 +3911,12 @@ void *mddl_mallocater_realloc(void *const ptr, const size_t size)
 /**
  * @fn size_t mddl_mallocater_avphys_with_obj(void *const ptr)
  * @breif 管理しているメモリ領域のFREE領域を戻します。
+ *	使用中領域の統計から求めるので、領域リストは走査しません。
  * @retval 0以上 FREE領域のトータルサイズ
  **/
 size_t mddl_mallocater_avphys_with_obj(mddl_mallocater_t *const self_p)
 {
-    mddl_mallocater_t * const o = self_p;
-    mddl_malllocate_header_t const *p; 
-    size_t freearea_sz = 0;
-
-    /* 後方確認 */
-    for( p=o->base.next_p; p != &o->base; p=p->next_p ) {
-	if(AREA_IS_FREE(p)) { 
-	    freearea_sz += (int64_t)p->size;
-	}
-    }
-
-    return freearea_sz;
+    return self_p->bufsiz - self_p->stats.live_bytes;
 }
 
 /**
@@ -745,3 +3927,156 @@ size_t mddl_mallocater_phys_with_obj( mddl_mallocater_t *const self_p)
 {
     return self_p->bufsiz;
 }
+
+static void *mallocater_alc_alloc(void *const ctx, const size_t size)
+{
+    return mddl_mallocater_alloc_with_obj((mddl_mallocater_t*)ctx, size);
+}
+
+static void *mallocater_alc_realloc(void *const ctx, void *const ptr, const size_t size)
+{
+    return mddl_mallocater_realloc_with_obj((mddl_mallocater_t*)ctx, ptr, size);
+}
+
+static void mallocater_alc_free(void *const ctx, void *const ptr)
+{
+    mddl_mallocater_free_with_obj((mddl_mallocater_t*)ctx, ptr);
+}
+
+/**
+ * @fn int mddl_mallocater_get_allocator_with_obj(mddl_mallocater_t *const self_p, mddl_allocator_t *const alc_p)
+ * @brief コンテナのinit_exに指定するアロケータを取得します
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param alc_p 設定するmddl_allocator_t構造体ポインタ
+ * @retval 0 成功
+ * @retval EINVAL 引数が不正
+ **/
+int mddl_mallocater_get_allocator_with_obj(mddl_mallocater_t *const self_p, mddl_allocator_t *const alc_p)
+{
+    if( (NULL == self_p) || (NULL == alc_p) ) {
+	return EINVAL;
+    }
+
+    alc_p->alloc = mallocater_alc_alloc;
+    alc_p->realloc = mallocater_alc_realloc;
+    alc_p->free = mallocater_alc_free;
+    alc_p->ctx = self_p;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_get_stats_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_stats_t *const stats_p)
+ * @brief 割り当て統計を取得します。領域リストは走査しません。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param stats_p 統計の格納先
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ **/
+int mddl_mallocater_get_stats_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_stats_t *const stats_p)
+{
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+
+    *stats_p = self_p->stats;
+    stats_p->largest_free = free_index_largest(self_p);
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_get_frag_info_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_frag_info_t *const info_p)
+ * @brief 空き領域の分布(サイズのヒストグラムと断片化率)を取得します
+ *	領域リストを走査するので、確保済み領域数に比例した時間がかかります。
+ * @param self_p オブジェクトインスタンスポインタ
+ * @param info_p 分布の格納先
+ * @retval 0 成功
+ * @retval EPERM オブジェクトが初期化されていない
+ **/
+int mddl_mallocater_get_frag_info_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_frag_info_t *const info_p)
+{
+    const mddl_malllocate_header_t *p;
+
+    if(!self_p->init.f.initialized ) {
+	return EPERM;
+    }
+    memset(info_p, 0x0, sizeof(mddl_mallocater_frag_info_t));
+
+    for( p=HEAD_NEXT(HEAD_BASE(self_p)); p != HEAD_BASE(self_p); p=HEAD_NEXT(p) ) {
+	if(AREA_IS_FREE(p)) {
+	    info_p->free_bytes += p->size;
+	    ++(info_p->free_blocks);
+	    if( p->size > info_p->largest_free ) {
+		info_p->largest_free = p->size;
+	    }
+	    ++(info_p->histogram[own_fls_sizet(p->size)]);
+	}
+    }
+
+    if( info_p->free_bytes ) {
+	info_p->fragmentation_permil = (unsigned int)
+	    (((unsigned long long)(info_p->free_bytes - info_p->largest_free) * 1000) / info_p->free_bytes);
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mallocater_stats_to_csv(const mddl_mallocater_stats_t *const stats_p, const mddl_mallocater_frag_info_t *const info_p, char *const buf, const size_t bufsiz)
+ * @brief 統計と空き領域の分布を"項目名,値"の行形式のCSVに書き出します
+ *	ヒストグラムは"free_hist_<区間の下限>,領域数"の行になります(0件の区間は省略)。
+ * @param stats_p 割り当て統計(NULLの場合は出力しない)
+ * @param info_p 空き領域の分布(NULLの場合は出力しない)
+ * @param buf 出力先バッファ
+ * @param bufsiz bufのサイズ
+ * @retval 0以上 書き出した文字数(終端を含まない)
+ * @retval -1 失敗(errno参照 ENOSPC:bufが足りない)
+ **/
+int mddl_mallocater_stats_to_csv(const mddl_mallocater_stats_t *const stats_p, const mddl_mallocater_frag_info_t *const info_p, char *const buf, const size_t bufsiz)
+{
+    size_t len = 0;
+    size_t n;
+    int retval;
+
+#define CSV_PUT(...) \
+    do { \
+	retval = mddl_snprintf( buf + len, bufsiz - len, __VA_ARGS__); \
+	if( (retval < 0) || ((size_t)retval >= (bufsiz - len)) ) { \
+	    errno = ENOSPC; \
+	    return -1; \
+	} \
+	len += (size_t)retval; \
+    } while(0)
+
+    if((NULL == buf) || (0 == bufsiz)) {
+	errno = EINVAL;
+	return -1;
+    }
+    buf[0] = '\0';
+
+    if( NULL != stats_p ) {
+	CSV_PUT("live_bytes,%llu\n", (unsigned long long)stats_p->live_bytes);
+	CSV_PUT("live_blocks,%llu\n", (unsigned long long)stats_p->live_blocks);
+	CSV_PUT("peak_bytes,%llu\n", (unsigned long long)stats_p->peak_bytes);
+	CSV_PUT("largest_free,%llu\n", (unsigned long long)stats_p->largest_free);
+	CSV_PUT("alloc_cnt,%llu\n", (unsigned long long)stats_p->alloc_cnt);
+	CSV_PUT("free_cnt,%llu\n", (unsigned long long)stats_p->free_cnt);
+	CSV_PUT("realloc_cnt,%llu\n", (unsigned long long)stats_p->realloc_cnt);
+	CSV_PUT("failed_cnt,%llu\n", (unsigned long long)stats_p->failed_cnt);
+	CSV_PUT("slab_objs,%llu\n", (unsigned long long)stats_p->slab_objs);
+    }
+    if( NULL != info_p ) {
+	CSV_PUT("free_bytes,%llu\n", (unsigned long long)info_p->free_bytes);
+	CSV_PUT("free_blocks,%llu\n", (unsigned long long)info_p->free_blocks);
+	CSV_PUT("fragmentation_permil,%u\n", info_p->fragmentation_permil);
+	for( n=0; n<MDDL_MALLOCATER_HISTOGRAM_BINS; ++n ) {
+	    if( info_p->histogram[n] ) {
+		CSV_PUT("free_hist_%llu,%llu\n", (unsigned long long)((size_t)1 << n), (unsigned long long)info_p->histogram[n]);
+	    }
+	}
+    }
+#undef CSV_PUT
+
+    return (int)len;
+}
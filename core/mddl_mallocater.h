@@ -2,7 +2,53 @@
 #define INC_MDDL_MALLOCATER_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "mddl_allocator.h"
+
+/**
+ * @note 空き領域インデックス(TLSF: Two-Level Segregated Fit)のパラメータ
+ *	第1レベルは2の累乗で、第2レベルはそれをSL_INDEX_COUNTに等分した区間で管理します。
+ *	FL_INDEX_MAX以上のサイズの空き領域は最終リストにまとめて格納されます。
+ */
+#define MDDL_MALLOCATER_SL_INDEX_COUNT_LOG2 4
+#define MDDL_MALLOCATER_SL_INDEX_COUNT (1 << MDDL_MALLOCATER_SL_INDEX_COUNT_LOG2)
+#if UINTPTR_MAX > 0xffffffffu
+#define MDDL_MALLOCATER_ALIGN_SHIFT 3
+#define MDDL_MALLOCATER_FL_INDEX_MAX 38
+#else
+#define MDDL_MALLOCATER_ALIGN_SHIFT 2
+#define MDDL_MALLOCATER_FL_INDEX_MAX 31
+#endif
+#define MDDL_MALLOCATER_FL_INDEX_SHIFT (MDDL_MALLOCATER_SL_INDEX_COUNT_LOG2 + MDDL_MALLOCATER_ALIGN_SHIFT)
+#define MDDL_MALLOCATER_FL_INDEX_COUNT (MDDL_MALLOCATER_FL_INDEX_MAX - MDDL_MALLOCATER_FL_INDEX_SHIFT + 1)
+
+/**
+ * @note 小サイズ割り当て用スラブのパラメータ
+ *	MDDL_MALLOCATER_SLAB_MAX_SIZE以下の要求は、MDDL_MALLOCATER_SLAB_SIZE境界に整列したスラブから
+ *	領域ヘッダ無しで割り当てます(mddl_mallocater_set_slab_with_obj()で有効にした場合)。
+ */
+#define MDDL_MALLOCATER_SLAB_SIZE 4096
+#define MDDL_MALLOCATER_SLAB_MAX_SIZE 256
+#define MDDL_MALLOCATER_SLAB_CLASS_COUNT 16
+
+/**
+ * @note _MDDL_MALLOCATER_COMPACT_HEADERを定義してビルドすると、領域ヘッダを
+ *	サイズと前後の領域へのリンクを32bitで持つコンパクトな形式(64bit環境で32→16バイト、
+ *	フッタは8→4バイト)にします。リンクはヘッダ自身からの相対位置なので、
+ *	ヒープ全体(追加領域を含む)がinit_objに渡したバッファから±1GiBに収まる必要があります。
+ */
+#if defined(_MDDL_MALLOCATER_COMPACT_HEADER)
+typedef struct _mddl_malllocate_area_header {
+    uint32_t size;
+    union {
+	uint32_t magic_no;
+	uint32_t occupied;
+    } stamp;
+    int32_t next_rel;
+    int32_t prev_rel;
+} mddl_malllocate_header_t;
+#else
 typedef struct _mddl_malllocate_area_header {
     size_t size;
     union {
@@ -12,12 +58,198 @@ typedef struct _mddl_malllocate_area_header {
     struct _mddl_malllocate_area_header *next_p;
     struct _mddl_malllocate_area_header *prev_p;
 } mddl_malllocate_header_t;
+#endif
+
+/**
+ * @brief 割り当て統計です。alloc/free毎にO(1)で更新されます。
+ *	サイズは全てヘッダ・フッタを含む領域サイズです。
+ */
+typedef struct _mddl_mallocater_stats {
+    size_t live_bytes;		/* 使用中領域の総サイズ */
+    size_t live_blocks;		/* 使用中領域数 */
+    size_t peak_bytes;		/* live_bytesの最大値 */
+    size_t largest_free;	/* 最大の空き領域(取得時に算出) */
+    uint64_t alloc_cnt;
+    uint64_t free_cnt;
+    uint64_t realloc_cnt;
+    uint64_t failed_cnt;	/* 確保できなかった回数 */
+    size_t slab_objs;		/* スラブから割り当て中の小オブジェクト数(live_blocksにはスラブ単位で計上) */
+} mddl_mallocater_stats_t;
+
+#define MDDL_MALLOCATER_HISTOGRAM_BINS (sizeof(size_t) * 8)
+
+/**
+ * @brief 空き領域の分布です。領域リストを走査して求めます。
+ */
+typedef struct _mddl_mallocater_frag_info {
+    size_t free_bytes;		/* 空き領域の総サイズ */
+    size_t free_blocks;		/* 空き領域数 */
+    size_t largest_free;	/* 最大の空き領域 */
+    unsigned int fragmentation_permil; /* 断片化率 (1 - largest_free / free_bytes) x 1000 */
+    size_t histogram[MDDL_MALLOCATER_HISTOGRAM_BINS]; /* [n]は2^n以上2^(n+1)未満の空き領域数 */
+} mddl_mallocater_frag_info_t;
+
+/**
+ * @brief 空き領域が足りない時にヒープへ追加する領域を確保するコールバックです。
+ *	region_allocは*size_p以上の領域を返します。実際に確保したサイズは*size_pに書き戻してください。
+ *	region_freeはmddl_mallocater_destroy()で、region_allocで得た領域毎に呼ばれます。
+ */
+typedef struct _mddl_mallocater_grow {
+    void *(*region_alloc)(void *const ctx, size_t *const size_p);
+    void (*region_free)(void *const ctx, void *const mem, const size_t size);
+    void *ctx;
+    size_t chunk_size;		/* 1回に追加する最小サイズ */
+} mddl_mallocater_grow_t;
+
+/**
+ * @brief mddl_mallocater_init_obj_ex()で指定する属性です。
+ *	purge_thresholdを指定すると、その大きさ以上の空き領域の内側のページをmadvise()でOSに返します。
+ *	開放時に行う(purge_on_free、MADV_FREE)か、mddl_mallocater_trim_with_obj()を呼んだ時に行います(MADV_DONTNEED)。
+ */
+typedef struct _mddl_mallocater_attr {
+    size_t purge_threshold;	/* 0の場合はtrim時のみページサイズ以上の空き領域を対象にする */
+    union {
+	unsigned int flags;
+	struct {
+	    unsigned int zero_filled:1;		/* bufが0で埋まっているので初期化時の0クリアを省く */
+	    unsigned int purge_on_free:1;	/* 開放時にpurge_threshold以上になった空き領域のページを返す */
+	} f;
+    } ext;
+} mddl_mallocater_attr_t;
+
+/**
+ * @brief alloc/free/realloc毎に行うヘッダ・フッタ検査のレベルです。
+ *	OFFにした場合もmddl_mallocater_verify_with_obj()でヒープ全体を検査できます。
+ */
+typedef enum _mddl_mallocater_check_level {
+    MDDL_MALLOCATER_CHECK_OFF = 0,	/* 検査しない */
+    MDDL_MALLOCATER_CHECK_CHEAP,	/* 対象領域のマジック番号のみ */
+    MDDL_MALLOCATER_CHECK_FULL		/* 対象と前後の領域のマジック番号とフッタ(初期値) */
+} enum_mddl_mallocater_check_level_t;
+
+/**
+ * @brief 割り当てる領域の寿命のヒントです。
+ *	長寿命の領域をヒープの上端に寄せ、短寿命の領域と混ざらないようにします。
+ */
+typedef enum _mddl_mallocater_lifetime {
+    MDDL_MALLOCATER_LIFETIME_DEFAULT = 0,
+    MDDL_MALLOCATER_LIFETIME_SHORT,	/* 通信バッファ等、すぐに開放する */
+    MDDL_MALLOCATER_LIFETIME_LONG	/* コンテナの管理領域やセッション状態等、長く保持する */
+} enum_mddl_mallocater_lifetime_t;
+
+/**
+ * @note 割り当てプロファイラのパラメータ
+ *	平均interval バイトに1回の割合(ポアソン過程)で割り当てを抜き取り、呼び出し元のバックトレースを
+ *	最大MDDL_MALLOCATER_PROF_DEPTH段記録して、呼び出し元毎の使用中バイト数を推定します。
+ *	管理領域(約20KB)はmddl_mallocater_prof_start_with_obj()でヒープ自身から確保します。
+ */
+#define MDDL_MALLOCATER_PROF_DEPTH 8
+#define MDDL_MALLOCATER_PROF_SITE_COUNT 64
+#define MDDL_MALLOCATER_PROF_SAMPLE_COUNT 512
+
+/**
+ * @brief mddl_mallocater_halloc_with_obj()で確保した移動可能な領域のハンドルです。0は無効値です。
+ *	ポインタはmddl_mallocater_hlock_with_obj()で取り出し、unlockするまで移動しません。
+ */
+typedef uint32_t mddl_mallocater_handle_t;
+
+typedef struct _mddl_mallocater_prof_site {
+    void *frames[MDDL_MALLOCATER_PROF_DEPTH];	/* 呼び出し元のリターンアドレス */
+    uint32_t depth;
+    uint32_t hash;
+    size_t live_bytes;		/* 使用中バイト数の推定値 */
+    size_t live_samples;	/* 使用中の抜き取り数 */
+    uint64_t total_bytes;	/* 累計割り当てバイト数の推定値 */
+    uint64_t total_samples;
+} mddl_mallocater_prof_site_t;
+
+/**
+ * @note _MDDL_MALLOCATER_TRACEを定義してビルドすると、mddl_mallocater_trace_start_with_obj()で
+ *	指定したファイルに、ヒープオブジェクトへのalloc/free/reallocを1件40バイトのバイナリで記録します。
+ *	ファイルはmddl_mallocater_trace_file_header_tの後にmddl_mallocater_trace_record_tが続きます。
+ *	エンディアンは記録した環境のものです。evaluation/mallocater_replayで再生できます。
+ */
+#define MDDL_MALLOCATER_TRACE_MAGIC "MDTR"
+#define MDDL_MALLOCATER_TRACE_VERSION 1
+#define MDDL_MALLOCATER_TRACE_BUFCNT 128
+
+typedef enum _mddl_mallocater_trace_op {
+    MDDL_MALLOCATER_TRACE_OP_ALLOC = 1,	/* id2=確保したポインタ(失敗時0), arg=寿命のヒント */
+    MDDL_MALLOCATER_TRACE_OP_FREE,	/* id=開放したポインタ */
+    MDDL_MALLOCATER_TRACE_OP_REALLOC	/* id=元のポインタ, id2=新しいポインタ(失敗時0) */
+} enum_mddl_mallocater_trace_op_t;
+
+typedef struct _mddl_mallocater_trace_file_header {
+    char magic[4];		/* MDDL_MALLOCATER_TRACE_MAGIC */
+    uint32_t version;		/* MDDL_MALLOCATER_TRACE_VERSION */
+    uint32_t sizof_record;	/* sizeof(mddl_mallocater_trace_record_t) */
+    uint32_t reserved;
+} mddl_mallocater_trace_file_header_t;
+
+typedef struct _mddl_mallocater_trace_record {
+    uint64_t ts_ns;		/* 記録開始からの経過時間 */
+    uint64_t id;		/* ポインタ値(同時に使用中の領域の間では一意) */
+    uint64_t id2;
+    uint64_t size;		/* 要求サイズ */
+    uint32_t op;		/* enum_mddl_mallocater_trace_op_t */
+    uint32_t arg;
+} mddl_mallocater_trace_record_t;
 
 typedef struct _mddl_mallocater {
     void *buf;
     size_t bufsiz;
-    mddl_malllocate_header_t base;
+    mddl_malllocate_header_t base;	/* 番兵(_MDDL_MALLOCATER_COMPACT_HEADERではbufの先頭に置くので未使用) */
     uint8_t bufofs;
+
+    /* 空き領域インデックス */
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[MDDL_MALLOCATER_FL_INDEX_COUNT];
+    mddl_malllocate_header_t *free_heads[MDDL_MALLOCATER_FL_INDEX_COUNT][MDDL_MALLOCATER_SL_INDEX_COUNT];
+
+    mddl_mallocater_stats_t stats;
+
+    /* 追加領域 */
+    size_t initsiz;		/* init_objで指定されたバッファの管理サイズ */
+    void *regions;		/* 追加領域の記述子リスト */
+    mddl_mallocater_grow_t grow;
+
+    uint8_t check_level;	/* enum_mddl_mallocater_check_level_t */
+
+    /* 空き領域のページ返却 */
+    uint8_t purge_on_free;
+    size_t purge_threshold;
+    size_t pagesize;
+
+    /* 小サイズ割り当て用スラブ */
+    uint8_t slab_enable;
+    size_t slab_cnt;		/* 存在するスラブ数 */
+    void *slab_partial[MDDL_MALLOCATER_SLAB_CLASS_COUNT]; /* 空きのあるスラブのリスト */
+
+    /* 移動可能な領域のハンドル表 */
+    void *htab;			/* ヒープ上端に確保した表 */
+    uint32_t htab_cnt;		/* 表の要素数 */
+    uint32_t htab_free;		/* 未使用エントリのリスト(番号+1、0は終端) */
+
+    /* ファイルにマップした永続ヒープ */
+    struct {
+	void *map;		/* マップしたファイルの先頭。NULLの場合は永続ヒープではない */
+	size_t mapsiz;
+	int fd;
+    } persist;
+
+    /* 割り当てプロファイラ */
+    void *prof;			/* 管理領域。NULLの場合は抜き取らない */
+
+#if defined(_MDDL_MALLOCATER_TRACE)
+    /* 割り当てトレース */
+    struct {
+	void *fp;		/* 記録先(FILE*)。NULLの場合は記録しない */
+	uint64_t t0_ns;
+	size_t nrec;
+	mddl_mallocater_trace_record_t rec[MDDL_MALLOCATER_TRACE_BUFCNT];
+    } trace;
+#endif
+
     union {
 	uint8_t flags;
 	struct {
@@ -33,17 +265,56 @@ extern "C" {
 #endif
 
 void *mddl_mallocater_alloc(const size_t size);
+void *mddl_mallocater_alloc_hint(const size_t size, const enum_mddl_mallocater_lifetime_t hint);
 void mddl_mallocater_free(void * const ptr); 
 void *mddl_mallocater_realloc(void * const ptr, const size_t size);
+mddl_mallocater_handle_t mddl_mallocater_halloc(const size_t size);
+void mddl_mallocater_hfree(const mddl_mallocater_handle_t h);
+void *mddl_mallocater_hlock(const mddl_mallocater_handle_t h);
+int mddl_mallocater_hunlock(const mddl_mallocater_handle_t h);
 
 int mddl_mallocater_init_obj(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsize);
+int mddl_mallocater_init_obj_ex(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsize, const mddl_mallocater_attr_t *const attr_p);
+int mddl_mallocater_destroy(mddl_mallocater_t *const self_p);
+int mddl_mallocater_persist_open_with_obj(mddl_mallocater_t *const self_p, const char *const path, const size_t size, int *const attached_p);
+int mddl_mallocater_persist_close_with_obj(mddl_mallocater_t *const self_p);
+int mddl_mallocater_persist_sync_with_obj(mddl_mallocater_t *const self_p);
+int mddl_mallocater_persist_set_root_with_obj(mddl_mallocater_t *const self_p, void *const root);
+void *mddl_mallocater_persist_get_root_with_obj(mddl_mallocater_t *const self_p);
+int mddl_mallocater_add_region_with_obj(mddl_mallocater_t *const self_p, void *const buf, const size_t bufsiz);
+int mddl_mallocater_set_grow_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_grow_t *const grow_p);
+int mddl_mallocater_set_mmap_grow_with_obj(mddl_mallocater_t *const self_p, const size_t chunk_size);
+int mddl_mallocater_set_check_level_with_obj(mddl_mallocater_t *const self_p, const enum_mddl_mallocater_check_level_t level);
+int mddl_mallocater_set_slab_with_obj(mddl_mallocater_t *const self_p, const int enable);
+int mddl_mallocater_trim_with_obj(mddl_mallocater_t *const self_p, size_t *const purged_p);
+int mddl_mallocater_verify_with_obj(mddl_mallocater_t *const self_p, void **const badptr_p);
 void *mddl_mallocater_alloc_with_obj(mddl_mallocater_t *const self_p,const size_t size);
+void *mddl_mallocater_alloc_hint_with_obj(mddl_mallocater_t *const self_p, const size_t size, const enum_mddl_mallocater_lifetime_t hint);
 void mddl_mallocater_free_with_obj(mddl_mallocater_t *const self_p, void * const ptr); 
 void *mddl_mallocater_realloc_with_obj(mddl_mallocater_t *const self_p, void *const ptr, const size_t size);
+int mddl_mallocater_alloc_batch_with_obj(mddl_mallocater_t *const self_p, const size_t size, const size_t n, void **const ptrs);
+void mddl_mallocater_free_batch_with_obj(mddl_mallocater_t *const self_p, void **const ptrs, const size_t n);
+mddl_mallocater_handle_t mddl_mallocater_halloc_with_obj(mddl_mallocater_t *const self_p, const size_t size);
+int mddl_mallocater_hfree_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h);
+void *mddl_mallocater_hlock_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h);
+int mddl_mallocater_hunlock_with_obj(mddl_mallocater_t *const self_p, const mddl_mallocater_handle_t h);
+int mddl_mallocater_compact_with_obj(mddl_mallocater_t *const self_p, const size_t budget, size_t *const moved_p);
+int mddl_mallocater_prof_start_with_obj(mddl_mallocater_t *const self_p, const size_t interval, const int dump_on_failure);
+int mddl_mallocater_prof_stop_with_obj(mddl_mallocater_t *const self_p);
+int mddl_mallocater_prof_get_sites_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_prof_site_t *const sites, const size_t max_sites, size_t *const nsites_p);
+int mddl_mallocater_prof_dump_with_obj(mddl_mallocater_t *const self_p);
+int mddl_mallocater_trace_start_with_obj(mddl_mallocater_t *const self_p, const char *const path);
+int mddl_mallocater_trace_stop_with_obj(mddl_mallocater_t *const self_p);
 
 size_t mddl_mallocater_phys_with_obj( mddl_mallocater_t *const self_p);
 size_t mddl_mallocater_avphys_with_obj(mddl_mallocater_t *const self_p);
 
+int mddl_mallocater_get_stats_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_stats_t *const stats_p);
+int mddl_mallocater_get_frag_info_with_obj(mddl_mallocater_t *const self_p, mddl_mallocater_frag_info_t *const info_p);
+int mddl_mallocater_get_allocator_with_obj(mddl_mallocater_t *const self_p, mddl_allocator_t *const alc_p);
+
+int mddl_mallocater_stats_to_csv(const mddl_mallocater_stats_t *const stats_p, const mddl_mallocater_frag_info_t *const info_p, char *const buf, const size_t bufsiz);
+
 void _mddl_mallocater_dump_region_list(mddl_mallocater_t const *const self_p);
 
 #if defined (__cplusplus )
@@ -0,0 +1,541 @@
+/**
+ *	Copyright 2026 TSN-SHINGENN All Rights Reserved.
+ *
+ *	Basic Author: Seiichi Takeda  '2026-October-16 Active
+ *		Last Alteration $Author: takeda $
+ *
+ *	Dual License :
+ *	non-commercial ... MIT Licence
+ *	    commercial ... Requires permission from the author
+ */
+
+/**
+ * @file mddl_mallocater_mt.c
+ * @brief mddl_mallocaterをスレッドセーフに利用するためのラッパーです。
+ *	共有ヒープ(mddl_mallocater_t)はmutexで保護し、その前段にスレッド毎の
+ *	サイズクラス別キャッシュ(マガジン)を置きます。小さな領域の確保・開放は
+ *	通常マガジン内で完結するので、ロックを取りません。
+ *	他のスレッドが確保した領域の開放は、確保したスレッドのリモート開放リストへ
+ *	ロックフリーで積まれ、所有スレッドがマガジンが空になった時にまとめて回収します。
+ *
+ *	※ 割り当てた領域にはサイズクラスと所有キャッシュを示す1ワードの前置きが付きます。
+ *	   mddl_mallocater_mt_alloc()で確保した領域は必ずmddl_mallocater_mt_free()で開放してください。
+ */
+
+/* POSIX */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+/* this */
+#include "mddl_mallocater.h"
+#include "mddl_mallocater_mt.h"
+
+/* dbms */
+#ifdef DEBUG
+static int debuglevel = 4;
+#else
+static const int debuglevel = 0;
+#endif
+#include "dbms.h"
+
+#define EOL_CRLF "\n\r"
+
+mddl_mallocater_mt_t _mddl_mallocater_mt_heap_obj;
+
+#define MT_NUM_CLASSES 7
+#define MT_MAGAZINE_SIZE 32
+#define MT_REFILL_CNT (MT_MAGAZINE_SIZE / 2)
+#define MT_CLASS_MAXSIZE 256
+
+/* 前置きワード : 所有キャッシュのポインタ | (サイズクラス番号 + 1)。0は共有ヒープから直接確保した領域 */
+#define MT_PREFIX_SIZE sizeof(uintptr_t)
+#define MT_TAG_CLASS_MASK ((uintptr_t)0x7)
+#define MT_TAG_DIRECT ((uintptr_t)0)
+#define GET_BLK2PTR(b) ((void*)((uintptr_t)(b) + MT_PREFIX_SIZE))
+#define GET_PTR2BLK(p) ((uintptr_t*)((uintptr_t)(p) - MT_PREFIX_SIZE))
+#define REMOTE_NEXT(b) (*(void**)GET_BLK2PTR(b))
+
+static const size_t class_size_tbl[MT_NUM_CLASSES] = { 16, 32, 64, 96, 128, 192, 256 };
+
+/* (size + 15) / 16 からサイズクラス番号を引くテーブル */
+static const uint8_t class_idx_tbl[(MT_CLASS_MAXSIZE / 16) + 1] = {
+    0, 0, 1, 2, 2, 3, 3, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6
+};
+
+typedef struct _mt_magazine {
+    unsigned int cnt;
+    void *slots[MT_MAGAZINE_SIZE];
+} mt_magazine_t;
+
+typedef struct _mt_tcache {
+    struct _mt_tcache *next;	/* 登録済みキャッシュのリスト */
+    void *raw_p;		/* タグ用にアライメントを揃える前の確保ポインタ */
+    struct _mddl_mallocater_mt_ext *owner_ext;
+    void *remote_head;		/* 他スレッドから開放された領域(lock-free stack) */
+    volatile int retired;	/* スレッドが終了し、次のスレッドに引き継げる */
+    mt_magazine_t mag[MT_NUM_CLASSES];
+} mt_tcache_t;
+
+typedef struct _mddl_mallocater_mt_ext {
+    mddl_mallocater_t *heap_p;
+    pthread_mutex_t lock;
+    pthread_key_t key;
+    mt_tcache_t *tcaches;
+
+    union {
+	unsigned int flags;
+	struct {
+	    unsigned int lock:1;
+	    unsigned int key:1;
+	} f;
+    } init;
+} mddl_mallocater_mt_ext_t;
+
+#define get_mt_ext(s) (mddl_mallocater_mt_ext_t*)((s)->ext)
+
+static void tcache_flush_magazine_locked(mddl_mallocater_mt_ext_t *const, mt_magazine_t *const, const unsigned int);
+static void tcache_release_remote_locked(mddl_mallocater_mt_ext_t *const, mt_tcache_t *const);
+
+/**
+ * @fn static __inline int size2class(const size_t size)
+ * @brief 要求サイズからサイズクラス番号を求めます
+ * @param size 要求サイズ
+ * @retval -1 キャッシュ対象外(共有ヒープから直接確保する)
+ * @retval 0以上 サイズクラス番号
+ */
+static __inline int size2class(const size_t size)
+{
+    if( size > MT_CLASS_MAXSIZE ) {
+	return -1;
+    }
+    return class_idx_tbl[(size + 15) >> 4];
+}
+
+/**
+ * @fn static void tcache_thread_exit(void *const arg)
+ * @brief スレッド終了時にキャッシュの内容を共有ヒープへ戻し、キャッシュを引き継ぎ可能にします
+ *	キャッシュ自体は他スレッドからのリモート開放を受け付けるために残します。
+ * @param arg mt_tcache_t構造体ポインタ
+ */
+static void tcache_thread_exit(void *const arg)
+{
+    mt_tcache_t *const tc = (mt_tcache_t*)arg;
+    mddl_mallocater_mt_ext_t *const e = tc->owner_ext;
+    int n;
+
+    pthread_mutex_lock(&e->lock);
+    for( n=0; n<MT_NUM_CLASSES; ++n) {
+	tcache_flush_magazine_locked(e, &tc->mag[n], tc->mag[n].cnt);
+    }
+    tcache_release_remote_locked(e, tc);
+    tc->retired = 1;
+    pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * @fn static mt_tcache_t *tcache_get(mddl_mallocater_mt_ext_t *const e)
+ * @brief 呼び出しスレッドのキャッシュを得ます。無ければ作成(または引き継ぎ)します
+ * @param e mddl_mallocater_mt_ext_t構造体ポインタ
+ * @retval NULL リソース不足
+ * @retval NULL以外 キャッシュのポインタ
+ */
+static mt_tcache_t *tcache_get(mddl_mallocater_mt_ext_t *const e)
+{
+    mt_tcache_t *tc = (mt_tcache_t*)pthread_getspecific(e->key);
+
+    if( NULL != tc ) {
+	return tc;
+    }
+
+    pthread_mutex_lock(&e->lock);
+    /* 終了したスレッドのキャッシュがあれば引き継ぐ */
+    for( tc=e->tcaches; NULL != tc; tc=tc->next) {
+	if( tc->retired ) {
+	    tc->retired = 0;
+	    break;
+	}
+    }
+    if( NULL == tc ) {
+	/* 前置きワードの下位ビットにクラス番号を入れるので、8バイト境界に揃える */
+	void *const raw_p = mddl_mallocater_alloc_with_obj(e->heap_p, sizeof(mt_tcache_t) + MT_TAG_CLASS_MASK);
+	if( NULL != raw_p ) {
+	    tc = (mt_tcache_t*)(((uintptr_t)raw_p + MT_TAG_CLASS_MASK) & ~MT_TAG_CLASS_MASK);
+	    memset(tc, 0x0, sizeof(mt_tcache_t));
+	    tc->raw_p = raw_p;
+	    tc->owner_ext = e;
+	    tc->next = e->tcaches;
+	    e->tcaches = tc;
+	}
+    }
+    pthread_mutex_unlock(&e->lock);
+
+    if( NULL != tc ) {
+	pthread_setspecific(e->key, tc);
+    }
+
+    return tc;
+}
+
+/**
+ * @fn static void tcache_flush_magazine_locked(mddl_mallocater_mt_ext_t *const e, mt_magazine_t *const mag, const unsigned int cnt)
+ * @brief マガジンの末尾からcnt個の領域を共有ヒープへ戻します。ロックを取得して呼び出してください
+ * @param e mddl_mallocater_mt_ext_t構造体ポインタ
+ * @param mag 対象のマガジン
+ * @param cnt 戻す個数
+ */
+static void tcache_flush_magazine_locked(mddl_mallocater_mt_ext_t *const e, mt_magazine_t *const mag, const unsigned int cnt)
+{
+    unsigned int n;
+
+    for( n=0; (n < cnt) && mag->cnt; ++n) {
+	mddl_mallocater_free_with_obj(e->heap_p, mag->slots[--(mag->cnt)]);
+    }
+}
+
+/**
+ * @fn static void tcache_release_remote_locked(mddl_mallocater_mt_ext_t *const e, mt_tcache_t *const tc)
+ * @brief リモート開放リストの領域を全て共有ヒープへ戻します。ロックを取得して呼び出してください
+ * @param e mddl_mallocater_mt_ext_t構造体ポインタ
+ * @param tc 対象のキャッシュ
+ */
+static void tcache_release_remote_locked(mddl_mallocater_mt_ext_t *const e, mt_tcache_t *const tc)
+{
+    void *blk = __atomic_exchange_n(&tc->remote_head, NULL, __ATOMIC_ACQUIRE);
+
+    while( NULL != blk ) {
+	void *const next = REMOTE_NEXT(blk);
+	mddl_mallocater_free_with_obj(e->heap_p, blk);
+	blk = next;
+    }
+}
+
+/**
+ * @fn static void tcache_collect_remote(mddl_mallocater_mt_ext_t *const e, mt_tcache_t *const tc)
+ * @brief リモート開放リストを一括で取り出し、各マガジンに戻します
+ *	リストの取り出しは所有スレッドのみがexchangeで行うので、ABA問題は起きません。
+ *	マガジンに収まらなかった領域は共有ヒープへ戻します。
+ * @param e mddl_mallocater_mt_ext_t構造体ポインタ
+ * @param tc 呼び出しスレッドのキャッシュ
+ */
+static void tcache_collect_remote(mddl_mallocater_mt_ext_t *const e, mt_tcache_t *const tc)
+{
+    void *blk, *overflow = NULL;
+
+    if( NULL == __atomic_load_n(&tc->remote_head, __ATOMIC_RELAXED) ) {
+	return;
+    }
+
+    blk = __atomic_exchange_n(&tc->remote_head, NULL, __ATOMIC_ACQUIRE);
+    while( NULL != blk ) {
+	void *const next = REMOTE_NEXT(blk);
+	mt_magazine_t *const mag = &tc->mag[(*(uintptr_t*)blk & MT_TAG_CLASS_MASK) - 1];
+
+	if( mag->cnt < MT_MAGAZINE_SIZE ) {
+	    mag->slots[(mag->cnt)++] = blk;
+	} else {
+	    REMOTE_NEXT(blk) = overflow;
+	    overflow = blk;
+	}
+	blk = next;
+    }
+
+    if( NULL != overflow ) {
+	pthread_mutex_lock(&e->lock);
+	while( NULL != overflow ) {
+	    void *const next = REMOTE_NEXT(overflow);
+	    mddl_mallocater_free_with_obj(e->heap_p, overflow);
+	    overflow = next;
+	}
+	pthread_mutex_unlock(&e->lock);
+    }
+}
+
+/**
+ * @fn int mddl_mallocater_mt_init(mddl_mallocater_mt_t *const self_p, mddl_mallocater_t *const heap_p)
+ * @brief 初期化済みのヒープオブジェクトをスレッドセーフに利用するためのインスタンスを初期化します
+ *	初期化以降、heap_pを直接操作しないでください。
+ *	管理情報とスレッド毎のキャッシュはheap_pから確保されます。
+ * @param self_p mddl_mallocater_mt_t構造体インスタンスポインタ
+ * @param heap_p mddl_mallocater_init_obj()で初期化済みのヒープオブジェクト
+ * @retval 0 成功
+ * @retval EINVAL ヒープが初期化されていない
+ * @retval EAGAIN リソースの獲得に失敗
+ */
+int mddl_mallocater_mt_init(mddl_mallocater_mt_t *const self_p, mddl_mallocater_t *const heap_p)
+{
+    mddl_mallocater_mt_ext_t *e = NULL;
+    int result, status;
+
+    memset(self_p, 0x0, sizeof(mddl_mallocater_mt_t));
+
+    if( (NULL == heap_p) || !heap_p->init.f.initialized ) {
+	return EINVAL;
+    }
+
+    e = (mddl_mallocater_mt_ext_t*)mddl_mallocater_alloc_with_obj(heap_p, sizeof(mddl_mallocater_mt_ext_t));
+    if( NULL == e ) {
+	DBMS1("%s : mddl_mallocater_alloc_with_obj(ext) fail" EOL_CRLF, __func__);
+	return EAGAIN;
+    }
+    memset(e, 0x0, sizeof(mddl_mallocater_mt_ext_t));
+    e->heap_p = self_p->heap_p = heap_p;
+    self_p->ext = e;
+
+    result = pthread_mutex_init(&e->lock, NULL);
+    if(result) {
+	DBMS1("%s : pthread_mutex_init fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
+	status = EAGAIN;
+	goto out;
+    }
+    e->init.f.lock = 1;
+
+    result = pthread_key_create(&e->key, tcache_thread_exit);
+    if(result) {
+	DBMS1("%s : pthread_key_create fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
+	status = EAGAIN;
+	goto out;
+    }
+    e->init.f.key = 1;
+
+    self_p->init.f.initialized = 1;
+    status = 0;
+
+out:
+    if(status) {
+	mddl_mallocater_mt_destroy(self_p);
+    }
+    return status;
+}
+
+/**
+ * @fn int mddl_mallocater_mt_destroy(mddl_mallocater_mt_t *const self_p)
+ * @brief インスタンスを破棄し、キャッシュしている領域を全てヒープへ戻します
+ *	他のスレッドが利用していない状態で呼び出してください。
+ *	確保中の領域は破棄前に全て開放してください。
+ * @param self_p mddl_mallocater_mt_t構造体インスタンスポインタ
+ * @retval 0 成功
+ */
+int mddl_mallocater_mt_destroy(mddl_mallocater_mt_t *const self_p)
+{
+    mddl_mallocater_mt_ext_t *const e = get_mt_ext(self_p);
+    mt_tcache_t *tc;
+    int n;
+
+    if( NULL == e ) {
+	return 0;
+    }
+    self_p->init.f.initialized = 0;
+
+    tc = e->tcaches;
+    while( NULL != tc ) {
+	mt_tcache_t *const next = tc->next;
+	for( n=0; n<MT_NUM_CLASSES; ++n) {
+	    tcache_flush_magazine_locked(e, &tc->mag[n], tc->mag[n].cnt);
+	}
+	tcache_release_remote_locked(e, tc);
+	mddl_mallocater_free_with_obj(e->heap_p, tc->raw_p);
+	tc = next;
+    }
+    e->tcaches = NULL;
+
+    if( e->init.f.key ) {
+	pthread_key_delete(e->key);
+	e->init.f.key = 0;
+    }
+    if( e->init.f.lock ) {
+	pthread_mutex_destroy(&e->lock);
+	e->init.f.lock = 0;
+    }
+
+    mddl_mallocater_free_with_obj(e->heap_p, e);
+    self_p->ext = NULL;
+
+    return 0;
+}
+
+/**
+ * @fn void *mddl_mallocater_mt_alloc(mddl_mallocater_mt_t *const self_p, const size_t size)
+ * @brief スレッドセーフにメモリを確保します
+ *	256バイト以下はスレッド毎のマガジンから払い出し、空の場合は共有ヒープからまとめて補充します。
+ * @param self_p mddl_mallocater_mt_t構造体インスタンスポインタ
+ * @param size 確保サイズ
+ * @retval NULL 確保できない(errno参照)
+ * @retval NULL以外 確保したメモリのポインタ
+ */
+void *mddl_mallocater_mt_alloc(mddl_mallocater_mt_t *const self_p, const size_t size)
+{
+    mddl_mallocater_mt_ext_t *const e = get_mt_ext(self_p);
+    const int cls = size2class(size);
+    mt_tcache_t *tc;
+    mt_magazine_t *mag;
+    uintptr_t *blk;
+
+    if(!self_p->init.f.initialized) {
+	errno = EPERM;
+	return NULL;
+    } else if( size > (SIZE_MAX - MT_PREFIX_SIZE) ) {
+	/* 前置きワードを足すと桁あふれする */
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    tc = (cls < 0) ? NULL : tcache_get(e);
+    if( NULL == tc ) {
+	/* 大きな領域は共有ヒープから直接確保する */
+	pthread_mutex_lock(&e->lock);
+	blk = (uintptr_t*)mddl_mallocater_alloc_with_obj(e->heap_p, size + MT_PREFIX_SIZE);
+	pthread_mutex_unlock(&e->lock);
+	if( NULL == blk ) {
+	    return NULL;
+	}
+	*blk = MT_TAG_DIRECT;
+	return GET_BLK2PTR(blk);
+    }
+
+    mag = &tc->mag[cls];
+    if( 0 == mag->cnt ) {
+	tcache_collect_remote(e, tc);
+    }
+    if( 0 == mag->cnt ) {
+	/* 共有ヒープからまとめて補充する */
+	const uintptr_t tag = (uintptr_t)tc | (uintptr_t)(cls + 1);
+	unsigned int n;
+
+	pthread_mutex_lock(&e->lock);
+	for( n=0; n<MT_REFILL_CNT; ++n) {
+	    blk = (uintptr_t*)mddl_mallocater_alloc_with_obj(e->heap_p, class_size_tbl[cls] + MT_PREFIX_SIZE);
+	    if( NULL == blk ) {
+		break;
+	    }
+	    *blk = tag;
+	    mag->slots[(mag->cnt)++] = blk;
+	}
+	pthread_mutex_unlock(&e->lock);
+
+	if( 0 == mag->cnt ) {
+	    errno = ENOMEM;
+	    return NULL;
+	}
+    }
+
+    blk = (uintptr_t*)mag->slots[--(mag->cnt)];
+
+    return GET_BLK2PTR(blk);
+}
+
+/**
+ * @fn void mddl_mallocater_mt_free(mddl_mallocater_mt_t *const self_p, void *const ptr)
+ * @brief mddl_mallocater_mt_alloc()で確保した領域を開放します
+ *	確保したスレッドであれば自分のマガジンへ、それ以外のスレッドであれば
+ *	確保したスレッドのリモート開放リストへロックを取らずに戻します。
+ * @param self_p mddl_mallocater_mt_t構造体インスタンスポインタ
+ * @param ptr 開放するポインタ(NULLは何もしません)
+ */
+void mddl_mallocater_mt_free(mddl_mallocater_mt_t *const self_p, void *const ptr)
+{
+    mddl_mallocater_mt_ext_t *const e = get_mt_ext(self_p);
+    uintptr_t *blk;
+    uintptr_t tag;
+    mt_tcache_t *owner, *tc;
+
+    if(!self_p->init.f.initialized) {
+	errno = EPERM;
+	abort();
+    }
+    if( NULL == ptr ) {
+	return;
+    }
+
+    blk = GET_PTR2BLK(ptr);
+    tag = *blk;
+
+    if( MT_TAG_DIRECT == tag ) {
+	pthread_mutex_lock(&e->lock);
+	mddl_mallocater_free_with_obj(e->heap_p, blk);
+	pthread_mutex_unlock(&e->lock);
+	return;
+    }
+
+    owner = (mt_tcache_t*)(tag & ~MT_TAG_CLASS_MASK);
+    tc = (mt_tcache_t*)pthread_getspecific(e->key);
+
+    if( owner == tc ) {
+	mt_magazine_t *const mag = &tc->mag[(tag & MT_TAG_CLASS_MASK) - 1];
+	if( mag->cnt == MT_MAGAZINE_SIZE ) {
+	    /* マガジンが一杯なら半分を共有ヒープへ戻す */
+	    pthread_mutex_lock(&e->lock);
+	    tcache_flush_magazine_locked(e, mag, MT_MAGAZINE_SIZE / 2);
+	    pthread_mutex_unlock(&e->lock);
+	}
+	mag->slots[(mag->cnt)++] = blk;
+    } else {
+	/* 所有スレッドのリモート開放リストへ積む */
+	void *head = __atomic_load_n(&owner->remote_head, __ATOMIC_RELAXED);
+	do {
+	    REMOTE_NEXT(blk) = head;
+	} while( !__atomic_compare_exchange_n(&owner->remote_head, &head, (void*)blk,
+			1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    return;
+}
+
+/**
+ * @fn void *mddl_mallocater_mt_realloc(mddl_mallocater_mt_t *const self_p, void *const ptr, const size_t size)
+ * @brief スレッドセーフにメモリを再割り当てします
+ *	キャッシュ対象の領域はサイズクラスに収まる限りそのまま返します。
+ *	共有ヒープから直接確保した領域は、共有ヒープ上で再割り当てします。
+ * @param self_p mddl_mallocater_mt_t構造体インスタンスポインタ
+ * @param ptr 変更前のバッファポインタ(NULLの場合はmddl_mallocater_mt_alloc()と同等)
+ * @param size 変更後のサイズ
+ * @retval NULL 失敗(ptrの領域はそのまま残ります)
+ * @retval NULL以外 成功
+ */
+void *mddl_mallocater_mt_realloc(mddl_mallocater_mt_t *const self_p, void *const ptr, const size_t size)
+{
+    mddl_mallocater_mt_ext_t *const e = get_mt_ext(self_p);
+    uintptr_t *blk;
+    uintptr_t tag;
+    size_t oldsz;
+    void *new_ptr;
+
+    if( NULL == ptr ) {
+	return mddl_mallocater_mt_alloc(self_p, size);
+    }
+    if(!self_p->init.f.initialized) {
+	errno = EPERM;
+	return NULL;
+    } else if( size > (SIZE_MAX - MT_PREFIX_SIZE) ) {
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    blk = GET_PTR2BLK(ptr);
+    tag = *blk;
+
+    if( MT_TAG_DIRECT == tag ) {
+	/* 直接確保した領域は実サイズを知っている共有ヒープに任せる(サイズクラスに収まる場合も含む) */
+	pthread_mutex_lock(&e->lock);
+	blk = (uintptr_t*)mddl_mallocater_realloc_with_obj(e->heap_p, blk, size + MT_PREFIX_SIZE);
+	pthread_mutex_unlock(&e->lock);
+	return (NULL == blk) ? NULL : GET_BLK2PTR(blk);
+    }
+
+    oldsz = class_size_tbl[(tag & MT_TAG_CLASS_MASK) - 1];
+    if( size <= oldsz ) {
+	return ptr;
+    }
+
+    new_ptr = mddl_mallocater_mt_alloc(self_p, size);
+    if( NULL == new_ptr ) {
+	return NULL;
+    }
+    memcpy(new_ptr, ptr, oldsz);
+    mddl_mallocater_mt_free(self_p, ptr);
+
+    return new_ptr;
+}
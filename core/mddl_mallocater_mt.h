@@ -0,0 +1,39 @@
+#ifndef INC_MDDL_MALLOCATER_MT_H
+#define INC_MDDL_MALLOCATER_MT_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mddl_mallocater.h"
+
+typedef struct _mddl_mallocater_mt {
+    mddl_mallocater_t *heap_p;
+    void *ext;
+    union {
+	uint8_t flags;
+	struct {
+	    uint8_t initialized:1;
+	} f;
+    } init;
+} mddl_mallocater_mt_t;
+
+extern mddl_mallocater_mt_t _mddl_mallocater_mt_heap_obj;
+
+#if defined (__cplusplus )
+extern "C" {
+#endif
+
+int mddl_mallocater_mt_init(mddl_mallocater_mt_t *const self_p, mddl_mallocater_t *const heap_p);
+int mddl_mallocater_mt_destroy(mddl_mallocater_mt_t *const self_p);
+
+void *mddl_mallocater_mt_alloc(mddl_mallocater_mt_t *const self_p, const size_t size);
+void mddl_mallocater_mt_free(mddl_mallocater_mt_t *const self_p, void *const ptr);
+void *mddl_mallocater_mt_realloc(mddl_mallocater_mt_t *const self_p, void *const ptr, const size_t size);
+
+#if defined (__cplusplus )
+}
+#endif
+
+#endif /* end of INC_MDDL_MALLOCATER_MT_H */
@@ -0,0 +1,139 @@
+#ifndef INC_MDDL_MEMORY_RESOURCE_H
+#define INC_MDDL_MEMORY_RESOURCE_H
+
+#pragma once
+
+/**
+ * @file mddl_memory_resource.h
+ * @brief C++の標準コンテナからlibmddlのヒープを使うためのアダプタです(ヘッダのみ)
+ *	mddl::mallocater_resource : mddl_mallocater_tを包むstd::pmr::memory_resource(C++17以降)
+ *	mddl::allocator<T> : mddl_malloc_align()/mddl_mfree()を使う標準アロケータ(C++11以降)
+ *	どちらも割り当てに失敗した場合はstd::bad_allocを送出します。
+ *	mddl_mallocater_tはスレッドセーフではないので、複数スレッドから使う場合は呼び出し側で排他してください。
+ */
+
+#if !defined(__cplusplus)
+#error "mddl_memory_resource.h is a C++ header"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <limits>
+
+#include "mddl_malloc.h"
+#include "mddl_mallocater.h"
+
+#if (__cplusplus >= 201703L) && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define MDDL_HAS_MEMORY_RESOURCE
+#endif
+#endif
+
+namespace mddl {
+
+#if defined(MDDL_HAS_MEMORY_RESOURCE)
+/**
+ * @class mallocater_resource
+ * @brief 初期化済みのmddl_mallocater_tから割り当てるstd::pmr::memory_resourceです
+ *	ヒープの寿命はこのオブジェクトと、このオブジェクトを使うコンテナより長くしてください。
+ *	ヒープの整列(ポインタサイズ)を超えるalignmentは、余分に確保して先頭をずらし、
+ *	返すアドレスの直前に本来のポインタを保存します。
+ */
+class mallocater_resource : public std::pmr::memory_resource {
+public:
+    explicit mallocater_resource(mddl_mallocater_t *const heap_p) noexcept : heap_p_(heap_p) {}
+
+    mddl_mallocater_t *heap() const noexcept { return heap_p_; }
+
+private:
+    static constexpr std::size_t natural_align = alignof(void*);
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+	if( alignment <= natural_align ) {
+	    void *const p = mddl_mallocater_alloc_with_obj(heap_p_, (bytes) ? bytes : 1);
+	    if( nullptr == p ) {
+		throw std::bad_alloc();
+	    }
+	    return p;
+	}
+	if( bytes > (std::numeric_limits<std::size_t>::max() - alignment - sizeof(void*)) ) {
+	    throw std::bad_alloc();
+	}
+	void *const raw = mddl_mallocater_alloc_with_obj(heap_p_, bytes + alignment + sizeof(void*));
+	if( nullptr == raw ) {
+	    throw std::bad_alloc();
+	}
+	const std::uintptr_t top = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+	void **const aligned = reinterpret_cast<void**>((top + (alignment - 1)) & ~static_cast<std::uintptr_t>(alignment - 1));
+	aligned[-1] = raw;
+	return aligned;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+	(void)bytes;
+	if( alignment <= natural_align ) {
+	    mddl_mallocater_free_with_obj(heap_p_, p);
+	} else {
+	    mddl_mallocater_free_with_obj(heap_p_, static_cast<void**>(p)[-1]);
+	}
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+	const mallocater_resource *const o = dynamic_cast<const mallocater_resource*>(&other);
+	return (nullptr != o) && (o->heap_p_ == heap_p_);
+    }
+
+    mddl_mallocater_t *heap_p_;
+};
+#endif /* end of MDDL_HAS_MEMORY_RESOURCE */
+
+/**
+ * @class allocator
+ * @brief mddl_malloc_align()でalignof(T)に整列して割り当てる標準アロケータです
+ *	mddl_malloc()の割り当て先(mddl_mallocaterのヒープなど)をstd::vector等から使えます。
+ *	状態を持たないので、全てのインスタンスは等価です。
+ */
+template <class T>
+class allocator {
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    allocator() noexcept {}
+    template <class U> allocator(const allocator<U>&) noexcept {}
+
+    T *allocate(const std::size_t n)
+    {
+	void *p = nullptr;
+
+	if( n > (std::numeric_limits<std::size_t>::max() / sizeof(T)) ) {
+	    throw std::bad_alloc();
+	}
+	if( mddl_malloc_align(&p, alignof(T), (n) ? n * sizeof(T) : 1) ) {
+	    throw std::bad_alloc();
+	}
+	return static_cast<T*>(p);
+    }
+
+    void deallocate(T *const p, const std::size_t n) noexcept
+    {
+	(void)n;
+	mddl_mfree(p);
+    }
+};
+
+template <class T, class U>
+inline bool operator==(const allocator<T>&, const allocator<U>&) noexcept { return true; }
+
+template <class T, class U>
+inline bool operator!=(const allocator<T>&, const allocator<U>&) noexcept { return false; }
+
+} /* end of namespace mddl */
+
+#endif /* end of INC_MDDL_MEMORY_RESOURCE_H */
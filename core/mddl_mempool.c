@@ -0,0 +1,462 @@
+/**
+ *	Copyright 2026 TSN-SHINGENN All Rights Reserved.
+ *
+ *	Basic Author: Seiichi Takeda  '2026-October-16 Active
+ *		Last Alteration $Author: takeda $
+ *
+ *	Dual License :
+ *	non-commercial ... MIT Licence
+ *	    commercial ... Requires permission from the author
+ */
+
+/**
+ * @file mddl_mempool.c
+ * @brief 固定サイズのスロットを払い出すメモリプールです。
+ *	コンテナのノードのように同じサイズの領域を繰り返し確保・開放する用途向けです。
+ *	スロットはスラブ単位でmddl_mallocaterのヒープ(またはmddl_malloc)から、
+ *	もしくは利用者が指定したバッファから切り出します。
+ *	確保・開放は空きスロットのリストの先頭を操作するだけなのでO(1)です。
+ *	スレッドセーフではありません。上位層で処理を行ってください。
+ */
+
+/* POSIX */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* this */
+#include "mddl_mallocater.h"
+#include "mddl_mempool.h"
+
+/* dbms */
+#ifdef DEBUG
+static int debuglevel = 4;
+#else
+static const int debuglevel = 0;
+#endif
+#include "dbms.h"
+
+#define EOL_CRLF "\n\r"
+
+/* 弱いアロケータの定義 */
+void __attribute__((weak)) *mddl_malloc(const size_t size)
+{
+    return malloc(size);
+}
+
+void __attribute__((weak)) mddl_free( void *const ptr )
+{
+    free(ptr);
+}
+
+#define MEMPOOL_ALIGN sizeof(void*)
+#define MEMPOOL_DEFAULT_SLOTS_PER_SLAB 64
+#define ALIGN_CEIL(z) (((z) + (MEMPOOL_ALIGN - 1)) & ~(MEMPOOL_ALIGN - 1))
+
+typedef struct _mempool_slot {
+    struct _mempool_slot *next;
+} mempool_slot_t;
+
+typedef struct _mempool_slab {
+    struct _mempool_slab *next;
+    size_t nslots;
+    size_t bump;		/* まだ一度も払い出していない先頭のスロット番号 */
+} mempool_slab_t;
+
+#define SIZEOF_SLABHEADER ALIGN_CEIL(sizeof(mempool_slab_t))
+#define GET_SLAB_SLOT(e, s, n) ((mempool_slot_t*)((uintptr_t)(s) + SIZEOF_SLABHEADER + ((n) * (e)->slot_size)))
+
+typedef struct _mddl_mempool_ext {
+    size_t slot_size;		/* アライメント調整後のスロットサイズ */
+    size_t slots_per_slab;
+    mddl_mallocater_t *heap_p;
+
+    mempool_slot_t *free_p;	/* 開放されたスロットのリスト */
+    mempool_slab_t *slabs;	/* スラブのリスト(先頭が最初に確保したスラブ) */
+    mempool_slab_t *last_slab;
+    mempool_slab_t *cur_slab;	/* bumpで払い出し中のスラブ */
+
+    size_t capacity;
+    size_t used_cnt;
+
+    union {
+	unsigned int flags;
+	struct {
+	    unsigned int buffer_fixed:1; /* 利用者のバッファを使用していてスラブを追加できない */
+	} f;
+    } stat;
+} mddl_mempool_ext_t;
+
+#define get_mempool_ext(s) (mddl_mempool_ext_t*)((s)->ext)
+#define get_const_mempool_ext(s) (const mddl_mempool_ext_t*)((s)->ext)
+
+/**
+ * @fn static void *pool_backend_alloc(mddl_mempool_ext_t *const e, const size_t size)
+ * @brief スラブの確保元からメモリを確保します
+ * @param e mddl_mempool_ext_t構造体ポインタ
+ * @param size 確保サイズ
+ */
+static void *pool_backend_alloc(mddl_mempool_ext_t *const e, const size_t size)
+{
+    if( NULL != e->heap_p ) {
+	return mddl_mallocater_alloc_with_obj(e->heap_p, size);
+    }
+    return mddl_malloc(size);
+}
+
+/**
+ * @fn static void pool_backend_free(mddl_mempool_ext_t *const e, void *const ptr)
+ * @brief スラブの確保元へメモリを戻します
+ * @param e mddl_mempool_ext_t構造体ポインタ
+ * @param ptr 開放するポインタ
+ */
+static void pool_backend_free(mddl_mempool_ext_t *const e, void *const ptr)
+{
+    if( NULL != e->heap_p ) {
+	mddl_mallocater_free_with_obj(e->heap_p, ptr);
+	return;
+    }
+    mddl_free(ptr);
+}
+
+/**
+ * @fn static void pool_link_slab(mddl_mempool_ext_t *const e, mempool_slab_t *const s, const size_t nslots)
+ * @brief スラブを初期化してリストの末尾に追加します
+ * @param e mddl_mempool_ext_t構造体ポインタ
+ * @param s スラブの先頭
+ * @param nslots スロット数
+ */
+static void pool_link_slab(mddl_mempool_ext_t *const e, mempool_slab_t *const s, const size_t nslots)
+{
+    s->next = NULL;
+    s->nslots = nslots;
+    s->bump = 0;
+
+    if( NULL == e->last_slab ) {
+	e->slabs = s;
+    } else {
+	e->last_slab->next = s;
+    }
+    e->last_slab = s;
+    if( NULL == e->cur_slab ) {
+	e->cur_slab = s;
+    }
+    e->capacity += nslots;
+}
+
+/**
+ * @fn static int pool_add_slab(mddl_mempool_ext_t *const e)
+ * @brief スラブを1つ確保元から追加します
+ * @param e mddl_mempool_ext_t構造体ポインタ
+ * @retval 0 成功
+ * @retval EPERM 利用者のバッファを使用している
+ * @retval ENOMEM メモリ不足
+ */
+static int pool_add_slab(mddl_mempool_ext_t *const e)
+{
+    mempool_slab_t *s;
+
+    if( e->stat.f.buffer_fixed ) {
+	return EPERM;
+    }
+
+    s = (mempool_slab_t*)pool_backend_alloc(e, SIZEOF_SLABHEADER + (e->slot_size * e->slots_per_slab));
+    if( NULL == s ) {
+	DBMS1("%s : pool_backend_alloc fail" EOL_CRLF, __func__);
+	return ENOMEM;
+    }
+    pool_link_slab(e, s, e->slots_per_slab);
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mempool_init( mddl_mempool_t *const self_p, const size_t sizof_slot, const mddl_mempool_attr_t *const attr_p)
+ * @brief メモリプールを初期化します
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @param sizof_slot 1以上のスロットのサイズ
+ * @param attr_p 属性(NULLの場合はmddl_mallocからデフォルトのスラブサイズで確保)
+ * @retval 0 成功
+ * @retval EINVAL 引数が不正
+ * @retval EAGAIN リソースの獲得に失敗
+ */
+int mddl_mempool_init( mddl_mempool_t *const self_p, const size_t sizof_slot, const mddl_mempool_attr_t *const attr_p)
+{
+    mddl_mempool_ext_t *e;
+    mddl_mallocater_t *const heap_p = (NULL == attr_p) ? NULL : attr_p->heap_p;
+    size_t prefill = (NULL == attr_p) ? 0 : attr_p->prefill_slots;
+    int result;
+
+    memset(self_p, 0x0, sizeof(mddl_mempool_t));
+
+    if( !(sizof_slot > 0) ) {
+	return EINVAL;
+    }
+
+    e = (mddl_mempool_ext_t*)((NULL != heap_p) ?
+	    mddl_mallocater_alloc_with_obj(heap_p, sizeof(mddl_mempool_ext_t)) : mddl_malloc(sizeof(mddl_mempool_ext_t)));
+    if( NULL == e ) {
+	DBMS1("%s : alloc(ext) fail" EOL_CRLF, __func__);
+	return EAGAIN;
+    }
+    memset(e, 0x0, sizeof(mddl_mempool_ext_t));
+
+    e->heap_p = heap_p;
+    e->slot_size = ALIGN_CEIL((sizof_slot < sizeof(mempool_slot_t)) ? sizeof(mempool_slot_t) : sizof_slot);
+    e->slots_per_slab = ((NULL == attr_p) || (0 == attr_p->slots_per_slab)) ?
+	MEMPOOL_DEFAULT_SLOTS_PER_SLAB : attr_p->slots_per_slab;
+
+    self_p->sizof_slot = sizof_slot;
+    self_p->ext = e;
+
+    /* 指定されたスロット数まで事前に確保する */
+    while( e->capacity < prefill ) {
+	result = pool_add_slab(e);
+	if(result) {
+	    DBMS1("%s : pool_add_slab fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
+	    mddl_mempool_destroy(self_p);
+	    return EAGAIN;
+	}
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mempool_init_with_buffer( mddl_mempool_t *const self_p, const size_t sizof_slot, void *const buf, const size_t bufsiz)
+ * @brief 利用者が指定したバッファでメモリプールを初期化します
+ *	管理情報もbufから切り出すので、アロケータを一切呼び出しません。
+ *	スロット数はbufsizで固定され、使い切ると mddl_mempool_alloc() はNULLを返します。
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @param sizof_slot 1以上のスロットのサイズ
+ * @param buf プールに使用するバッファ
+ * @param bufsiz bufのサイズ
+ * @retval 0 成功
+ * @retval EINVAL 引数が不正
+ * @retval ENOMEM バッファが小さすぎてスロットを1つも確保できない
+ */
+int mddl_mempool_init_with_buffer( mddl_mempool_t *const self_p, const size_t sizof_slot, void *const buf, const size_t bufsiz)
+{
+    mddl_mempool_ext_t *e;
+    const uintptr_t top = ALIGN_CEIL((uintptr_t)buf);
+    const uintptr_t end = (uintptr_t)buf + bufsiz;
+    mempool_slab_t *s;
+    size_t slot_size, nslots;
+
+    memset(self_p, 0x0, sizeof(mddl_mempool_t));
+
+    if( (NULL == buf) || !(sizof_slot > 0) ) {
+	return EINVAL;
+    }
+
+    slot_size = ALIGN_CEIL((sizof_slot < sizeof(mempool_slot_t)) ? sizeof(mempool_slot_t) : sizof_slot);
+    if( (top + ALIGN_CEIL(sizeof(mddl_mempool_ext_t)) + SIZEOF_SLABHEADER + slot_size) > end ) {
+	return ENOMEM;
+    }
+
+    e = (mddl_mempool_ext_t*)top;
+    memset(e, 0x0, sizeof(mddl_mempool_ext_t));
+    s = (mempool_slab_t*)(top + ALIGN_CEIL(sizeof(mddl_mempool_ext_t)));
+    nslots = (end - ((uintptr_t)s + SIZEOF_SLABHEADER)) / slot_size;
+
+    e->slot_size = slot_size;
+    e->slots_per_slab = nslots;
+    e->stat.f.buffer_fixed = 1;
+    pool_link_slab(e, s, nslots);
+
+    self_p->sizof_slot = sizof_slot;
+    self_p->ext = e;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_mempool_destroy( mddl_mempool_t *const self_p)
+ * @brief メモリプールを破棄し、全てのスラブを確保元に戻します
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @return 0固定
+ */
+int mddl_mempool_destroy( mddl_mempool_t *const self_p)
+{
+    mddl_mempool_ext_t *const e = get_mempool_ext(self_p);
+    mempool_slab_t *s;
+
+    if( NULL == e ) {
+	return 0;
+    }
+
+    if( !e->stat.f.buffer_fixed ) {
+	s = e->slabs;
+	while( NULL != s ) {
+	    mempool_slab_t *const next = s->next;
+	    pool_backend_free(e, s);
+	    s = next;
+	}
+	pool_backend_free(e, e);
+    }
+    self_p->ext = NULL;
+
+    return 0;
+}
+
+/**
+ * @fn void *mddl_mempool_alloc( mddl_mempool_t *const self_p)
+ * @brief スロットを1つ確保します
+ *	開放済みのスロット、未使用のスロットの順に払い出し、無ければスラブを追加します。
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @retval NULL 確保できない(errnoにENOMEMを設定)
+ * @retval NULL以外 スロットのポインタ
+ */
+void *mddl_mempool_alloc( mddl_mempool_t *const self_p)
+{
+    mddl_mempool_ext_t *const e = get_mempool_ext(self_p);
+    mempool_slot_t *slot;
+
+    if( NULL != e->free_p ) {
+	slot = e->free_p;
+	e->free_p = slot->next;
+	++(e->used_cnt);
+	return slot;
+    }
+
+    while( (NULL != e->cur_slab) && (e->cur_slab->bump == e->cur_slab->nslots) ) {
+	e->cur_slab = e->cur_slab->next;
+    }
+    if( NULL == e->cur_slab ) {
+	if( pool_add_slab(e) ) {
+	    errno = ENOMEM;
+	    return NULL;
+	}
+	e->cur_slab = e->last_slab;
+    }
+
+    slot = GET_SLAB_SLOT(e, e->cur_slab, e->cur_slab->bump);
+    ++(e->cur_slab->bump);
+    ++(e->used_cnt);
+
+    return slot;
+}
+
+/**
+ * @fn void mddl_mempool_free( mddl_mempool_t *const self_p, void *const ptr)
+ * @brief mddl_mempool_alloc()で確保したスロットをプールに戻します
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @param ptr スロットのポインタ(NULLは何もしません)
+ */
+void mddl_mempool_free( mddl_mempool_t *const self_p, void *const ptr)
+{
+    mddl_mempool_ext_t *const e = get_mempool_ext(self_p);
+    mempool_slot_t *const slot = (mempool_slot_t*)ptr;
+
+    if( NULL == ptr ) {
+	return;
+    }
+
+    slot->next = e->free_p;
+    e->free_p = slot;
+    --(e->used_cnt);
+}
+
+/**
+ * @fn int mddl_mempool_reset( mddl_mempool_t *const self_p)
+ * @brief 払い出した全てのスロットを一括でプールに戻します
+ *	スラブは保持したままで、個々のスロットには触れません(スラブ数に比例する処理です)。
+ *	リセット前に払い出したポインタは以降使用しないでください。
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @return 0固定
+ */
+int mddl_mempool_reset( mddl_mempool_t *const self_p)
+{
+    mddl_mempool_ext_t *const e = get_mempool_ext(self_p);
+    mempool_slab_t *s;
+
+    for( s=e->slabs; NULL != s; s=s->next ) {
+	s->bump = 0;
+    }
+    e->free_p = NULL;
+    e->cur_slab = e->slabs;
+    e->used_cnt = 0;
+
+    return 0;
+}
+
+/**
+ * @fn size_t mddl_mempool_get_capacity( mddl_mempool_t *const self_p)
+ * @brief 確保済みのスラブに含まれるスロットの総数を返します
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @return スロット数
+ */
+size_t mddl_mempool_get_capacity( mddl_mempool_t *const self_p)
+{
+    const mddl_mempool_ext_t *const e = get_const_mempool_ext(self_p);
+
+    return e->capacity;
+}
+
+/**
+ * @fn size_t mddl_mempool_get_used_cnt( mddl_mempool_t *const self_p)
+ * @brief 払い出し中のスロット数を返します
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @return スロット数
+ */
+size_t mddl_mempool_get_used_cnt( mddl_mempool_t *const self_p)
+{
+    const mddl_mempool_ext_t *const e = get_const_mempool_ext(self_p);
+
+    return e->used_cnt;
+}
+
+static void *mempool_alc_alloc(void *const ctx, const size_t size)
+{
+    mddl_mempool_t *const self_p = (mddl_mempool_t*)ctx;
+
+    if( size > self_p->sizof_slot ) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return mddl_mempool_alloc(self_p);
+}
+
+static void *mempool_alc_realloc(void *const ctx, void *const ptr, const size_t size)
+{
+    mddl_mempool_t *const self_p = (mddl_mempool_t*)ctx;
+
+    if( NULL == ptr ) {
+	return mempool_alc_alloc(ctx, size);
+    } else if( size > self_p->sizof_slot ) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return ptr;
+}
+
+static void mempool_alc_free(void *const ctx, void *const ptr)
+{
+    mddl_mempool_free((mddl_mempool_t*)ctx, ptr);
+}
+
+/**
+ * @fn int mddl_mempool_get_allocator( mddl_mempool_t *const self_p, mddl_allocator_t *const alc_p)
+ * @brief コンテナのinit_exに指定するアロケータを取得します
+ *	スロットサイズを超える要求はNULLを返すので、list/slistのノードやdequeのページのように
+ *	サイズが一定の領域に使用してください。
+ * @param self_p mddl_mempool_t構造体インスタンスポインタ
+ * @param alc_p 設定するmddl_allocator_t構造体ポインタ
+ * @retval 0 成功
+ * @retval EINVAL 引数が不正
+ */
+int mddl_mempool_get_allocator( mddl_mempool_t *const self_p, mddl_allocator_t *const alc_p)
+{
+    if( (NULL == self_p) || (NULL == alc_p) ) {
+	return EINVAL;
+    }
+
+    alc_p->alloc = mempool_alc_alloc;
+    alc_p->realloc = mempool_alc_realloc;
+    alc_p->free = mempool_alc_free;
+    alc_p->ctx = self_p;
+
+    return 0;
+}
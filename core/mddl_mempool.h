@@ -0,0 +1,44 @@
+#ifndef INC_MDDL_MEMPOOL_H
+#define INC_MDDL_MEMPOOL_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mddl_allocator.h"
+#include "mddl_mallocater.h"
+
+typedef struct _mddl_mempool_attr {
+    mddl_mallocater_t *heap_p;	/* スラブの確保元(NULLの場合はmddl_malloc) */
+    size_t slots_per_slab;	/* 1スラブのスロット数(0の場合はデフォルト) */
+    size_t prefill_slots;	/* 初期化時に確保しておくスロット数 */
+} mddl_mempool_attr_t;
+
+typedef struct _mddl_mempool {
+    size_t sizof_slot;
+    void *ext;
+} mddl_mempool_t;
+
+#if defined (__cplusplus )
+extern "C" {
+#endif
+
+int mddl_mempool_init( mddl_mempool_t *const self_p, const size_t sizof_slot, const mddl_mempool_attr_t *const attr_p);
+int mddl_mempool_init_with_buffer( mddl_mempool_t *const self_p, const size_t sizof_slot, void *const buf, const size_t bufsiz);
+int mddl_mempool_destroy( mddl_mempool_t *const self_p);
+
+void *mddl_mempool_alloc( mddl_mempool_t *const self_p);
+void mddl_mempool_free( mddl_mempool_t *const self_p, void *const ptr);
+int mddl_mempool_reset( mddl_mempool_t *const self_p);
+
+size_t mddl_mempool_get_capacity( mddl_mempool_t *const self_p);
+size_t mddl_mempool_get_used_cnt( mddl_mempool_t *const self_p);
+
+int mddl_mempool_get_allocator( mddl_mempool_t *const self_p, mddl_allocator_t *const alc_p);
+
+#if defined (__cplusplus )
+}
+#endif
+
+#endif /* end of INC_MDDL_MEMPOOL_H */
@@ -0,0 +1,383 @@
+#ifndef INC_MDDL_STL_CXX_H
+#define INC_MDDL_STL_CXX_H
+
+#pragma once
+
+/**
+ * @file mddl_stl_cxx.h
+ * @brief mddl_stl_vector/deque/listの型付きC++ラッパーです(ヘッダのみ、C++17以降)
+ *	要素サイズはsizeof(T)の定数になるので、要素の参照と末尾への追加はインライン展開され、
+ *	通常のロード・ストアにコンパイルされます。それ以外の操作はCのAPIを呼び出します。
+ *	格納形式はCと同じなので、raw()で得たインスタンスをCのAPIにそのまま渡せます。
+ *	Cの実装は要素をmemcpy/reallocで移動するので、Tはトリビアルにコピー可能な型に限ります。
+ *	Cのエラーは例外に変換します(EAGAIN:std::bad_alloc、ENOENT:std::out_of_range、その他:std::system_error)。
+ */
+
+#if !defined(__cplusplus) || (__cplusplus < 201703L)
+#error "mddl_stl_cxx.h requires C++17"
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <iterator>
+#include <utility>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <initializer_list>
+
+#include "mddl_stl_vector.h"
+#include "mddl_stl_deque.h"
+#include "mddl_stl_list.h"
+
+namespace mddl {
+
+namespace detail {
+/**
+ * @brief CのAPIの戻り値を例外に変換します
+ */
+inline void check(const int result)
+{
+    if( 0 == result ) {
+	return;
+    } else if( (EAGAIN == result) || (ENOMEM == result) ) {
+	throw std::bad_alloc();
+    } else if( ENOENT == result ) {
+	throw std::out_of_range("mddl_stl: element number out of range");
+    }
+    throw std::system_error(result, std::generic_category());
+}
+
+template <class T>
+struct element_check {
+    static_assert(std::is_trivially_copyable<T>::value, "mddl_stl containers move elements with memcpy");
+    static_assert(alignof(T) <= alignof(void*), "mddl heaps align element buffers to pointer size only");
+};
+} /* end of namespace detail */
+
+/**
+ * @class vector
+ * @brief mddl_stl_vector_tの型付きラッパーです
+ *	ムーブ元は破棄か代入以外に使わないでください。
+ */
+template <class T>
+class vector : private detail::element_check<T> {
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    vector() { detail::check(mddl_stl_vector_init(&v_, sizeof(T))); }
+    explicit vector(const mddl_stl_vector_attr_t &attr) { detail::check(mddl_stl_vector_init_ex(&v_, sizeof(T), &attr)); }
+    vector(std::initializer_list<T> il) : vector() { assign(il.begin(), il.size()); }
+    vector(const vector &other) : vector() { assign(other.data(), other.size()); }
+    vector(vector &&other) noexcept : v_(other.v_) { other.v_.ext = nullptr; }
+    ~vector() { mddl_stl_vector_destroy(&v_); }
+
+    vector &operator=(const vector &other)
+    {
+	if( this != &other ) {
+	    if( nullptr == v_.ext ) {
+		/* ムーブ元への代入 */
+		detail::check(mddl_stl_vector_init(&v_, sizeof(T)));
+	    }
+	    assign(other.data(), other.size());
+	}
+	return *this;
+    }
+    vector &operator=(vector &&other) noexcept
+    {
+	if( this != &other ) {
+	    mddl_stl_vector_destroy(&v_);
+	    v_ = other.v_;
+	    other.v_.ext = nullptr;
+	}
+	return *this;
+    }
+
+    /* 要素の参照(インライン) */
+    size_type size() const noexcept { return (nullptr == v_.ext) ? 0 : head()->num_elements; }
+    size_type capacity() const noexcept { return (nullptr == v_.ext) ? 0 : head()->reserved_bytes / sizeof(T); }
+    bool empty() const noexcept { return 0 == size(); }
+    T *data() noexcept { return (nullptr == v_.ext) ? nullptr : static_cast<T*>(head()->buf); }
+    const T *data() const noexcept { return (nullptr == v_.ext) ? nullptr : static_cast<const T*>(head()->buf); }
+    T &operator[](const size_type n) noexcept { return data()[n]; }
+    const T &operator[](const size_type n) const noexcept { return data()[n]; }
+    T &at(const size_type n) { range_check(n); return data()[n]; }
+    const T &at(const size_type n) const { range_check(n); return data()[n]; }
+    T &front() noexcept { return data()[0]; }
+    const T &front() const noexcept { return data()[0]; }
+    T &back() noexcept { return data()[size() - 1]; }
+    const T &back() const noexcept { return data()[size() - 1]; }
+
+    iterator begin() noexcept { return data(); }
+    iterator end() noexcept { return data() + size(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    /* 末尾への追加。容量が足りている場合はCのAPIを呼ばない */
+    template <class... Args>
+    T &emplace_back(Args&&... args)
+    {
+	void *slot;
+	mddl_stl_vector_ext_head_t *const h = head();
+
+	if( (h->num_elements + 1) * sizeof(T) <= h->reserved_bytes ) {
+	    slot = static_cast<T*>(h->buf) + h->num_elements;
+	    ++(h->num_elements);
+	    return *::new(slot) T(std::forward<Args>(args)...);
+	}
+	/* 引数が自身の要素を指していても良いように、拡張の前に構築する */
+	T tmp(std::forward<Args>(args)...);
+	slot = mddl_stl_vector_emplace_back(&v_);
+	if( nullptr == slot ) {
+	    detail::check(errno);
+	}
+	return *::new(slot) T(std::move(tmp));
+    }
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    void pop_back() noexcept
+    {
+	if( size() ) {
+	    --(head()->num_elements);
+	}
+    }
+
+    /* 容量の変更や移動を伴う操作 */
+    template <class... Args>
+    iterator emplace(const_iterator pos, Args&&... args)
+    {
+	T tmp(std::forward<Args>(args)...);
+	void *const slot = mddl_stl_vector_emplace_at(&v_, index_of(pos));
+	if( nullptr == slot ) {
+	    detail::check(errno);
+	}
+	return ::new(slot) T(std::move(tmp));
+    }
+    iterator insert(const_iterator pos, const T &value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, const T *const src, const size_type n)
+    {
+	const size_type at = index_of(pos);
+	detail::check(mddl_stl_vector_insert_range(&v_, at, src, n, sizeof(T)));
+	return data() + at;
+    }
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+	const size_type at = index_of(first);
+	detail::check(mddl_stl_vector_erase_range(&v_, at, index_of(last)));
+	return data() + at;
+    }
+    void append(const T *const src, const size_type n) { detail::check(mddl_stl_vector_append_n(&v_, src, n, sizeof(T))); }
+    void assign(const T *const src, const size_type n) { detail::check(mddl_stl_vector_assign(&v_, src, n, sizeof(T))); }
+    void reserve(const size_type n)
+    {
+	if( n > capacity() ) {
+	    detail::check(mddl_stl_vector_reserve(&v_, n));
+	}
+    }
+    void resize(const size_type n, const T &value = T())
+    {
+	if( n != size() ) {
+	    detail::check(mddl_stl_vector_resize(&v_, n, &value, sizeof(T)));
+	}
+    }
+    void shrink_to_fit() { detail::check(mddl_stl_vector_shrink(&v_, size())); }
+    /* std::vectorと同じく容量は解放しない */
+    void clear() noexcept
+    {
+	if( nullptr != v_.ext ) {
+	    head()->num_elements = 0;
+	}
+    }
+
+    mddl_stl_vector_t *raw() noexcept { return &v_; }
+
+private:
+    mddl_stl_vector_ext_head_t *head() const noexcept { return static_cast<mddl_stl_vector_ext_head_t*>(v_.ext); }
+    size_type index_of(const_iterator pos) const noexcept { return static_cast<size_type>(pos - data()); }
+    void range_check(const size_type n) const
+    {
+	if( n >= size() ) {
+	    throw std::out_of_range("mddl::vector::at");
+	}
+    }
+
+    mddl_stl_vector_t v_;
+};
+
+/**
+ * @class deque
+ * @brief mddl_stl_deque_tの型付きラッパーです
+ *	要素は個別に確保されるので、要素のアドレスは前後への追加・削除で変わりません。
+ */
+template <class T>
+class deque : private detail::element_check<T> {
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+
+    /* 要素番号で辿るランダムアクセスイテレータ */
+    template <class D, class V>
+    class basic_iterator {
+    public:
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef V value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef V *pointer;
+	typedef V &reference;
+
+	basic_iterator(D *const d, const size_type n) noexcept : d_(d), n_(n) {}
+	reference operator*() const noexcept { return (*d_)[n_]; }
+	pointer operator->() const noexcept { return &(*d_)[n_]; }
+	reference operator[](const difference_type k) const noexcept { return (*d_)[n_ + k]; }
+	basic_iterator &operator++() noexcept { ++n_; return *this; }
+	basic_iterator operator++(int) noexcept { basic_iterator t(*this); ++n_; return t; }
+	basic_iterator &operator--() noexcept { --n_; return *this; }
+	basic_iterator operator--(int) noexcept { basic_iterator t(*this); --n_; return t; }
+	basic_iterator &operator+=(const difference_type k) noexcept { n_ += k; return *this; }
+	basic_iterator &operator-=(const difference_type k) noexcept { n_ -= k; return *this; }
+	basic_iterator operator+(const difference_type k) const noexcept { return basic_iterator(d_, n_ + k); }
+	basic_iterator operator-(const difference_type k) const noexcept { return basic_iterator(d_, n_ - k); }
+	difference_type operator-(const basic_iterator &o) const noexcept { return static_cast<difference_type>(n_ - o.n_); }
+	bool operator==(const basic_iterator &o) const noexcept { return n_ == o.n_; }
+	bool operator!=(const basic_iterator &o) const noexcept { return n_ != o.n_; }
+	bool operator<(const basic_iterator &o) const noexcept { return n_ < o.n_; }
+	bool operator>(const basic_iterator &o) const noexcept { return n_ > o.n_; }
+	bool operator<=(const basic_iterator &o) const noexcept { return n_ <= o.n_; }
+	bool operator>=(const basic_iterator &o) const noexcept { return n_ >= o.n_; }
+	size_type index() const noexcept { return n_; }
+
+    private:
+	D *d_;
+	size_type n_;
+    };
+    typedef basic_iterator<deque, T> iterator;
+    typedef basic_iterator<const deque, const T> const_iterator;
+
+    deque() { detail::check(mddl_stl_deque_init(&d_, sizeof(T))); }
+    explicit deque(const mddl_stl_deque_attr_t &attr) { detail::check(mddl_stl_deque_init_ex(&d_, sizeof(T), &attr)); }
+    deque(const deque&) = delete;
+    deque &operator=(const deque&) = delete;
+    deque(deque &&other) noexcept : d_(other.d_) { other.d_.ext = nullptr; }
+    deque &operator=(deque &&other) noexcept
+    {
+	if( this != &other ) {
+	    release();
+	    d_ = other.d_;
+	    other.d_.ext = nullptr;
+	}
+	return *this;
+    }
+    ~deque() { release(); }
+
+    size_type size() const noexcept { return (nullptr == d_.ext) ? 0 : mddl_stl_deque_get_pool_cnt(raw_const()); }
+    bool empty() const noexcept { return 0 == size(); }
+    T &operator[](const size_type n) noexcept { return *static_cast<T*>(mddl_stl_deque_ptr_at(&d_, n)); }
+    const T &operator[](const size_type n) const noexcept { return *static_cast<const T*>(mddl_stl_deque_ptr_at(raw_const(), n)); }
+    T &at(const size_type n)
+    {
+	void *const p = mddl_stl_deque_ptr_at(&d_, n);
+	if( nullptr == p ) {
+	    throw std::out_of_range("mddl::deque::at");
+	}
+	return *static_cast<T*>(p);
+    }
+    T &front() noexcept { return (*this)[0]; }
+    T &back() noexcept { return (*this)[size() - 1]; }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, size()); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size()); }
+
+    void push_back(const T &value) { detail::check(mddl_stl_deque_push_back(&d_, &value, sizeof(T))); }
+    void push_front(const T &value) { detail::check(mddl_stl_deque_push_front(&d_, &value, sizeof(T))); }
+    void pop_back() noexcept { mddl_stl_deque_pop_back(&d_); }
+    void pop_front() noexcept { mddl_stl_deque_pop_front(&d_); }
+    void insert(const size_type n, const T &value) { detail::check(mddl_stl_deque_insert(&d_, n, &value, sizeof(T))); }
+    void erase(const size_type n) { detail::check(mddl_stl_deque_remove_at(&d_, n)); }
+    void clear() noexcept { mddl_stl_deque_clear(&d_); }
+
+    mddl_stl_deque_t *raw() noexcept { return &d_; }
+
+private:
+    /* CのAPIはconstを取らないので、参照専用の呼び出しに限って外す */
+    mddl_stl_deque_t *raw_const() const noexcept { return const_cast<mddl_stl_deque_t*>(&d_); }
+    void release() noexcept
+    {
+	if( nullptr != d_.ext ) {
+	    mddl_stl_deque_destroy(&d_);
+	    d_.ext = nullptr;
+	}
+    }
+
+    mddl_stl_deque_t d_;
+};
+
+/**
+ * @class list
+ * @brief mddl_stl_list_tの型付きラッパーです
+ *	Cの実装は要素番号による参照のみを公開しているので、イテレータは提供しません。
+ */
+template <class T>
+class list : private detail::element_check<T> {
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+
+    list() { detail::check(mddl_stl_list_init(&l_, sizeof(T))); }
+    explicit list(const mddl_stl_list_attr_t &attr) { detail::check(mddl_stl_list_init_ex(&l_, sizeof(T), &attr)); }
+    list(const list&) = delete;
+    list &operator=(const list&) = delete;
+    list(list &&other) noexcept : l_(other.l_) { other.l_.ext = nullptr; }
+    list &operator=(list &&other) noexcept
+    {
+	if( this != &other ) {
+	    release();
+	    l_ = other.l_;
+	    other.l_.ext = nullptr;
+	}
+	return *this;
+    }
+    ~list() { release(); }
+
+    size_type size() const noexcept { return (nullptr == l_.ext) ? 0 : mddl_stl_list_get_pool_cnt(const_cast<mddl_stl_list_t*>(&l_)); }
+    bool empty() const noexcept { return 0 == size(); }
+
+    T front() const { T v; detail::check(mddl_stl_list_front(const_cast<mddl_stl_list_t*>(&l_), &v, sizeof(T))); return v; }
+    T back() const { T v; detail::check(mddl_stl_list_back(const_cast<mddl_stl_list_t*>(&l_), &v, sizeof(T))); return v; }
+    T get(const size_type n) const { T v; detail::check(mddl_stl_list_get_element_at(const_cast<mddl_stl_list_t*>(&l_), n, &v, sizeof(T))); return v; }
+    void set(const size_type n, const T &value) { detail::check(mddl_stl_list_overwrite_element_at(&l_, n, &value, sizeof(T))); }
+
+    void push_back(const T &value) { detail::check(mddl_stl_list_push_back(&l_, &value, sizeof(T))); }
+    void push_front(const T &value) { detail::check(mddl_stl_list_push_front(&l_, &value, sizeof(T))); }
+    void pop_back() noexcept { mddl_stl_list_pop_back(&l_); }
+    void pop_front() noexcept { mddl_stl_list_pop_front(&l_); }
+    void insert(const size_type n, const T &value) { detail::check(mddl_stl_list_insert(&l_, n, &value, sizeof(T))); }
+    void erase(const size_type n) { detail::check(mddl_stl_list_remove_at(&l_, n)); }
+    void clear() noexcept { mddl_stl_list_clear(&l_); }
+
+    mddl_stl_list_t *raw() noexcept { return &l_; }
+
+private:
+    void release() noexcept
+    {
+	if( nullptr != l_.ext ) {
+	    mddl_stl_list_destroy(&l_);
+	    l_.ext = nullptr;
+	}
+    }
+
+    mddl_stl_list_t l_;
+};
+
+} /* end of namespace mddl */
+
+#endif /* end of INC_MDDL_STL_CXX_H */
@@ -14,7 +14,8 @@
  * @brief 両端待ち行列ライブラリ STLのdequeクラス互換です。
  *	なのでスレッドセーフではありません。上位層で処理を行ってください。
  *	STL互換と言ってもCの実装です、オブジェクトの破棄の処理はしっかり実装してください
- *  ※ 現状はmallocを乱発します。機会があれば、メモリ管理マネージャに切り替えます。
+ *  ※ 標準ではエレメント毎にmddl_mallocを呼び出します。init_exでアロケータ(mddl_mempool等)を指定すると、
+ *	インスタンス毎に確保元を切り替えられます。
  */
 
 /* POSIX */
@@ -58,6 +59,7 @@ void __attribute__((weak)) mddl_free( void *const ptr )
 typedef struct _mddl_stl_deque_ext {
     size_t sizof_element;
     mddl_stl_vector_t vect;
+    mddl_allocator_t alc;
 
     union {
 	unsigned int flags;
@@ -70,6 +72,25 @@ typedef struct _mddl_stl_deque_ext {
 #define get_stl_deque_ext(s) (mddl_stl_deque_ext_t*)((s)->ext)
 #define get_const_stl_deque_ext(s) (const mddl_stl_deque_ext_t*)((s)->ext)
 
+#define deque_alloc(e, z) (e)->alc.alloc((e)->alc.ctx, (z))
+#define deque_free(e, p) (e)->alc.free((e)->alc.ctx, (p))
+
+static void *deque_default_alloc(void *const ctx, const size_t size)
+{
+    (void)ctx;
+    return mddl_malloc(size);
+}
+
+static void deque_default_free(void *const ctx, void *const ptr)
+{
+    (void)ctx;
+    mddl_free(ptr);
+}
+
+static const mddl_allocator_t deque_default_allocator = {
+    deque_default_alloc, NULL, deque_default_free, NULL
+};
+
 /**
  * @fn int mddl_stl_deque_init( mddl_stl_deque_t *const self_p, const size_t sizof_element)
  * @brief インスタンスを初期化します
@@ -83,10 +104,33 @@ typedef struct _mddl_stl_deque_ext {
 int mddl_stl_deque_init(mddl_stl_deque_t *const self_p,
 			   const size_t sizof_element)
 {
+    return mddl_stl_deque_init_ex(self_p, sizof_element, NULL);
+}
+
+/**
+ * @fn int mddl_stl_deque_init_ex( mddl_stl_deque_t *const self_p, const size_t sizof_element, const mddl_stl_deque_attr_t *const attr_p)
+ * @brief 属性を指定してインスタンスを初期化します
+ *	attr_p->allocator_pを指定すると、エレメントのページをそのアロケータから確保します。
+ *	エレメントのページは固定サイズなので、reallocは不要(NULL可)です。管理情報とページの索引はmddl_mallocから確保します。
+ * @param self_p mddl_stl_deque_t構造体インスタンスポインタ
+ * @param sizof_element 1以上のエレメントのサイズ
+ * @param attr_p 属性(NULLの場合はmddl_stl_deque_init()と同じ)
+ * @retval 0 成功
+ * @retval EINVAL アロケータの関数が設定されていない
+ * @retval EAGAIN リソースの獲得に失敗
+ */
+int mddl_stl_deque_init_ex( mddl_stl_deque_t *const self_p, const size_t sizof_element, const mddl_stl_deque_attr_t *const attr_p)
+{
+    const mddl_allocator_t *const alc_p = ((NULL == attr_p) || (NULL == attr_p->allocator_p)) ?
+	&deque_default_allocator : attr_p->allocator_p;
     int result, status;
     mddl_stl_deque_ext_t * __restrict e = NULL;
     memset(self_p, 0x0, sizeof(mddl_stl_deque_t));
 
+    if( (NULL == alc_p->alloc) || (NULL == alc_p->free) ) {
+	return EINVAL;
+    }
+
     e = (mddl_stl_deque_ext_t *)
 	mddl_malloc(sizeof(mddl_stl_deque_ext_t));
     if (NULL == e) {
@@ -97,6 +141,7 @@ int mddl_stl_deque_init(mddl_stl_deque_t *const self_p,
 
     self_p->ext = e;
     self_p->sizeof_element = e->sizof_element = sizof_element;
+    e->alc = *alc_p;
 
     result = mddl_stl_vector_init( &e->vect, sizeof(void*));
     if( result ) {
@@ -189,7 +234,7 @@ int mddl_stl_deque_push_back(mddl_stl_deque_t *const self_p,
 	return EINVAL;
     }
 
-    page = mddl_malloc(e->sizof_element);
+    page = deque_alloc(e, e->sizof_element);
     if (NULL == page) {
 	DBMS1("%s : mddl_malloc(queitem_t) fail" EOL_CRLF, __func__);
 	status = EAGAIN;
@@ -210,7 +255,7 @@ int mddl_stl_deque_push_back(mddl_stl_deque_t *const self_p,
   out:
     if (status) {
 	if (NULL != page) {
-	    mddl_free(page);
+	    deque_free(e, page);
 	}
     }
     return status;
@@ -256,7 +301,7 @@ int mddl_stl_deque_pop_front(mddl_stl_deque_t *const self_p)
 
     /* エレメントを外す */
     page = *(void**)mddl_stl_vector_ptr_at( &e->vect, 0 );
-    mddl_free(page);
+    deque_free(e, page);
 
     result = mddl_stl_vector_remove_at( &e->vect, 0);
     if(result) {
@@ -292,7 +337,7 @@ int mddl_stl_deque_pop_back(mddl_stl_deque_t *const self_p)
 
     /* エレメントを外す */
     page = *(void**)mddl_stl_vector_ptr_at( &e->vect, num );
-    mddl_free(page);
+    deque_free(e, page);
 
     result = mddl_stl_vector_pop_back( &e->vect);
     if(result) {
@@ -325,7 +370,7 @@ int mddl_stl_deque_clear(mddl_stl_deque_t *const self_p)
     total = mddl_stl_vector_get_pool_cnt( &e->vect );
     for (n=0; n<total; ++n) {
 	void *page = *(void**)mddl_stl_vector_ptr_at( &e->vect, n);
-	mddl_free(page);
+	deque_free(e, page);
     }
 
     /* ベクタテーブルをクリア */
@@ -455,7 +500,7 @@ int mddl_stl_deque_remove_at(mddl_stl_deque_t *const self_p,
     }
 
     page = *(void**)mddl_stl_vector_ptr_at( &e->vect, num );
-    mddl_free(page);
+    deque_free(e, page);
 
     result = mddl_stl_vector_remove_at( &e->vect, num);
     if(result) {
@@ -492,7 +537,7 @@ int mddl_stl_deque_insert(mddl_stl_deque_t *const self_p,
 	return EINVAL;
     }
 
-    page = mddl_malloc(e->sizof_element);
+    page = deque_alloc(e, e->sizof_element);
     if (NULL == page) {
 	DBMS1("%s : mddl_malloc(page) fail" EOL_CRLF, __func__);
 	status = EAGAIN;
@@ -512,7 +557,7 @@ int mddl_stl_deque_insert(mddl_stl_deque_t *const self_p,
   out:
     if (status) {
 	if (NULL != page) {
-	    mddl_free(page);
+	    deque_free(e, page);
 	}
     }
     return status;
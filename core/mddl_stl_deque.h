@@ -5,6 +5,12 @@
 
 #include <stddef.h>
 
+#include "mddl_allocator.h"
+
+typedef struct _mddl_stl_deque_attr {
+    const mddl_allocator_t *allocator_p; /* NULLの場合はmddl_malloc系を使用 */
+} mddl_stl_deque_attr_t;
+
 typedef struct _mddl_stl_deque {
    size_t sizeof_element;
    void *ext;
@@ -15,6 +21,7 @@ extern "C" {
 #endif
 
 int mddl_stl_deque_init( mddl_stl_deque_t *const self_p, const size_t sizeof_element);
+int mddl_stl_deque_init_ex( mddl_stl_deque_t *const self_p, const size_t sizof_element, const mddl_stl_deque_attr_t *const attr_p);
 int mddl_stl_deque_destroy( mddl_stl_deque_t *const self_p);
 int mddl_stl_deque_push_back( mddl_stl_deque_t *const self_p, const void *const el_p, const size_t sizeof_element);
 int mddl_stl_deque_push_front( mddl_stl_deque_t *const self_p, const void *const el_p, const size_t sizof_element );
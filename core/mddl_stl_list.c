@@ -13,7 +13,8 @@
  * @brief 双方向リンクリストライブラリ STLのlistクラス互換です。
  *	なのでスレッドセーフではありません。上位層で処理を行ってください。
  *	STL互換と言ってもCの実装です、オブジェクトの破棄の処理はしっかり実装してください
- *  ※ 現状はmallocを乱発します。機会があれば、メモリ管理マネージャに切り替えます。
+ *  ※ 標準ではエレメント毎にmddl_mallocを呼び出します。init_exでアロケータ(mddl_mempool等)を指定すると、
+ *	インスタンス毎に確保元を切り替えられます。
  */
 
 /* POSIX */
@@ -60,12 +61,32 @@ typedef struct _mddl_stl_list_ext {
     volatile size_t sizof_element;
     volatile size_t cnt;
     int start_id;
+    mddl_allocator_t alc;
     queitem_t base;		/* エレメントの基点。配列0の構造体があるので必ず最後にする */
 } mddl_stl_list_ext_t;
 
 #define get_stl_list_ext(s) (mddl_stl_list_ext_t*)((s)->ext)
 #define get_const_stl_list_ext(s) (const mddl_stl_list_ext_t*)((s)->ext)
 
+#define list_alloc(e, z) (e)->alc.alloc((e)->alc.ctx, (z))
+#define list_free(e, p) (e)->alc.free((e)->alc.ctx, (p))
+
+static void *list_default_alloc(void *const ctx, const size_t size)
+{
+    (void)ctx;
+    return mddl_malloc(size);
+}
+
+static void list_default_free(void *const ctx, void *const ptr)
+{
+    (void)ctx;
+    mddl_free(ptr);
+}
+
+static const mddl_allocator_t list_default_allocator = {
+    list_default_alloc, NULL, list_default_free, NULL
+};
+
 /**
  * @fn int mddl_stl_list_init( mddl_stl_list_t *const self_p, const size_t sizof_element)
  * @brief 双方向キューオブジェクトを初期化します
@@ -79,9 +100,32 @@ typedef struct _mddl_stl_list_ext {
 int mddl_stl_list_init(mddl_stl_list_t *const self_p,
 			   const size_t sizof_element)
 {
+    return mddl_stl_list_init_ex(self_p, sizof_element, NULL);
+}
+
+/**
+ * @fn int mddl_stl_list_init_ex( mddl_stl_list_t *const self_p, const size_t sizof_element, const mddl_stl_list_attr_t *const attr_p)
+ * @brief 属性を指定して双方向キューオブジェクトを初期化します
+ *	attr_p->allocator_pを指定すると、エレメントのノードをそのアロケータから確保します。
+ *	エレメントのノードは固定サイズなので、reallocは不要(NULL可)です。管理情報はmddl_mallocから確保します。
+ * @param self_p mddl_stl_list_t構造体インスタンスポインタ
+ * @param sizof_element 1以上のエレメントのサイズ
+ * @param attr_p 属性(NULLの場合はmddl_stl_list_init()と同じ)
+ * @retval 0 成功
+ * @retval EINVAL アロケータの関数が設定されていない
+ * @retval EAGAIN リソースの獲得に失敗
+ */
+int mddl_stl_list_init_ex( mddl_stl_list_t *const self_p, const size_t sizof_element, const mddl_stl_list_attr_t *const attr_p)
+{
+    const mddl_allocator_t *const alc_p = ((NULL == attr_p) || (NULL == attr_p->allocator_p)) ?
+	&list_default_allocator : attr_p->allocator_p;
     mddl_stl_list_ext_t *e = NULL;
     memset(self_p, 0x0, sizeof(mddl_stl_list_t));
 
+    if( (NULL == alc_p->alloc) || (NULL == alc_p->free) ) {
+	return EINVAL;
+    }
+
     e = (mddl_stl_list_ext_t *)
 	mddl_malloc(sizeof(mddl_stl_list_ext_t));
     if (NULL == e) {
@@ -94,6 +138,7 @@ int mddl_stl_list_init(mddl_stl_list_t *const self_p,
     self_p->sizeof_element = e->sizof_element = sizof_element;
     e->cnt = 0;
     e->start_id = 0;
+    e->alc = *alc_p;
 
     e->base.prev = e->base.next = &e->base;
 
@@ -153,7 +198,7 @@ int mddl_stl_list_push_back(mddl_stl_list_t *const self_p,
 	return EINVAL;
     }
 
-    f = (queitem_t *)mddl_malloc(sizeof(queitem_t) + e->sizof_element);
+    f = (queitem_t *)list_alloc(e, sizeof(queitem_t) + e->sizof_element);
     if (NULL == f) {
 	DBMS1("%s : mddl_malloc(queitem_t) fail" EOL_CRLF, __func__);
 	status = EAGAIN;
@@ -176,7 +221,7 @@ int mddl_stl_list_push_back(mddl_stl_list_t *const self_p,
   out:
     if (status) {
 	if (NULL != f) {
-	    mddl_free(f);
+	    list_free(e, f);
 	}
     }
     return status;
@@ -231,7 +276,7 @@ int mddl_stl_list_pop_front(mddl_stl_list_t *const self_p)
     ++e->start_id;
 
     if (tmp != &e->base) {
-	mddl_free(tmp);
+	list_free(e, tmp);
     }
 
     if (e->cnt == 0) {
@@ -272,7 +317,7 @@ int mddl_stl_list_pop_back(mddl_stl_list_t *const self_p)
     e->cnt--;
 
     if (tmp != &e->base) {
-	mddl_free(tmp);
+	list_free(e, tmp);
     }
 
     if (e->cnt == 0) {
@@ -476,7 +521,7 @@ int mddl_stl_list_remove_at(mddl_stl_list_t *const self_p,
     };
 
     /* itemのエレメントを削除 */
-    mddl_free(item_p);
+    list_free(e, item_p);
 
     return 0;
 }
@@ -574,7 +619,7 @@ int mddl_stl_list_insert(mddl_stl_list_t *const self_p,
     DBMS3("%s : front=0x%p e->base=0x%p" EOL_CRLF,
 	  __func__, front, &e->base);
 
-    f = (queitem_t *) mddl_malloc(sizeof(queitem_t) + e->sizof_element);
+    f = (queitem_t *) list_alloc(e, sizeof(queitem_t) + e->sizof_element);
     if (NULL == f) {
 	DBMS1("%s : mddl_malloc(queitem_t) fail" EOL_CRLF, __func__);
 	status = EAGAIN;
@@ -610,7 +655,7 @@ int mddl_stl_list_insert(mddl_stl_list_t *const self_p,
   out:
     if (status) {
 	if (NULL != f) {
-	    mddl_free(f);
+	    list_free(e, f);
 	}
     }
     return status;
@@ -1,6 +1,14 @@
 #ifndef INC_MDDL_STL_LIST_H
 #define INC_MDDL_STL_LIST_H
 
+#include <stddef.h>
+
+#include "mddl_allocator.h"
+
+typedef struct _mddl_stl_list_attr {
+    const mddl_allocator_t *allocator_p; /* NULLの場合はmddl_malloc系を使用 */
+} mddl_stl_list_attr_t;
+
 typedef struct _mddl_stl_list {
    size_t sizeof_element;
    void *ext;
@@ -11,6 +19,7 @@ extern "C" {
 #endif
 
 int mddl_stl_list_init( mddl_stl_list_t *const self_p, const size_t sizeof_element);
+int mddl_stl_list_init_ex( mddl_stl_list_t *const self_p, const size_t sizof_element, const mddl_stl_list_attr_t *const attr_p);
 int mddl_stl_list_destroy( mddl_stl_list_t *const self_p);
 int mddl_stl_list_push_back( mddl_stl_list_t *const self_p, const void *const el_p, const size_t sizeof_element);
 int mddl_stl_list_push_front( mddl_stl_list_t *const self_p, const void *const el_p, const size_t sizof_element );
@@ -14,7 +14,8 @@
  * @brief 待ち行列ライブラリ STLのqueueクラス互換です。
  *	なのでスレッドセーフではありません。上位層で処理を行ってください。
  *	STL互換と言ってもCの実装です、オブジェクトの破棄の処理はしっかり実装してください
- *  ※ 現状はmallocを乱発します。機会があれば、メモリ管理マネージャを実装します。
+ *  ※ 標準ではエレメント毎にmddl_mallocを呼び出します。init_exでアロケータ(mddl_mempool等)を指定すると、
+ *	インスタンス毎に確保元を切り替えられます。
  */
 
 /* POSIX */
@@ -109,24 +110,25 @@ int mddl_stl_queue_init(mddl_stl_queue_t *const self_p,
 }
 
 /**
- * @fn int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_element, const enum_mddl_stl_queue_implement_type_t implement_type, void *const attr_p)
+ * @fn int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_element, const enum_mddl_stl_queue_implement_type_t implement_type, const mddl_stl_queue_attr_t *const attr_p)
  * @brief stl_queueインスタンスの属性つき初期化
  * @param self_p mddl_stl_stack_t構造体インスタンスポインタ
  * @param sizof_element 1以上のエレメントのサイズ
  * @param implement_type
- * @param attr_p 予約(NULL固定)
+ * @param attr_p 属性(NULLの場合はデフォルト)
+ *	attr_p->allocator_pは実装に使用するslist/deque/listのinit_exにそのまま渡します。
  * @retval 0 成功
  * @retval EAGAIN リソースを確保できなかった
  * @retval EINVAL 引数が不正
  * @retval ENOSYS サポートされていない
  */
-int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_element, const enum_mddl_stl_queue_implement_type_t type, void *const attr_p)
+int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_element, const enum_mddl_stl_queue_implement_type_t type, const mddl_stl_queue_attr_t *const attr_p)
 {
     int result, status;
     mddl_stl_queue_ext_t * __restrict e = NULL;
     const enum_mddl_stl_queue_implement_type_t implement_type = ( type == MDDL_STL_QUEUE_TYPE_IS_DEFAULT ) ? MDDL_STL_QUEUE_TYPE_IS_SLIST : type;
+    const mddl_allocator_t *const alc_p = (NULL == attr_p) ? NULL : attr_p->allocator_p;
 
-    (void)attr_p;
     memset( self_p, 0x0, sizeof(mddl_stl_queue_t));
 
     if(!(sizof_element > 0 )) {
@@ -149,7 +151,11 @@ int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_e
     switch(implement_type) {
     case MDDL_STL_QUEUE_TYPE_IS_SLIST:
 	/* is_slist */
-	result = mddl_stl_slist_init( &e->instance.slist, sizof_element);
+	{
+	    mddl_stl_slist_attr_t attr;
+	    attr.allocator_p = alc_p;
+	    result = mddl_stl_slist_init_ex( &e->instance.slist, sizof_element, &attr);
+	}
 	if(result) {
 	    DBMS1( "%s : mddl_stl_slist_init fail, streror:%s" EOL_CRLF, __func__, strerror(result));
 	    status = result;
@@ -168,7 +174,11 @@ int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_e
 	break;
     case MDDL_STL_QUEUE_TYPE_IS_DEQUE:
 	/* is_deque */
-	result = mddl_stl_deque_init( &e->instance.deque, sizof_element);
+	{
+	    mddl_stl_deque_attr_t attr;
+	    attr.allocator_p = alc_p;
+	    result = mddl_stl_deque_init_ex( &e->instance.deque, sizof_element, &attr);
+	}
 	if(result) {
 	    DBMS1( "%s : mddl_stl_deque_init fail, streror:%s" EOL_CRLF, __func__, strerror(result));
 	    status = result;
@@ -187,7 +197,11 @@ int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_e
 	break;
     case MDDL_STL_QUEUE_TYPE_IS_LIST:
 	/* is_list */
-	result = mddl_stl_list_init( &e->instance.list, sizof_element);
+	{
+	    mddl_stl_list_attr_t attr;
+	    attr.allocator_p = alc_p;
+	    result = mddl_stl_list_init_ex( &e->instance.list, sizof_element, &attr);
+	}
 	if(result) {
 	    DBMS1( "%s : mddl_stl_list_init fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
 	    status = result;
@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 
+#include "mddl_allocator.h"
+
 typedef enum _mddl_stl_queue_implement_type {
     MDDL_STL_QUEUE_TYPE_IS_DEFAULT = 11,
     MDDL_STL_QUEUE_TYPE_IS_SLIST,
@@ -11,6 +13,10 @@ typedef enum _mddl_stl_queue_implement_type {
     MDDL_STL_QUEUE_TYPE_IS_OTHERS
 } enum_mddl_stl_queue_implement_type_t;
 
+typedef struct _mddl_stl_queue_attr {
+    const mddl_allocator_t *allocator_p; /* NULLの場合はmddl_malloc系を使用 */
+} mddl_stl_queue_attr_t;
+
 typedef struct _mddl_stl_queue {
    size_t sizof_element;
    void *ext;
@@ -21,7 +27,7 @@ extern "C" {
 #endif
 
 int mddl_stl_queue_init( mddl_stl_queue_t *const self_p, const size_t sizof_element);
-int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_element, const enum_mddl_stl_queue_implement_type_t implement_type, void *const attr_p);
+int mddl_stl_queue_init_ex( mddl_stl_queue_t *const self_p, const size_t sizof_element, const enum_mddl_stl_queue_implement_type_t implement_type, const mddl_stl_queue_attr_t *const attr_p);
 
 int mddl_stl_queue_destroy( mddl_stl_queue_t *const self_p);
 int mddl_stl_queue_push( mddl_stl_queue_t *const self_p, const void *const el_p, const size_t sizof_element);
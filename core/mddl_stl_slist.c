@@ -14,7 +14,8 @@
  * @brief 単方向待ち行列ライブラリ STLのslist(SGI)クラス互換です。
  *	なのでスレッドセーフではありません。上位層で処理を行ってください。
  *	STL互換と言ってもCの実装です、オブジェクトの破棄の処理はしっかり実装してください
- *  ※ 現状はmallocを乱発します。機会があれば、メモリ管理マネージャを実装します。
+ *  ※ 標準ではエレメント毎にmddl_mallocを呼び出します。init_exでアロケータ(mddl_mempool等)を指定すると、
+ *	インスタンス毎に確保元を切り替えられます。
  */
 
 /* POSIX */
@@ -55,12 +56,32 @@ typedef struct _mddl_stl_slist_ext {
     fifoitem_t *r_p, *w_p;	/* カレント参照のポインタ */
     size_t sizof_element;
     size_t cnt;
+    mddl_allocator_t alc;
     fifoitem_t base;		/* 配列0の構造体があるので必ず最後にする */
 } mddl_stl_slist_ext_t;
 
 #define get_stl_slist_ext(s) (mddl_stl_slist_ext_t*)((s)->ext)
 #define get_const_stl_slist_ext(s) (const mddl_stl_slist_ext_t*)((s)->ext)
 
+#define slist_alloc(e, z) (e)->alc.alloc((e)->alc.ctx, (z))
+#define slist_free(e, p) (e)->alc.free((e)->alc.ctx, (p))
+
+static void *slist_default_alloc(void *const ctx, const size_t size)
+{
+    (void)ctx;
+    return mddl_malloc(size);
+}
+
+static void slist_default_free(void *const ctx, void *const ptr)
+{
+    (void)ctx;
+    mddl_free(ptr);
+}
+
+static const mddl_allocator_t slist_default_allocator = {
+    slist_default_alloc, NULL, slist_default_free, NULL
+};
+
 static fifoitem_t *slist_get_foward_element_ptr( const mddl_stl_slist_ext_t *const e, void * const element_ptr);
 
 /**
@@ -102,9 +123,32 @@ static fifoitem_t *slist_get_foward_element_ptr( const mddl_stl_slist_ext_t *con
 int mddl_stl_slist_init(mddl_stl_slist_t *const self_p,
 			   const size_t sizof_element)
 {
+    return mddl_stl_slist_init_ex(self_p, sizof_element, NULL);
+}
+
+/**
+ * @fn int mddl_stl_slist_init_ex( mddl_stl_slist_t *const self_p, const size_t sizof_element, const mddl_stl_slist_attr_t *const attr_p)
+ * @brief 属性を指定してキューオブジェクトを初期化します
+ *	attr_p->allocator_pを指定すると、エレメントのノードをそのアロケータから確保します。
+ *	エレメントのノードは固定サイズなので、reallocは不要(NULL可)です。管理情報はmddl_mallocから確保します。
+ * @param self_p mddl_stl_slist_t構造体インスタンスポインタ
+ * @param sizof_element 1以上のエレメントのサイズ
+ * @param attr_p 属性(NULLの場合はmddl_stl_slist_init()と同じ)
+ * @retval 0 成功
+ * @retval EINVAL アロケータの関数が設定されていない
+ * @retval EAGAIN リソースの獲得に失敗
+ */
+int mddl_stl_slist_init_ex( mddl_stl_slist_t *const self_p, const size_t sizof_element, const mddl_stl_slist_attr_t *const attr_p)
+{
+    const mddl_allocator_t *const alc_p = ((NULL == attr_p) || (NULL == attr_p->allocator_p)) ?
+	&slist_default_allocator : attr_p->allocator_p;
     mddl_stl_slist_ext_t *e = NULL;
     memset(self_p, 0x0, sizeof(mddl_stl_slist_t));
 
+    if( (NULL == alc_p->alloc) || (NULL == alc_p->free) ) {
+	return EINVAL;
+    }
+
     e = (mddl_stl_slist_ext_t *)
 	mddl_malloc(sizeof(mddl_stl_slist_ext_t));
     if (NULL == e) {
@@ -117,6 +161,7 @@ int mddl_stl_slist_init(mddl_stl_slist_t *const self_p,
     self_p->sizof_element = e->sizof_element = sizof_element;
 
     e->r_p = e->w_p = &e->base;
+    e->alc = *alc_p;
 
     return 0;
 }
@@ -142,7 +187,7 @@ int mddl_stl_slist_destroy(mddl_stl_slist_t *const self_p)
 
     /* 最後のエレメントがbaseで無ければ削除 */
     if (e->r_p != &e->base) {
-	mddl_free(e->r_p);
+	slist_free(e, e->r_p);
 	e->r_p = NULL;
     }
 
@@ -174,7 +219,7 @@ int mddl_stl_slist_push(mddl_stl_slist_t *const self_p, const void *const el_p,
 	return EINVAL;
     }
 
-    f = (fifoitem_t *)mddl_malloc(sizeof(fifoitem_t) + e->sizof_element);
+    f = (fifoitem_t *)slist_alloc(e, sizeof(fifoitem_t) + e->sizof_element);
     if (NULL == f) {
 	DBMS1(
 	      "%s : mddl_malloc(fifoitem_t) fail" EOL_CRLF, __func__);
@@ -196,7 +241,7 @@ int mddl_stl_slist_push(mddl_stl_slist_t *const self_p, const void *const el_p,
   out:
     if (status) {
 	if (NULL != f) {
-	    mddl_free(f);
+	    slist_free(e, f);
 	}
     }
     return status;
@@ -229,12 +274,12 @@ int mddl_stl_slist_pop(mddl_stl_slist_t *const self_p)
     --(e->cnt);
 
     if (tmp != &e->base) {
-	mddl_free(tmp);
+	slist_free(e, tmp);
     }
 
     if (e->cnt == 0) {
 	if (e->r_p != &e->base) {
-	    mddl_free(e->r_p);
+	    slist_free(e, e->r_p);
 	}
 	e->r_p = e->w_p = &e->base;
     }
@@ -454,7 +499,7 @@ int mddl_stl_slist_insert_at( mddl_stl_slist_t *const self_p, const size_t no, v
 	return EFAULT;
     }
 
-    f = (fifoitem_t *) mddl_malloc(sizeof(fifoitem_t) + e->sizof_element);
+    f = (fifoitem_t *) slist_alloc(e, sizeof(fifoitem_t) + e->sizof_element);
     if (NULL == f) {
 	DBMS1(
 	      "%s : mddl_malloc(fifoitem_t) fail" EOL_CRLF, __func__);
@@ -517,12 +562,12 @@ int mddl_stl_slist_erase_at( mddl_stl_slist_t *const self_p, const size_t no)
 
 
     if (tmp != &e->base) {
-	mddl_free(tmp);
+	slist_free(e, tmp);
     }
 
     if (e->cnt == 0) {
 	if (e->r_p != &e->base) {
-	    mddl_free(e->r_p);
+	    slist_free(e, e->r_p);
 	}
 	e->r_p = e->w_p = &e->base;
     }
@@ -5,6 +5,12 @@
 
 #include <stddef.h>
 
+#include "mddl_allocator.h"
+
+typedef struct _mddl_stl_slist_attr {
+    const mddl_allocator_t *allocator_p; /* NULLの場合はmddl_malloc系を使用 */
+} mddl_stl_slist_attr_t;
+
 typedef struct _mddl_stl_slist {
    size_t sizof_element;
    void *ext;
@@ -15,6 +21,7 @@ extern "C" {
 #endif
 
 int mddl_stl_slist_init( mddl_stl_slist_t *const self_p, const size_t sizof_element);
+int mddl_stl_slist_init_ex( mddl_stl_slist_t *const self_p, const size_t sizof_element, const mddl_stl_slist_attr_t *const attr_p);
 int mddl_stl_slist_destroy( mddl_stl_slist_t *const self_p);
 int mddl_stl_slist_push( mddl_stl_slist_t *const self_p, const void *const el_p, const size_t sizof_element);
 int mddl_stl_slist_pop( mddl_stl_slist_t *const self_p);
@@ -17,6 +17,7 @@
  */
 
 /* CRL */
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,17 +67,54 @@ typedef union _mddl_stl_vector_stat {
 } mddl_stl_vector_stat_t;
 
 typedef struct _mddl_stl_vector_ext {
+    /* 先頭はmddl_stl_vector_ext_head_tと同じ並びにする */
     void *buf;
     size_t reserved_bytes;
     size_t num_elements;
     size_t sizof_element;
 
+    mddl_allocator_t alc;
+    mddl_stl_vector_growth_t growth;
     mddl_stl_vector_stat_t stat;
 } mddl_stl_vector_ext_t;
 
+/* mddl_stl_vector_ext_head_tと並びが異なる場合はコンパイルエラーにする */
+typedef char mddl_stl_vector_ext_head_check_t[
+    ((offsetof(mddl_stl_vector_ext_t, buf) == offsetof(mddl_stl_vector_ext_head_t, buf))
+    && (offsetof(mddl_stl_vector_ext_t, reserved_bytes) == offsetof(mddl_stl_vector_ext_head_t, reserved_bytes))
+    && (offsetof(mddl_stl_vector_ext_t, num_elements) == offsetof(mddl_stl_vector_ext_head_t, num_elements))
+    && (offsetof(mddl_stl_vector_ext_t, sizof_element) == offsetof(mddl_stl_vector_ext_head_t, sizof_element))) ? 1 : -1];
+
 #define get_vector_ext(s) (mddl_stl_vector_ext_t*)((s)->ext)
 #define get_const_vector_ext(s) (const mddl_stl_vector_ext_t*)((s)->ext)
 
+#define vector_alloc(e, z) (e)->alc.alloc((e)->alc.ctx, (z))
+#define vector_realloc(e, p, z) (e)->alc.realloc((e)->alc.ctx, (p), (z))
+#define vector_free(e, p) (e)->alc.free((e)->alc.ctx, (p))
+
+#define VECTOR_DEFAULT_GROWTH_PERCENT 200
+
+static void *vector_default_alloc(void *const ctx, const size_t size)
+{
+    (void)ctx;
+    return mddl_malloc(size);
+}
+
+static void *vector_default_realloc(void *const ctx, void *const ptr, const size_t size)
+{
+    (void)ctx;
+    return mddl_realloc(ptr, size);
+}
+
+static void vector_default_free(void *const ctx, void *const ptr)
+{
+    (void)ctx;
+    mddl_free(ptr);
+}
+
+static const mddl_allocator_t vector_default_allocator = {
+    vector_default_alloc, vector_default_realloc, vector_default_free, NULL
+};
 
 
 /**
@@ -90,9 +128,34 @@ typedef struct _mddl_stl_vector_ext {
  */
 int mddl_stl_vector_init( mddl_stl_vector_t *const self_p, const size_t sizof_element)
 {
+    return mddl_stl_vector_init_ex(self_p, sizof_element, NULL);
+}
+
+/**
+ * @fn int mddl_stl_vector_init_ex( mddl_stl_vector_t *const self_p, const size_t sizof_element, const mddl_stl_vector_attr_t *const attr_p)
+ * @brief 属性を指定してvectorオブジェクトを初期化します。
+ *	attr_p->allocator_pを指定すると、要素のバッファをそのアロケータから確保します。
+ *	管理情報はmddl_mallocから確保するので、固定サイズのプール等も指定できます。
+ *	アロケータはインスタンスにコピーされるので、呼び出し後にattr_pを破棄しても構いません。
+ *	attr_p->growthで容量不足時の拡張倍率と1回の拡張の上限を指定できます(0クリアで2倍)。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param sizof_element 要素サイズ
+ * @param attr_p 属性(NULLの場合はmddl_stl_vector_init()と同じ)
+ * @retval 0 成功
+ * @retval EAGAIN リソース獲得に失敗
+ * @retval EINVAL アロケータの関数が設定されていない
+ */
+int mddl_stl_vector_init_ex( mddl_stl_vector_t *const self_p, const size_t sizof_element, const mddl_stl_vector_attr_t *const attr_p)
+{
+    const mddl_allocator_t *const alc_p = ((NULL == attr_p) || (NULL == attr_p->allocator_p)) ?
+	&vector_default_allocator : attr_p->allocator_p;
     mddl_stl_vector_ext_t *e = NULL;
     memset(self_p, 0x0, sizeof(mddl_stl_vector_t));
 
+    if( (NULL == alc_p->alloc) || (NULL == alc_p->realloc) || (NULL == alc_p->free) ) {
+	return EINVAL;
+    }
+
     e = (mddl_stl_vector_ext_t *)
 	mddl_malloc(sizeof(mddl_stl_vector_ext_t));
     if (NULL == e) {
@@ -104,6 +167,13 @@ int mddl_stl_vector_init( mddl_stl_vector_t *const self_p, const size_t sizof_el
     e->buf = NULL;
     e->reserved_bytes = 0;
     e->num_elements = 0;
+    e->alc = *alc_p;
+    if( NULL != attr_p ) {
+	e->growth = attr_p->growth;
+    }
+    if( 0 == e->growth.factor_percent ) {
+	e->growth.factor_percent = VECTOR_DEFAULT_GROWTH_PERCENT;
+    }
     self_p->sizof_element = e->sizof_element = sizof_element;
 
     self_p->ext = e;
@@ -127,7 +197,7 @@ int mddl_stl_vector_destroy(mddl_stl_vector_t *const self_p)
     }
 
     if (NULL != e->buf) {
-	mddl_free(e->buf);
+	vector_free(e, e->buf);
 	e->buf = NULL;
     }
 
@@ -153,7 +223,7 @@ static int resize_buffer(mddl_stl_vector_ext_t *const e,
     void *new_buf = NULL;
 
     if (e->reserved_bytes < new_reserve) {
-	new_buf = mddl_realloc(e->buf, new_reserve);
+	new_buf = vector_realloc(e, e->buf, new_reserve);
 	if (NULL == new_buf) {
 	    return EAGAIN;
 	}
@@ -190,9 +260,61 @@ static int resize_buffer(mddl_stl_vector_ext_t *const e,
     return 0;
 }
 
+/**
+ * @fn static int grow_buffer( mddl_stl_vector_ext_t *const e, const size_t num_elements)
+ * @brief num_elements個の要素を格納できるように、拡張方針に従って容量を増やします
+ *	容量が足りている場合は何もしません。要素数は変更しません。
+ * @param e mddl_stl_vector_ext_t構造体ポインタ
+ * @param num_elements 必要な要素数
+ * @retval 0 成功
+ * @retval EAGAIN リソース不足(固定メモリの容量不足を含む)
+ */
+static int grow_buffer(mddl_stl_vector_ext_t *const e, const size_t num_elements)
+{
+    const size_t cap = e->reserved_bytes / e->sizof_element;
+    size_t new_cap, add;
+    void *new_buf;
+
+    if( cap >= num_elements ) {
+	return 0;
+    } else if( e->stat.f.mem_fixed ) {
+	return EAGAIN;
+    } else if( num_elements > (SIZE_MAX / e->sizof_element) ) {
+	return EAGAIN;
+    }
+
+    /* 倍率分の増加量を求める(cap * percentの桁あふれを避ける) */
+    new_cap = num_elements;
+    if( e->growth.factor_percent > 100 ) {
+	const size_t pct = e->growth.factor_percent - 100;
+	add = (cap / 100) * pct + ((cap % 100) * pct) / 100;
+	if( (0 != e->growth.max_grow_elements) && (add > e->growth.max_grow_elements) ) {
+	    add = e->growth.max_grow_elements;
+	}
+	if( (add <= ((SIZE_MAX / e->sizof_element) - cap)) && ((cap + add) > new_cap) ) {
+	    new_cap = cap + add;
+	}
+    }
+
+    new_buf = vector_realloc(e, e->buf, new_cap * e->sizof_element);
+    if( (NULL == new_buf) && (new_cap > num_elements) ) {
+	/* 容量の限られたヒープでは必要な分だけを再度試みる */
+	new_cap = num_elements;
+	new_buf = vector_realloc(e, e->buf, new_cap * e->sizof_element);
+    }
+    if( NULL == new_buf ) {
+	return EAGAIN;
+    }
+    e->buf = new_buf;
+    e->reserved_bytes = new_cap * e->sizof_element;
+
+    return 0;
+}
+
 /**
  * @fn int mddl_stl_vector_push_back( mddl_stl_vector_t *const self_p, const void *const el_p, const size_t sizof_element)
  * @brief 末尾に要素を追加します
+ *	容量が足りない場合は拡張方針に従って拡張するので、連続した追加の再割り当ては償却O(1)です。
  * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
  * @param el_p 追加する要素のポインタ
  * @param sizof_element 要素サイズ
@@ -217,6 +339,10 @@ int mddl_stl_vector_push_back(mddl_stl_vector_t *const self_p,
 	return EINVAL;
     }
 
+    result = grow_buffer(e, e->num_elements + 1);
+    if (result) {
+	return result;
+    }
     result = resize_buffer(e, e->num_elements + 1, el_p);
     if (result) {
 	return result;
@@ -225,6 +351,70 @@ int mddl_stl_vector_push_back(mddl_stl_vector_t *const self_p,
     return 0;
 }
 
+/**
+ * @fn void *mddl_stl_vector_emplace_back( mddl_stl_vector_t *const self_p)
+ * @brief 末尾に要素を1つ追加し、その格納領域を返します
+ *	領域は初期化されていないので、呼び出し側で直接要素を構築してください。
+ *	一時領域からのコピーが無いので、大きな要素の追加に向きます。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @retval NULL 失敗(errnoにEAGAIN:リソース不足を設定)
+ * @retval NULL以外 追加した要素のポインタ
+ */
+void *mddl_stl_vector_emplace_back(mddl_stl_vector_t *const self_p)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+    int result;
+
+    result = grow_buffer(e, e->num_elements + 1);
+    if (result) {
+	errno = result;
+	return NULL;
+    }
+    ++(e->num_elements);
+
+    return (void *) ((uint8_t *) e->buf + ((e->num_elements - 1) * e->sizof_element));
+}
+
+/**
+ * @fn void *mddl_stl_vector_emplace_at( mddl_stl_vector_t *const self_p, const size_t num)
+ * @brief num番目の位置に要素を1つ挿入し、その格納領域を返します
+ *	後方の要素は1つずつ後ろに移動します。領域は初期化されていません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param num 要素番号(要素数と同じ場合は末尾に追加)
+ * @retval NULL 失敗(errnoにENOENT:不正な要素番号、EPERM:固定メモリ、EAGAIN:リソース不足を設定)
+ * @retval NULL以外 挿入した要素のポインタ
+ */
+void *mddl_stl_vector_emplace_at(mddl_stl_vector_t *const self_p, const size_t num)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+    uint8_t *ptr;
+    int result;
+
+    if( e->stat.f.mem_fixed ) {
+	errno = EPERM;
+	return NULL;
+    } else if( num > e->num_elements ) {
+	errno = ENOENT;
+	return NULL;
+    }
+
+    result = grow_buffer(e, e->num_elements + 1);
+    if (result) {
+	errno = result;
+	return NULL;
+    }
+
+    ptr = (uint8_t *) e->buf + (num * e->sizof_element);
+    if( num < e->num_elements ) {
+	memmove( ptr + e->sizof_element, ptr, (e->num_elements - num) * e->sizof_element);
+    }
+    ++(e->num_elements);
+
+    return (void *) ptr;
+}
+
 /**
  * @fn int mddl_stl_vector_pop_back( mddl_stl_vector_t *const self_p)
  * @brief 末尾の要素を削除します
@@ -349,6 +539,53 @@ void *mddl_stl_vector_ptr_at(mddl_stl_vector_t *const self_p, const size_t num)
     return NULL;
 }
 
+/**
+ * @fn void *mddl_stl_vector_data( mddl_stl_vector_t *const self_p, size_t *const num_p)
+ * @brief 要素を格納している連続した領域の先頭を得る
+ *	要素をコピーせずに直接読み書きできます。ポインタは容量の拡張・縮小で無効になります。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param num_p 要素数を格納するポインタ(NULL可)
+ * @retval NULL 要素が無い
+ * @retval NULL以外 先頭要素のポインタ
+ */
+void *mddl_stl_vector_data(mddl_stl_vector_t *const self_p, size_t *const num_p)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+
+    if( NULL != num_p ) {
+	*num_p = e->num_elements;
+    }
+
+    return (e->num_elements) ? e->buf : NULL;
+}
+
+/**
+ * @fn void *mddl_stl_vector_span( mddl_stl_vector_t *const self_p, const size_t first, const size_t count, size_t *const bytes_p)
+ * @brief first番目からcount個の要素の連続した領域を得る
+ *	ポインタは容量の拡張・縮小で無効になります。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param first 先頭の要素番号
+ * @param count 要素数
+ * @param bytes_p 領域のバイト数を格納するポインタ(NULL可)
+ * @retval NULL 範囲が要素数を超えている、またはcountが0
+ * @retval NULL以外 first番目の要素のポインタ
+ */
+void *mddl_stl_vector_span(mddl_stl_vector_t *const self_p, const size_t first, const size_t count, size_t *const bytes_p)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+
+    if( (0 == count) || (first >= e->num_elements) || (count > (e->num_elements - first)) ) {
+	return NULL;
+    }
+    if( NULL != bytes_p ) {
+	*bytes_p = count * e->sizof_element;
+    }
+
+    return (void *) ((uint8_t *) e->buf + (first * e->sizof_element));
+}
+
 /**
  * @fn int mddl_stl_vector_is_empty( mddl_stl_vector_t *const self_p)
  * @brief コンテナに要素が空かどうかを返す
@@ -401,7 +638,7 @@ int mddl_stl_vector_clear(mddl_stl_vector_t *const self_p)
     }
 
     if (NULL != e->buf) {
-	mddl_free(e->buf);
+	vector_free(e, e->buf);
 	e->buf = NULL;
     }
     e->num_elements = 0;
@@ -505,9 +742,9 @@ int mddl_stl_vector_insert( mddl_stl_vector_t *const self_p, const size_t num, c
 	return ENOENT;
     }
 
-    result = resize_buffer(e, e->num_elements + 1, NULL);
+    result = grow_buffer(e, e->num_elements + 1);
     if(result) {
-	DBMS1( "%s : resize_buffer fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
+	DBMS1( "%s : grow_buffer fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
 	return result;
     }
 
@@ -565,6 +802,222 @@ int mddl_stl_vector_remove_at( mddl_stl_vector_t *const self_p, const size_t num
     return 0;
 }
 
+/**
+ * @fn static int src_in_buffer( const mddl_stl_vector_ext_t *const e, const void *const src, size_t *const ofs_p)
+ * @brief srcが格納済みの要素を指しているかを調べます
+ *	バッファは拡張で移動することがあるので、その場合はバッファ先頭からの位置で扱います。
+ * @param e mddl_stl_vector_ext_t構造体ポインタ
+ * @param src 調べるポインタ
+ * @param ofs_p バッファ先頭からのバイト位置を格納するポインタ
+ * @retval 0以外 格納済みの要素を指している
+ * @retval 0 バッファの外
+ */
+static int src_in_buffer(const mddl_stl_vector_ext_t *const e, const void *const src, size_t *const ofs_p)
+{
+    const uintptr_t top = (uintptr_t)e->buf;
+
+    if( (NULL == e->buf) || ((uintptr_t)src < top)
+	    || ((uintptr_t)src >= (top + (e->num_elements * e->sizof_element))) ) {
+	return 0;
+    }
+    *ofs_p = (size_t)((uintptr_t)src - top);
+
+    return 1;
+}
+
+/**
+ * @fn int mddl_stl_vector_append_n( mddl_stl_vector_t *const self_p, const void *const src, const size_t n, const size_t sizof_element)
+ * @brief 末尾にn個の要素をまとめて追加します
+ *	拡張は最大1回、コピーは1回です。srcは同じvectorの要素を指していても構いません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param src 追加する要素の配列
+ * @param n 要素数
+ * @param sizof_element 要素サイズ
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval EAGAIN リソース不足
+ */
+int mddl_stl_vector_append_n( mddl_stl_vector_t *const self_p, const void *const src, const size_t n, const size_t sizof_element)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+    size_t ofs = 0;
+    int inside, result;
+
+    if( NULL == self_p ) {
+	return EINVAL;
+    } else if( sizof_element != e->sizof_element ) {
+	return EINVAL;
+    } else if( 0 == n ) {
+	return 0;
+    } else if( (NULL == src) || (n > (SIZE_MAX - e->num_elements)) ) {
+	return EINVAL;
+    }
+    inside = src_in_buffer(e, src, &ofs);
+
+    result = grow_buffer(e, e->num_elements + n);
+    if( result ) {
+	return result;
+    }
+    memcpy( (uint8_t*)e->buf + (e->num_elements * e->sizof_element),
+	    (inside) ? (const void*)((uint8_t*)e->buf + ofs) : src, n * e->sizof_element);
+    e->num_elements += n;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_stl_vector_insert_range( mddl_stl_vector_t *const self_p, const size_t pos, const void *const src, const size_t n, const size_t sizof_element)
+ * @brief pos番目の位置にn個の要素をまとめて挿入します
+ *	拡張は最大1回、後方の要素の移動は1回です。srcは同じvectorの要素を指していても構いません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param pos 挿入する要素番号(要素数と同じ場合は末尾に追加)
+ * @param src 挿入する要素の配列
+ * @param n 要素数
+ * @param sizof_element 要素サイズ
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval ENOENT 不正な要素番号
+ * @retval EPERM 関数実行の不許可(固定メモリ)
+ * @retval EAGAIN リソース不足
+ */
+int mddl_stl_vector_insert_range( mddl_stl_vector_t *const self_p, const size_t pos, const void *const src, const size_t n, const size_t sizof_element)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+    size_t ofs = 0, len, at;
+    uint8_t *ptr;
+    int inside, result;
+
+    if( NULL == self_p ) {
+	return EINVAL;
+    } else if( e->stat.f.mem_fixed ) {
+	return EPERM;
+    } else if( sizof_element != e->sizof_element ) {
+	return EINVAL;
+    } else if( pos > e->num_elements ) {
+	return ENOENT;
+    } else if( 0 == n ) {
+	return 0;
+    } else if( (NULL == src) || (n > (SIZE_MAX - e->num_elements)) ) {
+	return EINVAL;
+    }
+    inside = src_in_buffer(e, src, &ofs);
+
+    result = grow_buffer(e, e->num_elements + n);
+    if( result ) {
+	DBMS1( "%s : grow_buffer fail, strerror:%s" EOL_CRLF, __func__, strerror(result));
+	return result;
+    }
+
+    len = n * e->sizof_element;
+    at = pos * e->sizof_element;
+    ptr = (uint8_t*)e->buf + at;
+    if( pos < e->num_elements ) {
+	memmove( ptr + len, ptr, (e->num_elements - pos) * e->sizof_element);
+    }
+
+    if( !inside ) {
+	memcpy( ptr, src, len);
+    } else if( (ofs + len) <= at ) {
+	/* 挿入位置より前の要素は移動していない */
+	memcpy( ptr, (uint8_t*)e->buf + ofs, len);
+    } else if( ofs >= at ) {
+	/* 挿入位置以降の要素はlenだけ後ろに移動している */
+	memcpy( ptr, (uint8_t*)e->buf + ofs + len, len);
+    } else {
+	/* 挿入位置をまたぐ場合は前後に分けてコピーする */
+	const size_t head = at - ofs;
+	memcpy( ptr, (uint8_t*)e->buf + ofs, head);
+	memcpy( ptr + head, ptr + len, len - head);
+    }
+    e->num_elements += n;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_stl_vector_erase_range( mddl_stl_vector_t *const self_p, const size_t first, const size_t last)
+ * @brief [first, last)の要素をまとめて消去します
+ *	後方の要素の移動は1回です。容量は変更しません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param first 消去する先頭の要素番号
+ * @param last 消去する末尾の次の要素番号
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval ENOENT 不正な要素番号
+ * @retval EPERM 関数実行の不許可(固定メモリ)
+ */
+int mddl_stl_vector_erase_range( mddl_stl_vector_t *const self_p, const size_t first, const size_t last)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+    uint8_t *ptr;
+
+    if( NULL == self_p ) {
+	return EINVAL;
+    } else if( e->stat.f.mem_fixed ) {
+	return EPERM;
+    } else if( (first > last) || (last > e->num_elements) ) {
+	return ENOENT;
+    } else if( first == last ) {
+	return 0;
+    }
+
+    ptr = (uint8_t*)e->buf + (first * e->sizof_element);
+    if( last < e->num_elements ) {
+	memmove( ptr, (uint8_t*)e->buf + (last * e->sizof_element), (e->num_elements - last) * e->sizof_element);
+    }
+    e->num_elements -= (last - first);
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_stl_vector_assign( mddl_stl_vector_t *const self_p, const void *const src, const size_t n, const size_t sizof_element)
+ * @brief 要素をsrcのn個の要素で置き換えます
+ *	拡張は最大1回、コピーは1回です。srcは同じvectorの要素を指していても構いません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param src 要素の配列
+ * @param n 要素数(0の場合は全要素を消去。容量は変更しません)
+ * @param sizof_element 要素サイズ
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval EAGAIN リソース不足
+ */
+int mddl_stl_vector_assign( mddl_stl_vector_t *const self_p, const void *const src, const size_t n, const size_t sizof_element)
+{
+    mddl_stl_vector_ext_t *const e =
+	get_vector_ext(self_p);
+    size_t ofs = 0;
+    int result;
+
+    if( NULL == self_p ) {
+	return EINVAL;
+    } else if( sizof_element != e->sizof_element ) {
+	return EINVAL;
+    } else if( (0 != n) && (NULL == src) ) {
+	return EINVAL;
+    }
+
+    if( (0 != n) && src_in_buffer(e, src, &ofs) ) {
+	/* 自身の一部で置き換える場合は拡張不要 */
+	if( (e->num_elements * e->sizof_element - ofs) < (n * e->sizof_element) ) {
+	    return EINVAL;
+	}
+	memmove( e->buf, (uint8_t*)e->buf + ofs, n * e->sizof_element);
+    } else if( 0 != n ) {
+	result = grow_buffer(e, n);
+	if( result ) {
+	    return result;
+	}
+	memcpy( e->buf, src, n * e->sizof_element);
+    }
+    e->num_elements = n;
+
+    return 0;
+}
+
 /**
  * @fn int mddl_stl_vector_get_element_at( mddl_stl_vector_t *const self_p, const size_t num, void *const el_p, const size_t sizof_element)
  * @brief 保存された要素を返します
@@ -635,30 +1088,26 @@ int mddl_stl_vector_overwrite_element_at( mddl_stl_vector_t *const self_p, const
  * @param at2 要素2
  * @retval 0 成功
  * @retval EINVAL 不正な要素番号
- * @retval EAGAIN リソースを獲得できなかった
  **/
 int mddl_stl_vector_element_swap_at( mddl_stl_vector_t *const self_p, const size_t at1, const size_t at2)
 {
     mddl_stl_vector_ext_t *const e =
 	get_vector_ext(self_p);
-    void *ptr1 = mddl_stl_vector_ptr_at(self_p, at1);
-    void *ptr2 = mddl_stl_vector_ptr_at(self_p, at2);
-    void *buf;
+    uint8_t *ptr1 = (uint8_t*)mddl_stl_vector_ptr_at(self_p, at1);
+    uint8_t *ptr2 = (uint8_t*)mddl_stl_vector_ptr_at(self_p, at2);
+    uint8_t buf[64];
+    size_t ofs, len;
 
     if((NULL == self_p) || (NULL == ptr1) || (NULL == ptr2)) {
 	return EINVAL;
     }
 
-    buf = mddl_malloc( e->sizof_element );
-    if( NULL == buf ) {
-	return EAGAIN;
-    }
-    memcpy( buf, ptr1, e->sizof_element);
-    memcpy( ptr1, ptr2, e->sizof_element);
-    memcpy( ptr2, buf, e->sizof_element);
-
-    if( NULL != buf ) {
-	mddl_free(buf);
+    /* スタック上の一時領域で分割して入れ替える(アロケータは呼ばない) */
+    for( ofs=0; ofs < e->sizof_element; ofs += len ) {
+	len = ((e->sizof_element - ofs) < sizeof(buf)) ? (e->sizof_element - ofs) : sizeof(buf);
+	memcpy( buf, ptr1 + ofs, len);
+	memcpy( ptr1 + ofs, ptr2 + ofs, len);
+	memcpy( ptr2 + ofs, buf, len);
     }
 
     return 0;
@@ -691,12 +1140,12 @@ int mddl_stl_vector_shrink( mddl_stl_vector_t *const self_p, const size_t num_el
 
     if( num_elements == 0 ) {
 	if( NULL != e->buf ) {
-	    mddl_free(e->buf);
+	    vector_free(e, e->buf);
 	    e->buf = NULL;
 	}
 	e->reserved_bytes = 0;
     } else {
-	void *new_buf = mddl_realloc(e->buf, new_reserve);
+	void *new_buf = vector_realloc(e, e->buf, new_reserve);
 	if (NULL == new_buf) {
 	    return EAGAIN;
 	}
@@ -6,21 +6,53 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "mddl_allocator.h"
+
+/**
+ * @brief push_back/insertで容量が足りない場合の拡張方針です
+ *	容量は現在の容量のfactor_percent[%]まで増やします(必要数より少ない場合は必要数)。
+ *	拡張に失敗した場合は必要数だけの拡張をもう一度試みます。
+ */
+typedef struct _mddl_stl_vector_growth {
+    unsigned int factor_percent; /* 拡張倍率[%] 0の場合は200(2倍)、100以下の場合は必要数だけ拡張 */
+    size_t max_grow_elements;	/* 1回に増やす最大要素数(0の場合は制限無し) */
+} mddl_stl_vector_growth_t;
+
+typedef struct _mddl_stl_vector_attr {
+    const mddl_allocator_t *allocator_p; /* NULLの場合はmddl_malloc系を使用 */
+    mddl_stl_vector_growth_t growth; /* 0クリアの場合は2倍で拡張 */
+} mddl_stl_vector_attr_t;
+
 typedef struct _mddl_stl_vector {
     size_t sizof_element;
     void *ext;
 } mddl_stl_vector_t;
 
+/**
+ * @brief 管理情報(ext)の先頭部分です
+ *	C++ラッパー(mddl_stl_cxx.h)が要素の参照と末尾への追加をインラインで行うために公開しています。
+ *	C言語からはAPIを使ってください。
+ */
+typedef struct _mddl_stl_vector_ext_head {
+    void *buf;
+    size_t reserved_bytes;
+    size_t num_elements;
+    size_t sizof_element;
+} mddl_stl_vector_ext_head_t;
+
 #if defined (__cplusplus )
 extern "C" {
 #endif
 
 int mddl_stl_vector_init( mddl_stl_vector_t *const self_p, const size_t sizof_element);
+int mddl_stl_vector_init_ex( mddl_stl_vector_t *const self_p, const size_t sizof_element, const mddl_stl_vector_attr_t *const attr_p);
 int mddl_stl_vector_attach_memory_fixed( mddl_stl_vector_t *const self_p, void *const mem_ptr, const size_t len);
 
 int mddl_stl_vector_destroy( mddl_stl_vector_t *const self_p);
 
 int mddl_stl_vector_push_back( mddl_stl_vector_t *const self_p, const void *const el_p, const size_t sizof_element);
+void *mddl_stl_vector_emplace_back( mddl_stl_vector_t *const self_p);
+void *mddl_stl_vector_emplace_at( mddl_stl_vector_t *const self_p, const size_t num);
 int mddl_stl_vector_pop_back( mddl_stl_vector_t *const self_p);
 
 int mddl_stl_vector_resize( mddl_stl_vector_t *const self_p, const size_t num_elements, const void *const el_p, const size_t sizof_element);
@@ -29,6 +61,8 @@ int mddl_stl_vector_clear( mddl_stl_vector_t *const self_p);
 
 size_t mddl_stl_vector_capacity( mddl_stl_vector_t *const self_p);
 void *mddl_stl_vector_ptr_at( mddl_stl_vector_t *const self_p, const size_t num);
+void *mddl_stl_vector_data( mddl_stl_vector_t *const self_p, size_t *const num_p);
+void *mddl_stl_vector_span( mddl_stl_vector_t *const self_p, const size_t first, const size_t count, size_t *const bytes_p);
 int mddl_stl_vector_is_empty( mddl_stl_vector_t *const self_p);
 
 size_t mddl_stl_vector_size( mddl_stl_vector_t *const self_p);
@@ -41,6 +75,11 @@ int mddl_stl_vector_insert( mddl_stl_vector_t *const self_p, const size_t num, c
 
 int mddl_stl_vector_remove_at( mddl_stl_vector_t *const self_p, const size_t num);
 
+int mddl_stl_vector_append_n( mddl_stl_vector_t *const self_p, const void *const src, const size_t n, const size_t sizof_element);
+int mddl_stl_vector_insert_range( mddl_stl_vector_t *const self_p, const size_t pos, const void *const src, const size_t n, const size_t sizof_element);
+int mddl_stl_vector_erase_range( mddl_stl_vector_t *const self_p, const size_t first, const size_t last);
+int mddl_stl_vector_assign( mddl_stl_vector_t *const self_p, const void *const src, const size_t n, const size_t sizof_element);
+
 int mddl_stl_vector_get_element_at( mddl_stl_vector_t *const self_p, const size_t num, void *const el_p, const size_t sizof_element);
 int mddl_stl_vector_overwrite_element_at( mddl_stl_vector_t *const self_p, const size_t num, const void *const el_p, const size_t sizof_element);
 
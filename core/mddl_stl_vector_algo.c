@@ -0,0 +1,595 @@
+/**
+ *	Copyright 2026 TSN-SHINGENN All Rights Reserved.
+ *
+ *	Basic Author: Seiichi Takeda  '2026-October-16 Active
+ *		Last Alteration $Author: takeda $
+ *
+ *	Dual License :
+ *	non-commercial ... MIT Licence
+ *	    commercial ... Requires permission from the author
+ */
+
+/**
+ * @file mddl_stl_vector_algo.c
+ * @brief mddl_stl_vectorの要素を直接並べ替えるアルゴリズム群です。
+ *	要素の入れ替えはスタック上の一時領域で行うので、アロケータを呼びません。
+ *	要素サイズが4,8,16バイトの場合は入れ替えが整数のロード・ストアになるように特殊化しています。
+ *	スレッドセーフではありません。上位層で処理を行ってください。
+ */
+
+/* CRL */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+/* this */
+#include "mddl_stl_vector.h"
+#include "mddl_stl_vector_algo.h"
+
+/* Debug */
+#if defined(__GNUC__)
+__attribute__ ((unused))
+#endif
+#ifdef DEBUG
+static int debuglevel = 4;
+#else
+static const int debuglevel = 0;
+#endif
+#include "dbms.h"
+
+#if defined(_MDDL_DMSG_IS_UART)
+#define EOL_CRLF "\n\r"
+#else
+#define EOL_CRLF "\n"
+#endif
+
+/* 要素サイズを定数として展開させるためにインライン化を強制する */
+#if defined(__GNUC__)
+#define ALGO_INLINE static inline __attribute__((always_inline))
+#else
+#define ALGO_INLINE static inline
+#endif
+
+#define SWAP_CHUNK_SIZE 64		/* 大きな要素を入れ替える際のスタック上の一時領域 */
+#define INSERTION_SORT_THRESHOLD 16	/* この要素数以下の区間は挿入ソートにする */
+#define SORT_STACK_DEPTH 64		/* 小さい区間から処理するので log2(SIZE_MAX) で足りる */
+
+#define ELEM(b, n, z) ((b) + ((n) * (z)))
+
+/**
+ * @fn static void elem_swap(uint8_t *const a, uint8_t *const b, const size_t z)
+ * @brief 要素を入れ替えます。zが定数の場合は整数の入れ替えになります
+ */
+ALGO_INLINE void elem_swap(uint8_t *const a, uint8_t *const b, const size_t z)
+{
+    switch(z) {
+    case 4: {
+	uint32_t x, y;
+	memcpy(&x, a, 4); memcpy(&y, b, 4);
+	memcpy(a, &y, 4); memcpy(b, &x, 4);
+	} break;
+    case 8: {
+	uint64_t x, y;
+	memcpy(&x, a, 8); memcpy(&y, b, 8);
+	memcpy(a, &y, 8); memcpy(b, &x, 8);
+	} break;
+    case 16: {
+	uint64_t x[2], y[2];
+	memcpy(x, a, 16); memcpy(y, b, 16);
+	memcpy(a, y, 16); memcpy(b, x, 16);
+	} break;
+    default: {
+	uint8_t tmp[SWAP_CHUNK_SIZE];
+	size_t ofs, len;
+	for( ofs=0; ofs < z; ofs += len ) {
+	    len = ((z - ofs) < SWAP_CHUNK_SIZE) ? (z - ofs) : SWAP_CHUNK_SIZE;
+	    memcpy(tmp, a + ofs, len);
+	    memcpy(a + ofs, b + ofs, len);
+	    memcpy(b + ofs, tmp, len);
+	}
+	} break;
+    }
+}
+
+/**
+ * @fn static void range_reverse(uint8_t *const base, const size_t n, const size_t z)
+ * @brief n個の要素の並びを反転します
+ */
+ALGO_INLINE void range_reverse(uint8_t *const base, const size_t n, const size_t z)
+{
+    size_t i, j;
+
+    for( i=0, j=n; (i + 1) < j; ++i ) {
+	--j;
+	elem_swap(ELEM(base, i, z), ELEM(base, j, z), z);
+    }
+}
+
+/**
+ * @fn static void range_rotate(uint8_t *const base, const size_t k, const size_t n, const size_t z)
+ * @brief n個の要素を、k番目の要素が先頭になるように回転します(3回の反転)
+ */
+ALGO_INLINE void range_rotate(uint8_t *const base, const size_t k, const size_t n, const size_t z)
+{
+    if( (0 == k) || (k >= n) ) {
+	return;
+    }
+    range_reverse(base, k, z);
+    range_reverse(ELEM(base, k, z), n - k, z);
+    range_reverse(base, n, z);
+}
+
+/**
+ * @fn static void insertion_sort(uint8_t *const base, const size_t n, const size_t z, const mddl_stl_vector_compar_t compar, void *const arg)
+ * @brief 短い区間用の挿入ソートです(安定)
+ */
+ALGO_INLINE void insertion_sort(uint8_t *const base, const size_t n, const size_t z,
+	const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    size_t i, j;
+
+    for( i=1; i < n; ++i ) {
+	for( j=i; (j > 0) && (compar(ELEM(base, j - 1, z), ELEM(base, j, z), arg) > 0); --j ) {
+	    elem_swap(ELEM(base, j - 1, z), ELEM(base, j, z), z);
+	}
+    }
+}
+
+/**
+ * @fn static void heap_sort(uint8_t *const base, const size_t n, const size_t z, const mddl_stl_vector_compar_t compar, void *const arg)
+ * @brief 分割が偏った場合に切り替えるヒープソートです(O(n log n)を保証する)
+ */
+ALGO_INLINE void heap_sort(uint8_t *const base, const size_t n, const size_t z,
+	const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    size_t start, end, root, child;
+
+    for( start = n / 2; start-- > 0; ) {
+	for( root = start; (child = 2 * root + 1) < n; root = child ) {
+	    if( ((child + 1) < n) && (compar(ELEM(base, child, z), ELEM(base, child + 1, z), arg) < 0) ) {
+		++child;
+	    }
+	    if( compar(ELEM(base, root, z), ELEM(base, child, z), arg) >= 0 ) {
+		break;
+	    }
+	    elem_swap(ELEM(base, root, z), ELEM(base, child, z), z);
+	}
+    }
+    for( end = n - 1; end > 0; --end ) {
+	elem_swap(base, ELEM(base, end, z), z);
+	for( root = 0; (child = 2 * root + 1) < end; root = child ) {
+	    if( ((child + 1) < end) && (compar(ELEM(base, child, z), ELEM(base, child + 1, z), arg) < 0) ) {
+		++child;
+	    }
+	    if( compar(ELEM(base, root, z), ELEM(base, child, z), arg) >= 0 ) {
+		break;
+	    }
+	    elem_swap(ELEM(base, root, z), ELEM(base, child, z), z);
+	}
+    }
+}
+
+/**
+ * @fn static size_t partition(uint8_t *const base, const size_t n, const size_t z, const mddl_stl_vector_compar_t compar, void *const arg)
+ * @brief 3点の中央値を軸にして区間を分割し、軸の位置を返します
+ *	軸は先頭に置いて比較するので、軸のコピーは作りません。
+ */
+ALGO_INLINE size_t partition(uint8_t *const base, const size_t n, const size_t z,
+	const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    uint8_t *const mid = ELEM(base, n / 2, z);
+    uint8_t *const last = ELEM(base, n - 1, z);
+    size_t i, j;
+
+    /* base <= mid <= last に並べ、中央値を先頭に移す */
+    if( compar(mid, base, arg) < 0 ) {
+	elem_swap(mid, base, z);
+    }
+    if( compar(last, mid, arg) < 0 ) {
+	elem_swap(last, mid, z);
+	if( compar(mid, base, arg) < 0 ) {
+	    elem_swap(mid, base, z);
+	}
+    }
+    elem_swap(base, mid, z);
+
+    /* 末尾は軸以上、先頭は軸そのものなので、それぞれ番兵になる */
+    i = 1;
+    j = n - 1;
+    for(;;) {
+	while( compar(ELEM(base, i, z), base, arg) < 0 ) {
+	    ++i;
+	}
+	while( compar(base, ELEM(base, j, z), arg) < 0 ) {
+	    --j;
+	}
+	if( i >= j ) {
+	    break;
+	}
+	elem_swap(ELEM(base, i, z), ELEM(base, j, z), z);
+	++i;
+	--j;
+    }
+    elem_swap(base, ELEM(base, j, z), z);
+
+    return j;
+}
+
+/**
+ * @fn static void introsort(uint8_t *base, size_t n, const size_t z, const mddl_stl_vector_compar_t compar, void *const arg)
+ * @brief イントロソートの本体です。再帰の代わりに小さい側から処理する明示的なスタックを使います
+ */
+ALGO_INLINE void introsort(uint8_t *base, size_t n, const size_t z,
+	const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    struct {
+	uint8_t *base;
+	size_t n;
+	unsigned int depth;
+    } stack[SORT_STACK_DEPTH];
+    unsigned int sp = 0, depth = 0;
+    size_t m, p;
+
+    for( m = n; m > 1; m >>= 1 ) {
+	depth += 2;
+    }
+
+    for(;;) {
+	while( n > INSERTION_SORT_THRESHOLD ) {
+	    if( 0 == depth ) {
+		heap_sort(base, n, z, compar, arg);
+		n = 0;
+		break;
+	    }
+	    --depth;
+	    p = partition(base, n, z, compar, arg);
+	    /* 大きい側を積んで小さい側を続けて処理する */
+	    if( p < (n - p - 1) ) {
+		stack[sp].base = ELEM(base, p + 1, z);
+		stack[sp].n = n - p - 1;
+		stack[sp].depth = depth;
+		++sp;
+		n = p;
+	    } else {
+		stack[sp].base = base;
+		stack[sp].n = p;
+		stack[sp].depth = depth;
+		++sp;
+		base = ELEM(base, p + 1, z);
+		n = n - p - 1;
+	    }
+	}
+	if( n > 1 ) {
+	    insertion_sort(base, n, z, compar, arg);
+	}
+	if( 0 == sp ) {
+	    break;
+	}
+	--sp;
+	base = stack[sp].base;
+	n = stack[sp].n;
+	depth = stack[sp].depth;
+    }
+}
+
+static void introsort_4(uint8_t *const base, const size_t n, const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    introsort(base, n, 4, compar, arg);
+}
+
+static void introsort_8(uint8_t *const base, const size_t n, const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    introsort(base, n, 8, compar, arg);
+}
+
+static void introsort_16(uint8_t *const base, const size_t n, const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    introsort(base, n, 16, compar, arg);
+}
+
+static void introsort_any(uint8_t *const base, const size_t n, const size_t z, const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    introsort(base, n, z, compar, arg);
+}
+
+/**
+ * @fn int mddl_stl_vector_sort( mddl_stl_vector_t *const self_p, const mddl_stl_vector_compar_t compar, void *const arg)
+ * @brief 要素を昇順に並べ替えます(イントロソート、安定ではありません)
+ *	最悪でもO(n log n)で、メモリの割り当ては行いません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param compar 比較関数
+ * @param arg 比較関数に渡す引数
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ */
+int mddl_stl_vector_sort( mddl_stl_vector_t *const self_p, const mddl_stl_vector_compar_t compar, void *const arg)
+{
+    size_t n;
+    uint8_t *base;
+
+    if( (NULL == self_p) || (NULL == compar) ) {
+	return EINVAL;
+    }
+    base = (uint8_t*)mddl_stl_vector_data(self_p, &n);
+    if( n < 2 ) {
+	return 0;
+    }
+
+    switch( self_p->sizof_element ) {
+    case 4:
+	introsort_4(base, n, compar, arg);
+	break;
+    case 8:
+	introsort_8(base, n, compar, arg);
+	break;
+    case 16:
+	introsort_16(base, n, compar, arg);
+	break;
+    default:
+	introsort_any(base, n, self_p->sizof_element, compar, arg);
+	break;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn static int bound_search(mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p, const int upper)
+ * @brief lower_bound/upper_boundの共通部分です
+ */
+static int bound_search(mddl_stl_vector_t *const self_p, const void *const key,
+	const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p, const int upper)
+{
+    const uint8_t *base;
+    size_t lo = 0, n, half;
+    int c;
+
+    if( (NULL == self_p) || (NULL == compar) || (NULL == pos_p) ) {
+	return EINVAL;
+    }
+    base = (const uint8_t*)mddl_stl_vector_data(self_p, &n);
+
+    while( n > 0 ) {
+	half = n / 2;
+	c = compar(ELEM(base, lo + half, self_p->sizof_element), key, arg);
+	if( (c < 0) || (upper && (0 == c)) ) {
+	    lo += half + 1;
+	    n -= half + 1;
+	} else {
+	    n = half;
+	}
+    }
+    *pos_p = lo;
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_stl_vector_lower_bound( mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p)
+ * @brief 昇順に並んだ要素から、key以上の最初の要素番号を二分探索します
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param key 探索するキー(比較関数の第2引数に渡されます)
+ * @param compar 比較関数
+ * @param arg 比較関数に渡す引数
+ * @param pos_p 要素番号を格納するポインタ(該当しない場合は要素数)
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ */
+int mddl_stl_vector_lower_bound( mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p)
+{
+    return bound_search(self_p, key, compar, arg, pos_p, 0);
+}
+
+/**
+ * @fn int mddl_stl_vector_upper_bound( mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p)
+ * @brief 昇順に並んだ要素から、keyより大きい最初の要素番号を二分探索します
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param key 探索するキー(比較関数の第2引数に渡されます)
+ * @param compar 比較関数
+ * @param arg 比較関数に渡す引数
+ * @param pos_p 要素番号を格納するポインタ(該当しない場合は要素数)
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ */
+int mddl_stl_vector_upper_bound( mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p)
+{
+    return bound_search(self_p, key, compar, arg, pos_p, 1);
+}
+
+/**
+ * @fn int mddl_stl_vector_reverse( mddl_stl_vector_t *const self_p, const size_t first, const size_t last)
+ * @brief [first, last)の要素の並びを反転します
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param first 先頭の要素番号
+ * @param last 末尾の次の要素番号
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval ENOENT 不正な要素番号
+ */
+int mddl_stl_vector_reverse( mddl_stl_vector_t *const self_p, const size_t first, const size_t last)
+{
+    const size_t z = (NULL == self_p) ? 0 : self_p->sizof_element;
+    uint8_t *base;
+    size_t n;
+
+    if( NULL == self_p ) {
+	return EINVAL;
+    }
+    base = (uint8_t*)mddl_stl_vector_data(self_p, &n);
+    if( (first > last) || (last > n) ) {
+	return ENOENT;
+    } else if( (last - first) < 2 ) {
+	return 0;
+    }
+
+    switch( z ) {
+    case 4:
+	range_reverse(ELEM(base, first, 4), last - first, 4);
+	break;
+    case 8:
+	range_reverse(ELEM(base, first, 8), last - first, 8);
+	break;
+    case 16:
+	range_reverse(ELEM(base, first, 16), last - first, 16);
+	break;
+    default:
+	range_reverse(ELEM(base, first, z), last - first, z);
+	break;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_stl_vector_rotate( mddl_stl_vector_t *const self_p, const size_t first, const size_t middle, const size_t last)
+ * @brief [first, last)の要素を、middle番目の要素が先頭になるように回転します
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param first 先頭の要素番号
+ * @param middle 先頭に移す要素番号
+ * @param last 末尾の次の要素番号
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval ENOENT 不正な要素番号
+ */
+int mddl_stl_vector_rotate( mddl_stl_vector_t *const self_p, const size_t first, const size_t middle, const size_t last)
+{
+    uint8_t *base;
+    size_t n, z;
+
+    if( NULL == self_p ) {
+	return EINVAL;
+    }
+    z = self_p->sizof_element;
+    base = (uint8_t*)mddl_stl_vector_data(self_p, &n);
+    if( (first > middle) || (middle > last) || (last > n) ) {
+	return ENOENT;
+    }
+
+    switch( z ) {
+    case 4:
+	range_rotate(ELEM(base, first, 4), middle - first, last - first, 4);
+	break;
+    case 8:
+	range_rotate(ELEM(base, first, 8), middle - first, last - first, 8);
+	break;
+    case 16:
+	range_rotate(ELEM(base, first, 16), middle - first, last - first, 16);
+	break;
+    default:
+	range_rotate(ELEM(base, first, z), middle - first, last - first, z);
+	break;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int mddl_stl_vector_unique( mddl_stl_vector_t *const self_p, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const num_p)
+ * @brief 連続して等しい(比較関数が0を返す)要素を先頭の1つだけ残して消去します
+ *	ソート済みの場合は重複の無い並びになります。容量は変更しません。
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param compar 比較関数
+ * @param arg 比較関数に渡す引数
+ * @param num_p 残った要素数を格納するポインタ(NULL可)
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ * @retval EPERM 固定メモリのvector(要素は変更しません)
+ */
+int mddl_stl_vector_unique( mddl_stl_vector_t *const self_p, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const num_p)
+{
+    uint8_t *base;
+    size_t n, z, r, w;
+    int result;
+
+    if( (NULL == self_p) || (NULL == compar) ) {
+	return EINVAL;
+    }
+    z = self_p->sizof_element;
+    base = (uint8_t*)mddl_stl_vector_data(self_p, &n);
+
+    /* 要素数を減らせない(固定メモリ)場合は、要素を詰める前にエラーにする */
+    result = mddl_stl_vector_erase_range(self_p, n, n);
+    if( result ) {
+	return result;
+    }
+    if( n < 2 ) {
+	if( NULL != num_p ) {
+	    *num_p = n;
+	}
+	return 0;
+    }
+
+    for( w=0, r=1; r < n; ++r ) {
+	if( 0 != compar(ELEM(base, w, z), ELEM(base, r, z), arg) ) {
+	    ++w;
+	    if( w != r ) {
+		memcpy(ELEM(base, w, z), ELEM(base, r, z), z);
+	    }
+	}
+    }
+    ++w;
+
+    result = mddl_stl_vector_erase_range(self_p, w, n);
+    if( result ) {
+	return result;
+    }
+    if( NULL != num_p ) {
+	*num_p = w;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn static size_t stable_partition_range(uint8_t *const base, const size_t n, const size_t z, const mddl_stl_vector_pred_t pred, void *const arg)
+ * @brief 区間を半分に分けてそれぞれを分割し、間の2区間を回転して繋ぎます
+ *	一時領域を使わずにO(n log n)回の入れ替えで済みます。再帰の深さはlog2(n)です。
+ * @return 条件を満たす要素数
+ */
+static size_t stable_partition_range(uint8_t *const base, const size_t n, const size_t z,
+	const mddl_stl_vector_pred_t pred, void *const arg)
+{
+    size_t half, left, right;
+
+    if( 1 == n ) {
+	return (pred(base, arg)) ? 1 : 0;
+    }
+    half = n / 2;
+    left = stable_partition_range(base, half, z, pred, arg);
+    right = stable_partition_range(ELEM(base, half, z), n - half, z, pred, arg);
+
+    /* [left, half)の偽と[half, half + right)の真を入れ替える */
+    range_rotate(ELEM(base, left, z), half - left, (half - left) + right, z);
+
+    return left + right;
+}
+
+/**
+ * @fn int mddl_stl_vector_stable_partition( mddl_stl_vector_t *const self_p, const mddl_stl_vector_pred_t pred, void *const arg, size_t *const pos_p)
+ * @brief 条件を満たす要素を前に、満たさない要素を後ろに、それぞれの順序を保って並べ替えます
+ * @param self_p mddl_stl_vector_t構造体インスタンスポインタ
+ * @param pred 判定関数
+ * @param arg 判定関数に渡す引数
+ * @param pos_p 条件を満たさない最初の要素番号を格納するポインタ(NULL可)
+ * @retval 0 成功
+ * @retval EINVAL 引数不正
+ */
+int mddl_stl_vector_stable_partition( mddl_stl_vector_t *const self_p, const mddl_stl_vector_pred_t pred, void *const arg, size_t *const pos_p)
+{
+    uint8_t *base;
+    size_t n, pos = 0;
+
+    if( (NULL == self_p) || (NULL == pred) ) {
+	return EINVAL;
+    }
+    base = (uint8_t*)mddl_stl_vector_data(self_p, &n);
+    if( n > 0 ) {
+	pos = stable_partition_range(base, n, self_p->sizof_element, pred, arg);
+    }
+    if( NULL != pos_p ) {
+	*pos_p = pos;
+    }
+
+    return 0;
+}
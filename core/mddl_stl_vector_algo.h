@@ -0,0 +1,37 @@
+#ifndef INC_MDDL_STL_VECTOR_ALGO_H
+#define INC_MDDL_STL_VECTOR_ALGO_H
+
+#pragma once
+
+#include <stddef.h>
+
+#include "mddl_stl_vector.h"
+
+/**
+ * @brief 要素の比較関数です
+ *	a < bの場合は負、a == bの場合は0、a > bの場合は正を返してください。argはそのまま渡されます。
+ */
+typedef int (*mddl_stl_vector_compar_t)(const void *const a, const void *const b, void *const arg);
+
+/**
+ * @brief 要素の判定関数です。条件を満たす場合は0以外を返してください。
+ */
+typedef int (*mddl_stl_vector_pred_t)(const void *const el, void *const arg);
+
+#if defined (__cplusplus )
+extern "C" {
+#endif
+
+int mddl_stl_vector_sort( mddl_stl_vector_t *const self_p, const mddl_stl_vector_compar_t compar, void *const arg);
+int mddl_stl_vector_lower_bound( mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p);
+int mddl_stl_vector_upper_bound( mddl_stl_vector_t *const self_p, const void *const key, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const pos_p);
+int mddl_stl_vector_reverse( mddl_stl_vector_t *const self_p, const size_t first, const size_t last);
+int mddl_stl_vector_rotate( mddl_stl_vector_t *const self_p, const size_t first, const size_t middle, const size_t last);
+int mddl_stl_vector_unique( mddl_stl_vector_t *const self_p, const mddl_stl_vector_compar_t compar, void *const arg, size_t *const num_p);
+int mddl_stl_vector_stable_partition( mddl_stl_vector_t *const self_p, const mddl_stl_vector_pred_t pred, void *const arg, size_t *const pos_p);
+
+#if defined (__cplusplus )
+}
+#endif
+
+#endif /* end of INC_MDDL_STL_VECTOR_ALGO_H */
@@ -811,12 +811,22 @@ out:
     return lenofneeders;
 }
 
+/*
+ * 以下のラッパーは_own_vsnprintf()にva_copy()したva_listのポインタを渡します。
+ * va_listが配列型のABI(x86_64等)では、引数のapは配列の先頭ポインタに変換されているので
+ * &apは va_list* になりません。
+ */
 int mddl_vsnprintf(char *const buf, const size_t max_length, const char *const fmt, va_list ap)
 {
     const xtoa_output_method_t _method = 
 	_xtoa_output_method_initializer_set_buffer( buf, max_length);
 
-    const int retval = _own_vsnprintf( &_method, fmt, &ap);
+    int retval;
+    va_list aq;
+
+    va_copy(aq, ap);
+    retval = _own_vsnprintf( &_method, fmt, &aq);
+    va_end(aq);
 
     return retval;
 }
@@ -835,7 +845,12 @@ int mddl_vsprintf(char *const buf, const char *const fmt, va_list ap)
     const xtoa_output_method_t _method = 
 	_xtoa_output_method_initializer_set_buffer( buf, 0);
 
-    const int retval = _own_vsnprintf( &_method, fmt, &ap);
+    int retval;
+    va_list aq;
+
+    va_copy(aq, ap);
+    retval = _own_vsnprintf( &_method, fmt, &aq);
+    va_end(aq);
 
     return retval;
 }
@@ -854,7 +869,12 @@ int mddl_vsprintf(char *const buf, const char *const fmt, va_list ap)
 int mddl_vsnprintf_putchar(int (*putchar_cbfunc)(int), const size_t max_len, const char *const fmt, va_list ap)
 {
     const xtoa_output_method_t _method = _xtoa_output_method_initializer_set_callback_func( putchar_cbfunc, max_len);
-    const int retval = _own_vsnprintf( &_method, fmt, &ap);
+    int retval;
+    va_list aq;
+
+    va_copy(aq, ap);
+    retval = _own_vsnprintf( &_method, fmt, &aq);
+    va_end(aq);
     return retval;
 }
 
@@ -871,7 +891,12 @@ int mddl_vsnprintf_putchar(int (*putchar_cbfunc)(int), const size_t max_len, con
 int mddl_vsprintf_putchar(int (*putchar_cbfunc)(int), const char *const fmt, va_list ap)
 {
     const xtoa_output_method_t _method = _xtoa_output_method_initializer_set_callback_func( putchar_cbfunc, 0);
-    const int retval = _own_vsnprintf( &_method, fmt, &ap);
+    int retval;
+    va_list aq;
+
+    va_copy(aq, ap);
+    retval = _own_vsnprintf( &_method, fmt, &aq);
+    va_end(aq);
     return retval;
 }
 
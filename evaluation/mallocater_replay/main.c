@@ -0,0 +1,899 @@
+/**
+ *	Copyright 2026 TSN-SHINGENN All Rights Reserved.
+ *
+ *	Basic Author: Seiichi Takeda  '2026-October-16 Active
+ *		Last Alteration $Author: takeda $
+ *
+ *	Dual License :
+ *	non-commercial ... MIT Licence
+ *	    commercial ... Requires permission from the author
+ */
+
+/**
+ * @file main.c
+ * @brief mddl_mallocaterの割り当てトレースを再生して、アロケータを比較するベンチマークです。
+ *	_MDDL_MALLOCATER_TRACEを定義してビルドしたmddl_mallocaterで記録したトレースを、
+ *	mddl_mallocater(通常/スラブ有効)、CRTのmalloc、mddl_mempoolのサイズ別プール+mddl_mallocaterで
+ *	再生し、スループット、1操作毎のレイテンシのパーセンタイル、ピークフットプリント、断片化率を表示します。
+ *
+ *	ビルド例(POSIX):
+ *	  cc -O2 -I../../core -I../sprintf -o mallocater_replay main.c ../../core/mddl_mallocater.c \
+ *	     ../../core/mddl_mempool.c ../../core/mddl_sprintf.c ../../core/mddl_vsprintf.c
+ *
+ *	使い方:
+ *	  mallocater_replay [-H heapsize] [-n repeat] trace.bin
+ *	  mallocater_replay -g trace.bin [ops]	... 合成トレースを作成する
+ *
+ *	フットプリントはmddl_mallocater系がヒープ内で一度でも割り当てたページの合計
+ *	(と追加領域の合計)、mallocがmallinfo2()のarena+hblkhdです。
+ *	断片化率はピークフットプリント時点の (1 - 要求サイズの合計 / フットプリント) です。
+ */
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "mddl_mallocater.h"
+#include "mddl_mempool.h"
+
+#define FOOTPRINT_SAMPLE_INTERVAL 256
+#define POOL_CLASS_COUNT 5	/* 16,32,64,128,256 */
+#define POOL_MAX_SIZE 256
+
+#define HEAP_PAGE_SIZE 4096
+
+#define SLOT_NONE ((uint32_t)0xffffffffu)
+
+/**
+ * @brief 再生用に変換した操作です。ポインタ値はスロット番号に置き換えます。
+ */
+typedef struct _replay_op {
+    uint32_t op;	/* enum_mddl_mallocater_trace_op_t */
+    uint32_t src;	/* FREE/REALLOCの対象スロット */
+    uint32_t dst;	/* ALLOC/REALLOCの結果を入れるスロット */
+    uint32_t hint;
+    size_t size;
+} replay_op_t;
+
+typedef struct _replay_trace {
+    replay_op_t *ops;
+    size_t nops;
+    size_t nslots;
+    size_t skipped;	/* 失敗した操作と、記録開始前のポインタへの操作 */
+} replay_trace_t;
+
+/**
+ * @brief 再生対象のアロケータです。
+ */
+typedef struct _replay_target {
+    const char *name;
+    int (*init)(void *const ctx, const size_t heapsiz);
+    void (*destroy)(void *const ctx);
+    void *(*alloc)(void *const ctx, const size_t size, const uint32_t hint);
+    void *(*realloc)(void *const ctx, void *const ptr, const size_t oldsize, const size_t size);
+    void (*free)(void *const ctx, void *const ptr, const size_t size);
+    size_t (*footprint)(void *const ctx);
+    void *ctx;
+} replay_target_t;
+
+typedef struct _replay_result {
+    double elapsed_sec;
+    uint64_t ops;
+    uint32_t lat_ns[5];	/* p50, p90, p99, p99.9, max */
+    size_t peak_footprint;
+    size_t live_at_peak;
+    uint64_t failed;
+} replay_result_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * ヒープのフットプリント計測
+ */
+typedef struct _heap_ctx {
+    mddl_mallocater_t heap;
+    void *buf;
+    size_t bufsiz;
+    size_t grown_bytes;		/* 成長用コールバックで追加した領域の合計 */
+    uint8_t *touched;		/* bufのページ毎の使用済みフラグ */
+    size_t touched_bytes;	/* 一度でも割り当てたページの合計 */
+    int slab;
+} heap_ctx_t;
+
+static void *heap_region_alloc(void *const ctx, size_t *const size_p)
+{
+    heap_ctx_t *const h = (heap_ctx_t*)ctx;
+    void *const mem = malloc(*size_p);
+
+    if( NULL != mem ) {
+	h->grown_bytes += *size_p;
+    }
+    return mem;
+}
+
+static void heap_region_free(void *const ctx, void *const mem, const size_t size)
+{
+    (void)ctx;
+    (void)size;
+    free(mem);
+}
+
+static __inline void heap_touch(heap_ctx_t *const h, const void *const ptr, const size_t size)
+{
+    const uintptr_t top = (uintptr_t)h->buf;
+    const uintptr_t end = (uintptr_t)ptr + size;
+    size_t pg;
+
+    if( ((uintptr_t)ptr < top) || (end > (top + h->bufsiz)) || (0 == size) ) {
+	return;
+    }
+    for( pg = ((uintptr_t)ptr - top) / HEAP_PAGE_SIZE; pg <= ((end - 1 - top) / HEAP_PAGE_SIZE); ++pg ) {
+	if( !h->touched[pg] ) {
+	    h->touched[pg] = 1;
+	    h->touched_bytes += HEAP_PAGE_SIZE;
+	}
+    }
+}
+
+static int heap_open(heap_ctx_t *const h, const size_t heapsiz)
+{
+    mddl_mallocater_grow_t grow;
+    int result;
+
+    memset(&h->heap, 0x0, sizeof(h->heap));
+    h->bufsiz = heapsiz;
+    h->buf = malloc(heapsiz);
+    if( NULL == h->buf ) {
+	return ENOMEM;
+    }
+    h->touched = (uint8_t*)calloc((heapsiz / HEAP_PAGE_SIZE) + 1, 1);
+    if( NULL == h->touched ) {
+	free(h->buf);
+	return ENOMEM;
+    }
+    h->grown_bytes = 0;
+    h->touched_bytes = 0;
+
+    result = mddl_mallocater_init_obj(&h->heap, h->buf, h->bufsiz);
+    if( result ) {
+	free(h->touched);
+	free(h->buf);
+	return result;
+    }
+    /* 計測中のヘッダ検査は他のアロケータと条件を揃えるために止める */
+    mddl_mallocater_set_check_level_with_obj(&h->heap, MDDL_MALLOCATER_CHECK_OFF);
+    mddl_mallocater_set_slab_with_obj(&h->heap, h->slab);
+
+    memset(&grow, 0x0, sizeof(grow));
+    grow.region_alloc = heap_region_alloc;
+    grow.region_free = heap_region_free;
+    grow.ctx = h;
+    grow.chunk_size = heapsiz / 4;
+    return mddl_mallocater_set_grow_with_obj(&h->heap, &grow);
+}
+
+static void heap_close(heap_ctx_t *const h)
+{
+    mddl_mallocater_destroy(&h->heap);
+    free(h->touched);
+    free(h->buf);
+    h->buf = NULL;
+}
+
+static size_t heap_footprint_of(heap_ctx_t *const h)
+{
+    return h->touched_bytes + h->grown_bytes;
+}
+
+/*
+ * mddl_mallocater
+ */
+static int mallocater_init(void *const ctx, const size_t heapsiz)
+{
+    return heap_open((heap_ctx_t*)ctx, heapsiz);
+}
+
+static void mallocater_destroy(void *const ctx)
+{
+    heap_close((heap_ctx_t*)ctx);
+}
+
+static void *mallocater_alloc(void *const ctx, const size_t size, const uint32_t hint)
+{
+    heap_ctx_t *const h = (heap_ctx_t*)ctx;
+    void *const ptr = mddl_mallocater_alloc_hint_with_obj(&h->heap, size, (enum_mddl_mallocater_lifetime_t)hint);
+
+    if( NULL != ptr ) {
+	heap_touch(h, ptr, size);
+    }
+    return ptr;
+}
+
+static void *mallocater_realloc(void *const ctx, void *const ptr, const size_t oldsize, const size_t size)
+{
+    heap_ctx_t *const h = (heap_ctx_t*)ctx;
+    void *const new_ptr = mddl_mallocater_realloc_with_obj(&h->heap, ptr, size);
+
+    (void)oldsize;
+    if( NULL != new_ptr ) {
+	heap_touch(h, new_ptr, size);
+    }
+    return new_ptr;
+}
+
+static void mallocater_free(void *const ctx, void *const ptr, const size_t size)
+{
+    (void)size;
+    mddl_mallocater_free_with_obj(&((heap_ctx_t*)ctx)->heap, ptr);
+}
+
+static size_t mallocater_footprint(void *const ctx)
+{
+    return heap_footprint_of((heap_ctx_t*)ctx);
+}
+
+/*
+ * CRT malloc
+ *	mallinfo2()はプロセス全体の値なので、再生開始時点の値を差し引きます。
+ */
+static size_t crt_mallinfo_bytes(void)
+{
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+    const struct mallinfo2 mi = mallinfo2();
+    return mi.arena + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static int crt_init(void *const ctx, const size_t heapsiz)
+{
+    (void)heapsiz;
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+    *(size_t*)ctx = crt_mallinfo_bytes();
+    return 0;
+}
+
+static void crt_destroy(void *const ctx)
+{
+    (void)ctx;
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+static void *crt_alloc(void *const ctx, const size_t size, const uint32_t hint)
+{
+    (void)ctx;
+    (void)hint;
+    return malloc(size);
+}
+
+static void *crt_realloc(void *const ctx, void *const ptr, const size_t oldsize, const size_t size)
+{
+    (void)ctx;
+    (void)oldsize;
+    return realloc(ptr, size);
+}
+
+static void crt_free(void *const ctx, void *const ptr, const size_t size)
+{
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static size_t crt_footprint(void *const ctx)
+{
+    const size_t base = *(size_t*)ctx;
+    const size_t now = crt_mallinfo_bytes();
+
+    return (now > base) ? (now - base) : 0;
+}
+
+/*
+ * mddl_mempoolのサイズ別プール + mddl_mallocater
+ *	POOL_MAX_SIZE以下は2の累乗のクラスのプール、それより大きいものはヒープから確保します。
+ *	プールのスラブも同じヒープから確保するので、フットプリントはヒープで計測します。
+ */
+typedef struct _pool_ctx {
+    heap_ctx_t h;
+    mddl_mempool_t pools[POOL_CLASS_COUNT];
+} pool_ctx_t;
+
+static int pool_class_of(const size_t size)
+{
+    int cls = 0;
+    size_t csz = 16;
+
+    if( (0 == size) || (size > POOL_MAX_SIZE) ) {
+	return -1;
+    }
+    while( csz < size ) {
+	csz <<= 1;
+	++cls;
+    }
+    return cls;
+}
+
+static int pool_init(void *const ctx, const size_t heapsiz)
+{
+    pool_ctx_t *const p = (pool_ctx_t*)ctx;
+    mddl_mempool_attr_t attr;
+    int result, cls;
+
+    result = heap_open(&p->h, heapsiz);
+    if( result ) {
+	return result;
+    }
+    memset(&attr, 0x0, sizeof(attr));
+    attr.heap_p = &p->h.heap;
+    for( cls=0; cls < POOL_CLASS_COUNT; ++cls ) {
+	result = mddl_mempool_init(&p->pools[cls], (size_t)16 << cls, &attr);
+	if( result ) {
+	    while( cls-- > 0 ) {
+		mddl_mempool_destroy(&p->pools[cls]);
+	    }
+	    heap_close(&p->h);
+	    return result;
+	}
+    }
+    return 0;
+}
+
+static void pool_destroy(void *const ctx)
+{
+    pool_ctx_t *const p = (pool_ctx_t*)ctx;
+    int cls;
+
+    for( cls=0; cls < POOL_CLASS_COUNT; ++cls ) {
+	mddl_mempool_destroy(&p->pools[cls]);
+    }
+    heap_close(&p->h);
+}
+
+static void *pool_alloc(void *const ctx, const size_t size, const uint32_t hint)
+{
+    pool_ctx_t *const p = (pool_ctx_t*)ctx;
+    const int cls = pool_class_of(size);
+    void *ptr;
+
+    if( cls < 0 ) {
+	return mallocater_alloc(&p->h, size, hint);
+    }
+    ptr = mddl_mempool_alloc(&p->pools[cls]);
+    if( NULL != ptr ) {
+	heap_touch(&p->h, ptr, size);
+    }
+    return ptr;
+}
+
+static void pool_free(void *const ctx, void *const ptr, const size_t size)
+{
+    pool_ctx_t *const p = (pool_ctx_t*)ctx;
+    const int cls = pool_class_of(size);
+
+    if( cls < 0 ) {
+	mddl_mallocater_free_with_obj(&p->h.heap, ptr);
+    } else {
+	mddl_mempool_free(&p->pools[cls], ptr);
+    }
+}
+
+static void *pool_realloc(void *const ctx, void *const ptr, const size_t oldsize, const size_t size)
+{
+    pool_ctx_t *const p = (pool_ctx_t*)ctx;
+    const int ocls = pool_class_of(oldsize);
+    const int ncls = pool_class_of(size);
+    void *new_ptr;
+
+    if( (ocls < 0) && (ncls < 0) ) {
+	return mallocater_realloc(&p->h, ptr, oldsize, size);
+    } else if( (ocls == ncls) ) {
+	return ptr;
+    }
+    new_ptr = pool_alloc(ctx, size, MDDL_MALLOCATER_LIFETIME_DEFAULT);
+    if( NULL != new_ptr ) {
+	memcpy(new_ptr, ptr, (oldsize < size) ? oldsize : size);
+	pool_free(ctx, ptr, oldsize);
+    }
+    return new_ptr;
+}
+
+static size_t pool_footprint(void *const ctx)
+{
+    return heap_footprint_of(&((pool_ctx_t*)ctx)->h);
+}
+
+/*
+ * トレースの読み込み
+ */
+
+/**
+ * @brief 記録されたポインタ値から使用中のスロット番号を引く開番地法のハッシュ表です。
+ */
+typedef struct _id_map {
+    uint64_t *keys;
+    uint32_t *slots;
+    size_t mask;
+} id_map_t;
+
+static int id_map_init(id_map_t *const m, const size_t nrec)
+{
+    size_t cap = 64;
+
+    while( cap < (nrec * 2) ) {
+	cap <<= 1;
+    }
+    m->keys = (uint64_t*)calloc(cap, sizeof(uint64_t));
+    m->slots = (uint32_t*)calloc(cap, sizeof(uint32_t));
+    m->mask = cap - 1;
+    return ((NULL == m->keys) || (NULL == m->slots)) ? ENOMEM : 0;
+}
+
+static void id_map_destroy(id_map_t *const m)
+{
+    free(m->keys);
+    free(m->slots);
+}
+
+static size_t id_map_pos(const id_map_t *const m, const uint64_t id)
+{
+    size_t i = (size_t)((id >> 4) * 0x9E3779B97F4A7C15ull) & m->mask;
+
+    while( (0 != m->keys[i]) && (id != m->keys[i]) ) {
+	i = (i + 1) & m->mask;
+    }
+    return i;
+}
+
+static void id_map_put(id_map_t *const m, const uint64_t id, const uint32_t slot)
+{
+    const size_t i = id_map_pos(m, id);
+
+    m->keys[i] = id;
+    m->slots[i] = slot;
+}
+
+static uint32_t id_map_take(id_map_t *const m, const uint64_t id)
+{
+    size_t i = id_map_pos(m, id), j, k;
+    uint32_t slot;
+
+    if( 0 == m->keys[i] ) {
+	return SLOT_NONE;
+    }
+    slot = m->slots[i];
+
+    /* 後続のエントリを詰め直して削除する */
+    m->keys[i] = 0;
+    for( j = (i + 1) & m->mask; 0 != m->keys[j]; j = (j + 1) & m->mask ) {
+	const uint64_t key = m->keys[j];
+	const uint32_t s = m->slots[j];
+
+	m->keys[j] = 0;
+	k = id_map_pos(m, key);
+	m->keys[k] = key;
+	m->slots[k] = s;
+    }
+    return slot;
+}
+
+static int trace_load(const char *const path, replay_trace_t *const t)
+{
+    mddl_mallocater_trace_file_header_t hdr;
+    mddl_mallocater_trace_record_t *recs = NULL;
+    size_t nrec, cap = 0, i;
+    id_map_t map;
+    FILE *fp;
+    int result = 0;
+
+    memset(t, 0x0, sizeof(*t));
+    fp = fopen(path, "rb");
+    if( NULL == fp ) {
+	return errno;
+    }
+    if( (1 != fread(&hdr, sizeof(hdr), 1, fp))
+	    || memcmp(hdr.magic, MDDL_MALLOCATER_TRACE_MAGIC, sizeof(hdr.magic))
+	    || (MDDL_MALLOCATER_TRACE_VERSION != hdr.version)
+	    || (sizeof(mddl_mallocater_trace_record_t) != hdr.sizof_record) ) {
+	fclose(fp);
+	return EINVAL;
+    }
+    for( nrec = 0; ; ++nrec ) {
+	if( nrec == cap ) {
+	    mddl_mallocater_trace_record_t *const r =
+		(mddl_mallocater_trace_record_t*)realloc(recs, sizeof(*recs) * (cap = (cap) ? cap * 2 : 4096));
+	    if( NULL == r ) {
+		free(recs);
+		fclose(fp);
+		return ENOMEM;
+	    }
+	    recs = r;
+	}
+	if( 1 != fread(&recs[nrec], sizeof(*recs), 1, fp) ) {
+	    break;
+	}
+    }
+    fclose(fp);
+
+    t->ops = (replay_op_t*)calloc((nrec) ? nrec : 1, sizeof(replay_op_t));
+    if( (NULL == t->ops) || id_map_init(&map, nrec) ) {
+	free(recs);
+	free(t->ops);
+	return ENOMEM;
+    }
+
+    for( i=0; i < nrec; ++i ) {
+	const mddl_mallocater_trace_record_t *const r = &recs[i];
+	replay_op_t *const o = &t->ops[t->nops];
+
+	o->op = r->op;
+	o->size = (size_t)r->size;
+	o->hint = r->arg;
+	o->src = o->dst = SLOT_NONE;
+	switch(r->op) {
+	case MDDL_MALLOCATER_TRACE_OP_ALLOC:
+	    if( 0 == r->id2 ) {
+		++(t->skipped);
+		continue;
+	    }
+	    break;
+	case MDDL_MALLOCATER_TRACE_OP_FREE:
+	    if( 0 == r->id ) {
+		continue;
+	    }
+	    o->src = id_map_take(&map, r->id);
+	    if( SLOT_NONE == o->src ) {
+		++(t->skipped);
+		continue;
+	    }
+	    break;
+	case MDDL_MALLOCATER_TRACE_OP_REALLOC:
+	    if( 0 == r->id2 ) {
+		++(t->skipped);
+		continue;
+	    }
+	    if( 0 == r->id ) {
+		o->op = MDDL_MALLOCATER_TRACE_OP_ALLOC;
+		break;
+	    }
+	    o->src = id_map_take(&map, r->id);
+	    if( SLOT_NONE == o->src ) {
+		/* 記録開始前の領域の再割り当ては新規の割り当てとして扱う */
+		o->op = MDDL_MALLOCATER_TRACE_OP_ALLOC;
+	    }
+	    break;
+	default:
+	    result = EINVAL;
+	    break;
+	}
+	if( result ) {
+	    break;
+	}
+	if( MDDL_MALLOCATER_TRACE_OP_FREE != o->op ) {
+	    o->dst = (uint32_t)(t->nslots++);
+	    id_map_put(&map, r->id2, o->dst);
+	}
+	++(t->nops);
+    }
+    id_map_destroy(&map);
+
+    free(recs);
+
+    return result;
+}
+
+/*
+ * 再生
+ */
+static int compare_u32(const void *const a, const void *const b)
+{
+    const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/**
+ * @fn static int replay_run(const replay_trace_t *const t, replay_target_t *const tgt, const size_t heapsiz, uint32_t *const lat, replay_result_t *const res)
+ * @brief トレースを1回再生します
+ *	latがNULLの場合は計測を挟まずに全体の時間だけを測り、
+ *	NULL以外の場合は1操作毎のレイテンシとフットプリントを記録します。
+ */
+static int replay_run(const replay_trace_t *const t, replay_target_t *const tgt, const size_t heapsiz, uint32_t *const lat, replay_result_t *const res)
+{
+    void **const ptrs = (void**)calloc((t->nslots) ? t->nslots : 1, sizeof(void*));
+    size_t *const sizes = (size_t*)calloc((t->nslots) ? t->nslots : 1, sizeof(size_t));
+    size_t live = 0, i;
+    uint64_t t0, t1;
+    int result;
+
+    if( (NULL == ptrs) || (NULL == sizes) ) {
+	free(ptrs);
+	free(sizes);
+	return ENOMEM;
+    }
+    result = tgt->init(tgt->ctx, heapsiz);
+    if( result ) {
+	free(ptrs);
+	free(sizes);
+	return result;
+    }
+
+    t0 = now_ns();
+    for( i=0; i < t->nops; ++i ) {
+	const replay_op_t *const o = &t->ops[i];
+	uint64_t s = 0;
+	void *p = NULL;
+
+	if( NULL != lat ) {
+	    s = now_ns();
+	}
+	switch(o->op) {
+	case MDDL_MALLOCATER_TRACE_OP_ALLOC:
+	    p = tgt->alloc(tgt->ctx, o->size, o->hint);
+	    break;
+	case MDDL_MALLOCATER_TRACE_OP_FREE:
+	    if( NULL != ptrs[o->src] ) {
+		tgt->free(tgt->ctx, ptrs[o->src], sizes[o->src]);
+	    }
+	    break;
+	case MDDL_MALLOCATER_TRACE_OP_REALLOC:
+	    p = (NULL != ptrs[o->src])
+		? tgt->realloc(tgt->ctx, ptrs[o->src], sizes[o->src], o->size)
+		: tgt->alloc(tgt->ctx, o->size, 0);
+	    break;
+	}
+	if( NULL != lat ) {
+	    lat[i] = (uint32_t)(now_ns() - s);
+	}
+
+	/* 結果の反映 */
+	if( SLOT_NONE != o->src ) {
+	    if( (MDDL_MALLOCATER_TRACE_OP_FREE == o->op) || (NULL != p) ) {
+		live -= sizes[o->src];
+		sizes[o->src] = 0;
+		ptrs[o->src] = NULL;
+	    }
+	}
+	if( SLOT_NONE != o->dst ) {
+	    if( NULL == p ) {
+		++(res->failed);
+	    } else {
+		ptrs[o->dst] = p;
+		sizes[o->dst] = o->size;
+		live += o->size;
+	    }
+	}
+	if( (NULL != lat) && !(i % FOOTPRINT_SAMPLE_INTERVAL) ) {
+	    const size_t fp = tgt->footprint(tgt->ctx);
+	    if( fp > res->peak_footprint ) {
+		res->peak_footprint = fp;
+		res->live_at_peak = live;
+	    }
+	}
+    }
+    t1 = now_ns();
+
+    if( NULL == lat ) {
+	res->elapsed_sec += (double)(t1 - t0) / 1e9;
+	res->ops += t->nops;
+    } else {
+	const size_t fp = tgt->footprint(tgt->ctx);
+	if( fp > res->peak_footprint ) {
+	    res->peak_footprint = fp;
+	    res->live_at_peak = live;
+	}
+    }
+
+    for( i=0; i < t->nslots; ++i ) {
+	if( NULL != ptrs[i] ) {
+	    tgt->free(tgt->ctx, ptrs[i], sizes[i]);
+	}
+    }
+    tgt->destroy(tgt->ctx);
+    free(ptrs);
+    free(sizes);
+
+    return 0;
+}
+
+static void replay_report_header(void)
+{
+    printf("%-18s %12s %8s %8s %8s %8s %10s %12s %7s %8s\n",
+	"allocator", "Mops/s", "p50ns", "p90ns", "p99ns", "p999ns", "maxns", "peak_fp", "frag%", "failed");
+}
+
+static void replay_report(const char *const name, const replay_result_t *const res)
+{
+    const double mops = (res->elapsed_sec > 0.0) ? ((double)res->ops / res->elapsed_sec / 1e6) : 0.0;
+    const double frag = (res->peak_footprint)
+	? (100.0 * (1.0 - ((double)res->live_at_peak / (double)res->peak_footprint))) : 0.0;
+
+    printf("%-18s %12.3f %8u %8u %8u %8u %10u %12llu %7.2f %8llu\n",
+	name, mops, res->lat_ns[0], res->lat_ns[1], res->lat_ns[2], res->lat_ns[3], res->lat_ns[4],
+	(unsigned long long)res->peak_footprint, frag, (unsigned long long)res->failed);
+}
+
+/**
+ * @fn static int trace_generate(const char *const path, const size_t nops)
+ * @brief 合成トレースを作成します
+ *	短寿命の小さな領域を中心に、長寿命の領域と再割り当てを混ぜた負荷です。
+ */
+static int trace_generate(const char *const path, const size_t nops)
+{
+    mddl_mallocater_trace_file_header_t hdr;
+    mddl_mallocater_trace_record_t r;
+    uint64_t *live;
+    size_t nlive = 0, i, cap = 4096;
+    uint64_t next_id = 0x1000, seed = 88172645463325252ull;
+    FILE *fp;
+
+    live = (uint64_t*)malloc(sizeof(uint64_t) * cap);
+    fp = fopen(path, "wb");
+    if( (NULL == fp) || (NULL == live) ) {
+	free(live);
+	if( NULL != fp ) {
+	    fclose(fp);
+	}
+	return ENOMEM;
+    }
+    memset(&hdr, 0x0, sizeof(hdr));
+    memcpy(hdr.magic, MDDL_MALLOCATER_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = MDDL_MALLOCATER_TRACE_VERSION;
+    hdr.sizof_record = sizeof(r);
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+
+    for( i=0; i < nops; ++i ) {
+	uint64_t x;
+
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	x = seed;
+
+	memset(&r, 0x0, sizeof(r));
+	r.ts_ns = i * 50;
+	if( (nlive > 0) && (((x & 0xff) < 100) || (nlive == cap)) ) {
+	    const size_t k = (size_t)((x >> 8) % nlive);
+	    if( (x & 0xf00) == 0 ) {
+		r.op = MDDL_MALLOCATER_TRACE_OP_REALLOC;
+		r.id = live[k];
+		r.id2 = live[k] = (next_id += 0x10);
+		r.size = 16 + ((x >> 32) % 2048);
+	    } else {
+		r.op = MDDL_MALLOCATER_TRACE_OP_FREE;
+		r.id = live[k];
+		live[k] = live[--nlive];
+	    }
+	} else {
+	    r.op = MDDL_MALLOCATER_TRACE_OP_ALLOC;
+	    r.id2 = live[nlive++] = (next_id += 0x10);
+	    if( (x & 0x3f000) == 0 ) {
+		r.size = 4096 + ((x >> 32) % 65536);
+		r.arg = MDDL_MALLOCATER_LIFETIME_LONG;
+	    } else {
+		r.size = 8 + ((x >> 32) % 248);
+	    }
+	}
+	fwrite(&r, sizeof(r), 1, fp);
+    }
+    free(live);
+
+    return (fclose(fp)) ? EIO : 0;
+}
+
+static void usage(const char *const prog)
+{
+    fprintf(stderr, "usage: %s [-H heapsize] [-n repeat] trace.bin\n", prog);
+    fprintf(stderr, "       %s -g trace.bin [ops]\n", prog);
+}
+
+int main(int ac, char **av)
+{
+    static heap_ctx_t heap_plain, heap_slab;
+    static pool_ctx_t pool;
+    static size_t crt_base;
+    replay_target_t targets[] = {
+	{ "mddl_mallocater", mallocater_init, mallocater_destroy, mallocater_alloc, mallocater_realloc, mallocater_free, mallocater_footprint, &heap_plain },
+	{ "mallocater+slab", mallocater_init, mallocater_destroy, mallocater_alloc, mallocater_realloc, mallocater_free, mallocater_footprint, &heap_slab },
+	{ "mempool+mallocater", pool_init, pool_destroy, pool_alloc, pool_realloc, pool_free, pool_footprint, &pool },
+	{ "libc malloc", crt_init, crt_destroy, crt_alloc, crt_realloc, crt_free, crt_footprint, &crt_base }
+    };
+    size_t heapsiz = (size_t)64 << 20;
+    unsigned int repeat = 5, n;
+    const char *path = NULL;
+    replay_trace_t t;
+    uint32_t *lat;
+    size_t i;
+    int result, argi;
+
+    for( argi = 1; argi < ac; ++argi ) {
+	if( !strcmp(av[argi], "-g") && ((argi + 1) < ac) ) {
+	    const size_t nops = ((argi + 2) < ac) ? (size_t)strtoull(av[argi + 2], NULL, 0) : 1000000;
+	    result = trace_generate(av[argi + 1], nops);
+	    if( result ) {
+		fprintf(stderr, "generate %s : %s\n", av[argi + 1], strerror(result));
+	    }
+	    return (result) ? 1 : 0;
+	} else if( !strcmp(av[argi], "-H") && ((argi + 1) < ac) ) {
+	    heapsiz = (size_t)strtoull(av[++argi], NULL, 0);
+	} else if( !strcmp(av[argi], "-n") && ((argi + 1) < ac) ) {
+	    repeat = (unsigned int)strtoul(av[++argi], NULL, 0);
+	} else if( NULL == path ) {
+	    path = av[argi];
+	} else {
+	    usage(av[0]);
+	    return 1;
+	}
+    }
+    if( NULL == path ) {
+	usage(av[0]);
+	return 1;
+    }
+
+    result = trace_load(path, &t);
+    if( result ) {
+	fprintf(stderr, "load %s : %s\n", path, strerror(result));
+	return 1;
+    }
+    printf("trace=%s ops=%llu slots=%llu skipped=%llu heap=%llu repeat=%u\n", path,
+	(unsigned long long)t.nops, (unsigned long long)t.nslots, (unsigned long long)t.skipped,
+	(unsigned long long)heapsiz, repeat);
+
+    lat = (uint32_t*)malloc(sizeof(uint32_t) * ((t.nops) ? t.nops : 1));
+    if( NULL == lat ) {
+	free(t.ops);
+	return 1;
+    }
+    heap_slab.slab = 1;
+
+    replay_report_header();
+    for( i=0; i < (sizeof(targets) / sizeof(targets[0])); ++i ) {
+	replay_result_t res;
+
+	/* mallinfo2()は一度広げたarenaを戻さないので、フットプリントを測る回を先に行う */
+	memset(&res, 0x0, sizeof(res));
+	result = replay_run(&t, &targets[i], heapsiz, lat, &res);
+	for( n=0; !result && (n < repeat); ++n ) {
+	    const uint64_t failed = res.failed;
+	    result = replay_run(&t, &targets[i], heapsiz, NULL, &res);
+	    res.failed = failed;
+	}
+	if( result ) {
+	    fprintf(stderr, "%s : %s\n", targets[i].name, strerror(result));
+	    continue;
+	}
+	if( t.nops ) {
+	    qsort(lat, t.nops, sizeof(uint32_t), compare_u32);
+	    res.lat_ns[0] = lat[(t.nops * 50) / 100];
+	    res.lat_ns[1] = lat[(t.nops * 90) / 100];
+	    res.lat_ns[2] = lat[(t.nops * 99) / 100];
+	    res.lat_ns[3] = lat[(t.nops * 999) / 1000];
+	    res.lat_ns[4] = lat[t.nops - 1];
+	}
+	replay_report(targets[i].name, &res);
+    }
+
+    free(lat);
+    free(t.ops);
+
+    return 0;
+}